@@ -0,0 +1,62 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.hpp"
+
+namespace {
+std::atomic<size_t> nb_allocations(0); // allocations since the start
+std::atomic<size_t> nb_bytes(0);       // allocated bytes since the start
+} // namespace
+
+#ifdef COUNT_ALLOCATIONS
+void *operator new(std::size_t size) {
+  nb_allocations.fetch_add(1, std::memory_order_relaxed);
+  nb_bytes.fetch_add(size, std::memory_order_relaxed);
+  void *ptr = std::malloc(size > 0 ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+/**
+ * @brief Check if the allocations are counted in this build
+ *
+ * @return true if the toolbox is compiled with COUNT_ALLOCATIONS
+ */
+bool AllocationCounter::isEnabled() {
+#ifdef COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Get the number of allocations since the start of the program
+ *
+ * @return number of allocations (0 if the counter is disabled)
+ */
+size_t AllocationCounter::getNbAllocations() {
+  return nb_allocations.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the number of allocated bytes since the start of the program
+ *
+ * @return allocated bytes (0 if the counter is disabled)
+ */
+size_t AllocationCounter::getNbBytes() {
+  return nb_bytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @class AllocationCounter
+ *
+ * @brief Count the heap allocations of the program
+ *
+ * The global operator new is only replaced when the toolbox is compiled with
+ * COUNT_ALLOCATIONS (cmake -DCOUNT_ALLOCATIONS=ON), otherwise the counter is
+ * disabled and costs nothing. StageProfiler reports the difference of the
+ * counters between the beginning and the end of each stage.
+ */
+class AllocationCounter {
+public:
+  // Functions
+  static bool isEnabled();
+  static size_t getNbAllocations();
+  static size_t getNbBytes();
+};
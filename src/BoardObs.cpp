@@ -6,10 +6,21 @@
 
 #include "BoardObs.hpp"
 #include "Camera.hpp"
+#include "TraceSink.hpp"
 #include "geometrytools.hpp"
 #include "logger.h"
 
-BoardObs::BoardObs() {}
+/**
+ * @brief Create the board observation
+ *
+ * The pose is allocated in the parameter arena.
+ *
+ * @param parameter_arena storage of the parameter blocks
+ */
+BoardObs::BoardObs(std::shared_ptr<ParameterArena> parameter_arena)
+    : parameter_arena_(parameter_arena) {
+  pose_ = parameter_arena_->allocate(ParameterArena::BoardPose, 6);
+}
 
 /**
  * @brief Initialize the board observation
@@ -59,13 +70,14 @@ void BoardObs::getPoseVec(cv::Mat &r_vec, cv::Mat &t_vec) {
  *
  * @return 4x4 board pose w.r.t. to the camera
  */
-cv::Mat BoardObs::getPoseMat() {
-  cv::Mat r_vec;
-  cv::Mat t_vec;
-  getPoseVec(r_vec, t_vec);
-  cv::Mat pose = RVecT2Proj(r_vec, t_vec);
-  return pose;
-}
+cv::Mat BoardObs::getPoseMat() { return getPose().toMat(); }
+
+/**
+ * @brief Get pose of the observed board
+ *
+ * @return board pose w.r.t. to the camera
+ */
+Pose BoardObs::getPose() { return Pose::fromBlock(pose_); }
 
 /**
  * @brief Get the rotation Rodrigues vector of this observation
@@ -96,16 +108,14 @@ cv::Mat BoardObs::getTransVec() {
  *
  * @param pose 4x4 pose matrix
  */
-void BoardObs::setPoseMat(cv::Mat pose) {
-  cv::Mat r_vec, t_vec;
-  Proj2RT(pose, r_vec, t_vec);
-  pose_[0] = r_vec.at<double>(0);
-  pose_[1] = r_vec.at<double>(1);
-  pose_[2] = r_vec.at<double>(2);
-  pose_[3] = t_vec.at<double>(0);
-  pose_[4] = t_vec.at<double>(1);
-  pose_[5] = t_vec.at<double>(2);
-}
+void BoardObs::setPoseMat(cv::Mat pose) { setPose(Pose::fromMat(pose)); }
+
+/**
+ * @brief Set the board pose w.r.t. the camera
+ *
+ * @param pose board pose
+ */
+void BoardObs::setPose(const Pose &pose) { pose.toBlock(pose_); }
 
 /**
  * @brief Set the board pose wrt. the camera from rotation and translation
@@ -144,6 +154,10 @@ void BoardObs::estimatePose(double ransac_thresh) {
   cv::Mat r_vec, t_vec;
   std::shared_ptr<Camera> cam_ptr = cam_.lock();
   if (cam_ptr) {
+    TraceScope trace("board_pose_ransac", "ransac");
+    trace.addArg("camera", camera_id_);
+    trace.addArg("frame", frame_id_);
+    trace.addArg("board", board_id_);
     cv::Mat inliers = ransacP3PDistortion(
         board_pts_temp, pts_2d_, cam_ptr->getCameraMat(),
         cam_ptr->getDistortionVectorVector(), r_vec, t_vec, ransac_thresh, 0.99,
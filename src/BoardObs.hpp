@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Board.hpp"
+#include "ParameterArena.hpp"
+#include "Pose.hpp"
 #include "opencv2/core/core.hpp"
 #include <iostream>
 #include <opencv2/aruco/charuco.hpp>
@@ -28,7 +30,8 @@ public:
   int board_id_;
 
   // Pose
-  double *pose_ = new double[6];
+  double *pose_; // block in the parameter arena
+  std::shared_ptr<ParameterArena> parameter_arena_;
 
   // points
   std::vector<cv::Point2f> pts_2d_;
@@ -45,14 +48,16 @@ public:
   bool valid_ = true;
 
   // Functions
-  BoardObs();
-  ~BoardObs() { delete[] pose_; };
+  BoardObs(std::shared_ptr<ParameterArena> parameter_arena);
+  ~BoardObs(){};
   void init(int camera_id, int frame_id, int board_id,
             std::vector<cv::Point2f> pts_2d, std::vector<int> charuco_id,
             std::shared_ptr<Camera> cam, std::shared_ptr<Board> board_3d);
   void getPoseVec(cv::Mat &R, cv::Mat &T);
   cv::Mat getPoseMat();
-  void setPoseMat(cv::Mat Pose);
+  Pose getPose();
+  void setPoseMat(cv::Mat pose);
+  void setPose(const Pose &pose);
   void setPoseVec(cv::Mat Rvec, cv::Mat T);
   void estimatePose(double ransac_thresh);
   float computeReprojectionError();
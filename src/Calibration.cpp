@@ -1,4 +1,7 @@
 #include "opencv2/core/core.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/opencv.hpp>
@@ -6,6 +9,11 @@
 #include <stdio.h>
 
 #include "Calibration.hpp"
+#include "Checkpoint.hpp"
+#include "OptimizationCeres.h"
+#include "PerfCounters.hpp"
+#include "SolverTelemetry.hpp"
+#include "TraceSink.hpp"
 #include "logger.h"
 #include "point_refinement.h"
 
@@ -51,9 +59,39 @@ void Calibration::initialization(std::string config_path) {
   fs["resolution_y_per_board"] >> resolution_y_per_board_;
   fs["he_approach"] >> he_approach_;
   fs["fix_intrinsic"] >> fix_intrinsic_;
-  
+  fs["number_thread"] >> nb_thread_;
+  fs["fix_board_merge"] >> fix_board_merge_;
+  fs["pose_graph_refinement"] >> pose_graph_refinement_;
+  if (!fs["pose_graph_translation_weight"].empty())
+    fs["pose_graph_translation_weight"] >> pose_graph_translation_weight_;
+  fs["solver_telemetry"] >> solver_telemetry_;
+  fs["silent_solver"] >> silent_solver_;
+  fs["trace_events"] >> trace_events_;
+  fs["perf_counters"] >> perf_counters_;
+  fs["serial_pipeline"] >> serial_pipeline_;
+  fs["checkpoint_stages"] >> checkpoint_stages_;
+  fs["replaced_cameras"] >> replaced_cameras_;
+  fs["session_window"] >> session_window_;
+  fs["session_keyframe_motion"] >> session_keyframe_motion_;
+
   fs.release(); // close the input file
 
+  // Detection parameters (shared by the concurrent detections)
+  charuco_params_->adaptiveThreshConstant = 1;
+
+  // Prepare the threads shared by the refinement stages
+  int nb_thread = nb_thread_;
+  if (nb_thread <= 0)
+    nb_thread = std::max(int(std::thread::hardware_concurrency()), 1);
+  thread_pool_ = std::make_shared<ThreadPool>(nb_thread);
+
+  // OpenCV stays within the threads of the pool (the stages of the pipeline
+  // set the budget of each stage, see addCalibrationStages)
+  cv::setNumThreads(thread_pool_->getNbThreads());
+
+  // Storage of all the parameter blocks (poses and intrinsics)
+  parameter_arena_ = std::make_shared<ParameterArena>();
+
   // Check if multi-size boards are used or not
   if (boards_index.size() != 0) {
     nb_board_ = boards_index.size();
@@ -72,13 +110,38 @@ void Calibration::initialization(std::string config_path) {
   LOG_INFO << "Nb of cameras : " << nb_camera_
            << "   Nb of Boards : " << nb_board_
            << "   Refined Corners : " << refine_corner_
-           << "   Distortion mode : " << distortion_model;
+           << "   Distortion mode : " << distortion_model
+           << "   Nb of threads : " << thread_pool_->getNbThreads();
 
   // check if the save dir exist and create it if it does not
   if (!boost::filesystem::exists(save_path_)) {
     boost::filesystem::create_directories(save_path_);
   }
 
+  // Check the stages followed by a checkpoint
+  const std::vector<std::string> &checkpoint_order = getCheckpointStages();
+  for (const std::string &stage : checkpoint_stages_)
+    if (std::find(checkpoint_order.begin(), checkpoint_order.end(), stage) ==
+        checkpoint_order.end())
+      LOG_WARNING << "No checkpoint can be saved after the stage " << stage;
+
+  // Record the iterations of the refinements
+  SolverTelemetry::get().setProgressToStdout(silent_solver_ == 0);
+  if (solver_telemetry_ == 1)
+    SolverTelemetry::get().open(save_path_ + "solver_telemetry.jsonl");
+  else
+    SolverTelemetry::get().close();
+
+  // Record the timeline of the calibration (written by closeTrace)
+  if (trace_events_ == 1)
+    TraceSink::get().open(save_path_ + "trace_events.json");
+
+  // Count the hardware events of the stages (if the platform allows it)
+  if (perf_counters_ == 1)
+    PerfCounters::get().enable();
+  else
+    PerfCounters::get().disable();
+
   // prepare the distortion type per camera
   if (distortion_per_camera.size() == 0) {
     for (int i = 0; i < nb_camera_; i++)
@@ -87,7 +150,8 @@ void Calibration::initialization(std::string config_path) {
 
   // Initialize Cameras
   for (int i = 0; i < nb_camera_; i++) {
-    std::shared_ptr<Camera> new_cam = std::make_shared<Camera>();
+    std::shared_ptr<Camera> new_cam =
+        std::make_shared<Camera>(parameter_arena_);
     new_cam->cam_idx_ = i;
     new_cam->distortion_model_ = distortion_per_camera[i];
     cams_[i] = new_cam;
@@ -140,55 +204,294 @@ void Calibration::initialization(std::string config_path) {
   }
 }
 
+/**
+ * @brief Add the stages of the calibration to a pipeline
+ *
+ * The board detection and the initialization of the intrinsics are done per
+ * camera, so a camera can be initialized while the images of the next ones
+ * are still processed. The boards are inserted camera after camera to keep
+ * the indices of the observations independent of the scheduling. The
+ * following stages use all the cameras and run one after the other. A
+ * checkpoint is saved after the stages listed in checkpoint_stages_. When a
+ * previous calibration is updated (loadPreviousCalibration), only the new
+ * observations are detected, initialized and refined before the final
+ * refinement.
+ *
+ * @param pipeline pipeline receiving the stages
+ * @param resume_from first stage to run, the state of the previous stages
+ * must have been loaded with resumeCalibration (empty to run all the stages)
+ *
+ * @return index of the last stage (reprojection error of the camera groups)
+ */
+int Calibration::addCalibrationStages(Pipeline &pipeline,
+                                      std::string resume_from) {
+  const std::vector<std::string> &checkpoint_order = getCheckpointStages();
+  const std::string first_stage_name =
+      incremental_ ? "final_refinement" : resume_from;
+  const int first_stage =
+      first_stage_name.empty()
+          ? 0
+          : std::find(checkpoint_order.begin(), checkpoint_order.end(),
+                      first_stage_name) -
+                checkpoint_order.begin();
+
+  // The number of threads of OpenCV is global, it follows the thread budget
+  // of the stages as they start
+  pipeline.setStageThreads(
+      [](int nb_threads) { cv::setNumThreads(nb_threads); });
+
+  // Add a stage after the previous one (unless it is before the resumed
+  // stage) and the checkpoint following it if requested
+  std::vector<int> previous;
+  auto add_serial_stage = [&](std::string name, std::function<void()> job) {
+    const int order =
+        std::find(checkpoint_order.begin(), checkpoint_order.end(), name) -
+        checkpoint_order.begin();
+    if (order < first_stage)
+      return;
+    if (job)
+      previous = {pipeline.addStage(name, job, previous)};
+    if (std::find(checkpoint_stages_.begin(), checkpoint_stages_.end(),
+                  name) != checkpoint_stages_.end())
+      previous = {pipeline.addStage(
+          "save_checkpoint_" + name, [this, name]() { saveCheckpoint(name); },
+          previous)};
+  };
+
+  if (resume_from.empty()) {
+    // Boards detected by each camera, waiting for their insertion
+    std::shared_ptr<std::vector<std::vector<BoardDetection>>> detections =
+        std::make_shared<std::vector<std::vector<BoardDetection>>>(
+            nb_camera_);
+
+    // Board extraction
+    std::vector<int> insertion_stages;
+    for (int cam = 0; cam < nb_camera_; cam++) {
+      std::string cam_name = std::to_string(cam);
+      int detection_stage = pipeline.addStage(
+          "board_detection_cam_" + cam_name, [this, detections, cam]() {
+            detectCameraBoards(cam, detections->at(cam));
+          });
+      std::vector<int> dependencies = {detection_stage};
+      if (!insertion_stages.empty())
+        dependencies.push_back(insertion_stages.back());
+      insertion_stages.push_back(pipeline.addStage(
+          "board_insertion_cam_" + cam_name,
+          [this, detections, cam]() {
+            insertBoardDetections(detections->at(cam));
+            detections->at(cam).clear();
+            if (cam == nb_camera_ - 1)
+              LOG_INFO << "Board extraction done!";
+          },
+          dependencies));
+    }
+
+    // Initialization of the intrinsics of the cameras (with preloaded
+    // intrinsics or for the cameras of a previous calibration, the poses of
+    // the boards are already estimated by the detection stages)
+    previous = insertion_stages;
+    if (!hasPreloadedIntrinsics()) {
+      for (int cam = 0; cam < nb_camera_; cam++) {
+        if (calibrated_cameras_.count(cam) > 0)
+          continue;
+        previous[cam] = pipeline.addStage(
+            "intrinsic_initialization_cam_" + std::to_string(cam),
+            [this, cam]() {
+              initializeCalibrationCam(cam);
+              estimatePoseCamBoards(cam);
+            },
+            {insertion_stages[cam]});
+      }
+    }
+    if (incremental_) {
+      // Only the new observations are initialized and refined
+      previous = {pipeline.addStage(
+          "incremental_initialization",
+          [this]() { initIncrementalCalibration(); }, previous)};
+      previous = {pipeline.addStage(
+          "incremental_refinement",
+          [this]() { refineIncrementalCalibration(); }, previous)};
+    } else {
+      add_serial_stage("board_extraction", nullptr);
+    }
+  }
+
+  // Intrinsic calibration of the cameras
+  add_serial_stage("intrinsic_calibration", [this]() {
+    LOG_INFO << "Intrinsic calibration initiated";
+    refineIntrinsic();
+    LOG_INFO << "Intrinsic Calibration done!";
+  });
+
+  // Calibrate 3D Objects
+  add_serial_stage("3d_object_calibration", [this]() {
+    LOG_INFO << "3D Object calibration initiated";
+    calibrate3DObjects();
+    LOG_INFO << "3D Object calibration done!";
+  });
+
+  // Calibrate camera groups
+  add_serial_stage("camera_group_calibration", [this]() {
+    LOG_INFO << "Camera group calibration initiated";
+    calibrateCameraGroup();
+    LOG_INFO << "Camera group calibration done!";
+  });
+
+  // Merge objects again to deal with boards visible simultaneously from camera
+  // groups
+  add_serial_stage("merge_3d_objects", [this]() { merge3DObjects(); });
+
+  // Calibrate Non-Overlapping cameras
+  add_serial_stage("non_overlapping_calibration", [this]() {
+    LOG_INFO << "Non-overlapping calibration initiated";
+    findPairObjectForNonOverlap();
+    findPoseNoOverlapAllCamGroup();
+    LOG_INFO << "Non-overlapping calibration done!";
+  });
+
+  // Merge camera groups and objects
+  add_serial_stage("merge_cameras_and_objects", [this]() {
+    LOG_INFO << "Merge cameras and objets initiated";
+    initInterCamGroupGraph();
+    mergeCameraGroup();
+    mergeAllCameraGroupObs();
+    merge3DObjects();
+    initInterCamGroupGraph();
+    mergeCameraGroup();
+    mergeAllCameraGroupObs();
+    estimatePoseAllObjects();
+    computeAllObjPoseInCameraGroup();
+    LOG_INFO << "Merge cameras and objets done!";
+  });
+
+  // Final Optimization (the problem is built once and reused by the two
+  // refinements)
+  add_serial_stage("final_refinement", [this]() { finalRefinement(); });
+
+  add_serial_stage("reprojection_error", [this]() {
+    reproErrorAllCamGroup();
+    LOG_INFO << "Final refinement done";
+  });
+  return previous.empty() ? -1 : previous.back();
+}
+
 /**
  * @brief Extract necessary boards info from initialized paths
  *
  */
 void Calibration::boardExtraction() {
+  // iterate through the cameras
+  for (int cam = 0; cam < nb_camera_; cam++) {
+    std::vector<BoardDetection> detections;
+    detectCameraBoards(cam, detections);
+    insertBoardDetections(detections);
+  }
+}
+
+/**
+ * @brief Get the images of a camera
+ *
+ * @param cam_idx camera index
+ *
+ * @return path of the images with an allowed extension
+ */
+std::vector<cv::String> Calibration::getCameraImages(int cam_idx) {
   std::unordered_set<cv::String> allowed_exts = {"jpg",  "png", "bmp",
                                                  "jpeg", "jp2", "tiff"};
 
-  // iterate through the cameras
-  for (int cam = 0; cam < nb_camera_; cam++) {
-    // prepare the folder's name
-    std::stringstream ss;
-    ss << std::setw(3) << std::setfill('0') << cam + 1;
-    std::string cam_nb = ss.str();
-    std::string cam_path = root_dir_ + cam_prefix_ + cam_nb;
-    LOG_INFO << "Extraction camera " << cam_nb;
-
-    // iterate through the images for corner extraction
-    std::vector<cv::String> fn;
-    cv::glob(cam_path + "/*.*", fn, true);
-
-    // filter based on allowed extensions
-    std::vector<cv::String> fn_filtered;
-    for (cv::String cur_path : fn) {
-      std::size_t ext_idx = cur_path.find_last_of(".");
-      cv::String cur_ext = cur_path.substr(ext_idx + 1);
-      if (allowed_exts.find(cur_ext) != allowed_exts.end()) {
-        fn_filtered.push_back(cur_path);
-      }
+  // prepare the folder's name
+  std::stringstream ss;
+  ss << std::setw(3) << std::setfill('0') << cam_idx + 1;
+  std::string cam_nb = ss.str();
+  std::string cam_path = root_dir_ + cam_prefix_ + cam_nb;
+  LOG_INFO << "Extraction camera " << cam_nb;
+
+  // iterate through the images for corner extraction
+  std::vector<cv::String> fn;
+  cv::glob(cam_path + "/*.*", fn, true);
+
+  // filter based on allowed extensions
+  std::vector<cv::String> fn_filtered;
+  for (cv::String cur_path : fn) {
+    std::size_t ext_idx = cur_path.find_last_of(".");
+    cv::String cur_ext = cur_path.substr(ext_idx + 1);
+    if (allowed_exts.find(cur_ext) != allowed_exts.end()) {
+      fn_filtered.push_back(cur_path);
+    }
+  }
+  return fn_filtered;
+}
+
+/**
+ * @brief Detect the boards in all the images of a camera
+ *
+ * The data structures are not modified (except the image size and the
+ * intrinsics of the camera), so the cameras can be processed concurrently.
+ * When the intrinsics are loaded from cam_params_path_, the pose of each
+ * board is estimated as soon as it is detected. For the cameras of a
+ * previous calibration, only the images added since are detected and the
+ * poses are estimated with the calibrated intrinsics.
+ *
+ * @param cam_idx camera index
+ * @param detections boards detected in the images of the camera
+ */
+void Calibration::detectCameraBoards(int cam_idx,
+                                     std::vector<BoardDetection> &detections) {
+  const bool calibrated = calibrated_cameras_.count(cam_idx) > 0;
+  const bool estimate_pose = calibrated || hasPreloadedIntrinsics();
+  if (!calibrated && hasPreloadedIntrinsics())
+    initializeCalibrationCam(cam_idx);
+
+  std::vector<cv::String> fn = getCameraImages(cam_idx);
+  size_t count_frame =
+      fn.size(); // number of allowed image files in images folder
+  size_t first_frame = calibrated ? cams_.at(cam_idx)->nb_images_ : 0;
+  cams_.at(cam_idx)->nb_images_ = count_frame;
+  for (size_t frameind = first_frame; frameind < count_frame;
+       frameind = frameind + 1) {
+    // open Image
+    cv::Mat currentIm;
+    {
+      TraceScope trace("read_image", "detection");
+      trace.addArg("camera", cam_idx);
+      trace.addArg("frame", frameind);
+      currentIm = cv::imread(fn[frameind]);
     }
-    fn = fn_filtered;
-
-    size_t count_frame =
-        fn.size(); // number of allowed image files in images folder
-    for (size_t frameind = 0; frameind < count_frame; frameind = frameind + 1) {
-      // open Image
-      cv::Mat currentIm = cv::imread(fn[frameind]);
-      std::string frame_path = fn[frameind];
-      // detect the checkerboard on this image
-      LOG_DEBUG << "Frame index :: " << frameind;
-      detectBoards(currentIm, cam, frameind, frame_path);
-      LOG_DEBUG << frameind;
-      // displayBoards(currentIm, cam, frameind); // Display frame
+    std::string frame_path = fn[frameind];
+    // detect the checkerboard on this image
+    LOG_DEBUG << "Frame index :: " << frameind;
+    {
+      TraceScope trace("detect_boards", "detection");
+      trace.addArg("camera", cam_idx);
+      trace.addArg("frame", frameind);
+      PerfScope perf("detect_boards");
+      detectBoards(currentIm, cam_idx, frameind, frame_path, detections,
+                   estimate_pose);
     }
+    LOG_DEBUG << frameind;
+    // displayBoards(currentIm, cam, frameind); // Display frame
   }
 }
 
 /**
- * @brief Detect boards on an image
+ * @brief Insert detected boards in the data structures
+ *
+ * @param detections boards to be inserted (in their order of detection)
+ */
+void Calibration::insertBoardDetections(
+    const std::vector<BoardDetection> &detections) {
+  for (const BoardDetection &detection : detections) {
+    if (detection.board_obs)
+      insertNewBoard(detection.board_obs, detection.frame_path);
+    else
+      insertNewBoard(detection.cam_idx, detection.frame_idx,
+                     detection.board_idx, detection.pts_2d,
+                     detection.charuco_idx, detection.frame_path);
+  }
+}
+
+/**
+ * @brief Detect boards on an image and insert them in the data structures
  *
  * @param image Image on which we would like to detect the board
  * @param cam_idx camera index which acquire the frame
@@ -196,13 +499,32 @@ void Calibration::boardExtraction() {
  */
 void Calibration::detectBoards(cv::Mat image, int cam_idx, int frame_idx,
                                std::string frame_path) {
+  std::vector<BoardDetection> detections;
+  detectBoards(image, cam_idx, frame_idx, frame_path, detections);
+  insertBoardDetections(detections);
+}
+
+/**
+ * @brief Detect boards on an image
+ *
+ * @param image Image on which we would like to detect the board
+ * @param cam_idx camera index which acquire the frame
+ * @param frame_idx frame index
+ * @param detections list receiving the boards passing the checks
+ * @param estimate_pose create the observations of the boards and estimate
+ * their pose (the intrinsics of the camera must be initialized)
+ */
+void Calibration::detectBoards(cv::Mat image, int cam_idx, int frame_idx,
+                               std::string frame_path,
+                               std::vector<BoardDetection> &detections,
+                               bool estimate_pose) {
   // Greyscale image for subpixel refinement
   cv::Mat graymat;
   cv::cvtColor(image, graymat, cv::COLOR_BGR2GRAY);
 
   // Initialize image size
-  cams_[cam_idx]->im_cols_ = graymat.cols;
-  cams_[cam_idx]->im_rows_ = graymat.rows;
+  cams_.at(cam_idx)->im_cols_ = graymat.cols;
+  cams_.at(cam_idx)->im_rows_ = graymat.rows;
 
   // Datastructure to save the checkerboard corners
   std::map<int, std::vector<int>>
@@ -215,8 +537,6 @@ void Calibration::detectBoards(cv::Mat image, int cam_idx, int frame_idx,
   std::map<int, std::vector<int>>
       charuco_idx; // key == board id, value == ID corners on checkerboard
 
-  charuco_params_->adaptiveThreshConstant = 1;
-
   for (int i = 0; i < nb_board_; i++) {
     cv::aruco::detectMarkers(image, boards_3d_[i]->charuco_board_->dictionary,
                              marker_corners[i], marker_idx[i],
@@ -234,8 +554,11 @@ void Calibration::detectBoards(cv::Mat image, int cam_idx, int frame_idx,
       // Refine the detected corners
       if (refine_corner_ == true) {
         std::vector<SaddlePoint> refined;
-        saddleSubpixelRefinement(graymat, charuco_corners[i], refined,
-                                 corner_ref_window_, corner_ref_max_iter_);
+        {
+          PerfScope perf("saddle_refinement");
+          saddleSubpixelRefinement(graymat, charuco_corners[i], refined,
+                                   corner_ref_window_, corner_ref_max_iter_);
+        }
         for (int j = 0; j < charuco_corners[i].size(); j++) {
           if (isinf(refined[j].x) || isinf(refined[j].y)) {
             break;
@@ -261,9 +584,21 @@ void Calibration::detectBoards(cv::Mat image, int cam_idx, int frame_idx,
       // Add the board to the datastructures (if it passes the collinearity check)
       if ((residual>boards_3d_[i]->square_size_*0.1) &  (charuco_corners[i].size()>4))
       {
-        int board_idx = i;
-        insertNewBoard(cam_idx, frame_idx, board_idx, charuco_corners[board_idx],
-                     charuco_idx[board_idx], frame_path);
+        BoardDetection detection;
+        detection.cam_idx = cam_idx;
+        detection.frame_idx = frame_idx;
+        detection.board_idx = i;
+        detection.pts_2d = charuco_corners[i];
+        detection.charuco_idx = charuco_idx[i];
+        detection.frame_path = frame_path;
+        if (estimate_pose) {
+          detection.board_obs = std::make_shared<BoardObs>(parameter_arena_);
+          detection.board_obs->init(cam_idx, frame_idx, i, charuco_corners[i],
+                                    charuco_idx[i], cams_.at(cam_idx),
+                                    boards_3d_.at(i));
+          detection.board_obs->estimatePose(ransac_thresh_);
+        }
+        detections.push_back(detection);
       }
     }
   }
@@ -422,9 +757,24 @@ void Calibration::insertNewBoard(int cam_idx, int frame_idx, int board_idx,
                                  std::vector<cv::Point2f> pts_2d,
                                  std::vector<int> charuco_idx,
                                  std::string frame_path) {
-  std::shared_ptr<BoardObs> new_board = std::make_shared<BoardObs>();
+  std::shared_ptr<BoardObs> new_board =
+      std::make_shared<BoardObs>(parameter_arena_);
   new_board->init(cam_idx, frame_idx, board_idx, pts_2d, charuco_idx,
                   cams_[cam_idx], boards_3d_[board_idx]);
+  insertNewBoard(new_board, frame_path);
+}
+
+/**
+ * @brief Update the data structure with an initialized board observation
+ *
+ * @param new_board observation of the board
+ * @param frame_path path of the image in which the board was detected
+ */
+void Calibration::insertNewBoard(std::shared_ptr<BoardObs> new_board,
+                                 std::string frame_path) {
+  const int cam_idx = new_board->camera_id_;
+  const int frame_idx = new_board->frame_id_;
+  const int board_idx = new_board->board_id_;
 
   // Add new board in the board list
   board_observations_[board_observations_.size()] = new_board;
@@ -480,6 +830,15 @@ void Calibration::insertNewObjectObservation(
   object_observations_[object_observations_.size()] = new_obj_obs;
 }
 
+/**
+ * @brief Check if the intrinsics are loaded from cam_params_path_
+ *
+ * @return true if the cameras are initialized with precalibrated intrinsics
+ */
+bool Calibration::hasPreloadedIntrinsics() {
+  return !cam_params_path_.empty() && cam_params_path_ != "None";
+}
+
 /**
  * @brief Initialize the calibration of all the cameras individually
  *
@@ -489,32 +848,41 @@ void Calibration::insertNewObjectObservation(
  *
  */
 void Calibration::initializeCalibrationAllCam() {
-  if (!cam_params_path_.empty() & cam_params_path_ != "None") {
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
+       it != cams_.end(); ++it)
+    initializeCalibrationCam(it->first);
+}
+
+/**
+ * @brief Initialize the calibration of one camera
+ *
+ * It only uses the boards observed by this camera, so the cameras can be
+ * initialized concurrently.
+ *
+ * @param cam_idx camera index
+ */
+void Calibration::initializeCalibrationCam(int cam_idx) {
+  std::shared_ptr<Camera> cam = cams_.at(cam_idx);
+  if (hasPreloadedIntrinsics()) {
     cv::FileStorage fs;
     fs.open(cam_params_path_, cv::FileStorage::READ);
 
-    LOG_INFO << "Initializing camera calibration from " << cam_params_path_;
+    LOG_INFO << "Initializing camera " << cam_idx << " calibration from "
+             << cam_params_path_;
 
-    for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
-         it != cams_.end(); ++it) {
-      // extract camera matrix and distortion coefficients from the file
-      cv::FileNode loaded_cam_params =
-          fs["camera_" + std::to_string(it->first)];
+    // extract camera matrix and distortion coefficients from the file
+    cv::FileNode loaded_cam_params = fs["camera_" + std::to_string(cam_idx)];
 
-      cv::Mat camera_matrix;
-      cv::Mat distortion_coeffs;
-      loaded_cam_params["camera_matrix"] >> camera_matrix;
-      loaded_cam_params["distortion_vector"] >> distortion_coeffs;
-
-      it->second->setIntrinsics(camera_matrix, distortion_coeffs);
-    }
+    cv::Mat camera_matrix;
+    cv::Mat distortion_coeffs;
+    loaded_cam_params["camera_matrix"] >> camera_matrix;
+    loaded_cam_params["distortion_vector"] >> distortion_coeffs;
 
+    cam->setIntrinsics(camera_matrix, distortion_coeffs);
   } else {
-    LOG_INFO << "Initializing camera calibration using images";
-
-    for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
-         it != cams_.end(); ++it)
-      it->second->initializeCalibration();
+    LOG_INFO << "Initializing camera " << cam_idx
+             << " calibration using images";
+    cam->initializeCalibration();
   }
 }
 
@@ -531,15 +899,50 @@ void Calibration::estimatePoseAllBoards() {
     it->second->estimatePose(ransac_thresh_);
 }
 
+/**
+ * @brief Estimate the pose of the boards observed by one camera
+ *
+ * @param cam_idx camera index
+ */
+void Calibration::estimatePoseCamBoards(int cam_idx) {
+  std::shared_ptr<Camera> cam = cams_.at(cam_idx);
+  for (std::map<int, std::weak_ptr<BoardObs>>::iterator it =
+           cam->board_observations_.begin();
+       it != cam->board_observations_.end(); ++it) {
+    std::shared_ptr<BoardObs> board_obs = it->second.lock();
+    if (board_obs)
+      board_obs->estimatePose(ransac_thresh_);
+  }
+}
+
+/**
+ * @brief Refine the intrinsic parameters once all the boards' poses are
+ * estimated
+ *
+ */
+void Calibration::refineIntrinsic() {
+  // The outliers have been removed, the observations can be stored
+  observation_store_.initBoardObservations(board_observations_, cams_);
+  if (fix_intrinsic_ == 0) {
+    refineIntrinsicAndPoseAllCam();
+  }
+  computeReproErrAllBoard();
+}
+
 /**
  * @brief Non-linear refinement of all the cameras intrinsic parameters
  * individually
  *
+ * The cameras do not share any parameter, they are refined concurrently.
  */
 void Calibration::refineIntrinsicAndPoseAllCam() {
+  std::vector<std::shared_ptr<Camera>> cams;
   for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
        it != cams_.end(); ++it)
-    it->second->refineIntrinsicCalibration(nb_iterations_);
+    cams.push_back(it->second);
+  thread_pool_->parallelFor(cams.size(), [&](int i) {
+    cams[i]->refineIntrinsicCalibration(nb_iterations_, observation_store_);
+  });
 }
 
 /**
@@ -561,102 +964,76 @@ void Calibration::computeReproErrAllBoard() {
  * relative transformation
  *
  * If two boards appears in a single image their interpose can be computed and
- * stored.
+ * stored. The images are processed by chunks in parallel, the poses of each
+ * chunk are merged in the order of the chunks.
  */
 void Calibration::computeBoardsPairPose() {
   board_pose_pairs_.clear();
+  std::vector<std::shared_ptr<CameraObs>> cams_obs;
+  cams_obs.reserve(cams_obs_.size());
   for (std::map<std::pair<int, int>, std::shared_ptr<CameraObs>>::iterator it =
            cams_obs_.begin();
-       it != cams_obs_.end(); ++it) {
-    std::shared_ptr<CameraObs> current_board = it->second;
-    std::vector<int> BoardIdx = current_board->board_idx_;
+       it != cams_obs_.end(); ++it)
+    cams_obs.push_back(it->second);
+
+  const int nb_chunks =
+      (cams_obs.size() + pair_pose_chunk_ - 1) / pair_pose_chunk_;
+  std::vector<std::map<std::pair<int, int>, PosePairAggregator>> chunk_pairs(
+      nb_chunks);
+  thread_pool_->parallelFor(nb_chunks, [&](int chunk) {
+    const int end =
+        std::min<int>((chunk + 1) * pair_pose_chunk_, cams_obs.size());
+    for (int i = chunk * pair_pose_chunk_; i < end; i++) {
+      std::shared_ptr<CameraObs> current_board = cams_obs[i];
+      if (current_board->board_idx_.size() <= 1)
+        continue; // at least two boards must be visible
 
-    if (BoardIdx.size() > 1) // if more than one board is visible
-    {
       for (std::map<int, std::weak_ptr<BoardObs>>::iterator it1 =
                current_board->board_observations_.begin();
            it1 != current_board->board_observations_.end(); ++it1) {
         int boardid1 = it1->second.lock()->board_id_;
+        Pose proj_1 = it1->second.lock()->getPose();
         for (std::map<int, std::weak_ptr<BoardObs>>::iterator it2 =
                  current_board->board_observations_.begin();
              it2 != current_board->board_observations_.end(); ++it2) {
           int boardid2 = it2->second.lock()->board_id_;
-          cv::Mat proj_1 = it1->second.lock()->getPoseMat();
           if (boardid1 != boardid2) // We do not care about the transformation
                                     // with itself ...
           {
-            cv::Mat proj_2 = it2->second.lock()->getPoseMat();
-            cv::Mat inter_board_pose = proj_2.inv() * proj_1;
+            Pose proj_2 = it2->second.lock()->getPose();
+            Pose inter_board_pose = proj_2.inverse() * proj_1;
             std::pair<int, int> cam_idx_pair =
                 std::make_pair(boardid1, boardid2);
-            board_pose_pairs_[cam_idx_pair].push_back(inter_board_pose);
-            LOG_DEBUG << "Multiple boards detected";
+            chunk_pairs[chunk][cam_idx_pair].addPose(inter_board_pose);
           }
         }
       }
     }
-  }
+  });
+  mergePosePairs(chunk_pairs, board_pose_pairs_);
+  LOG_DEBUG << "Number of pairs of boards visible simultaneously :: "
+            << board_pose_pairs_.size();
 }
 
 /**
  * @brief Compute the mean transformation between all boards' observations
  *
  * Multiple interboard pose can be computed per frames, these measurements are
- * averaged in this function.
- *
- * @todo remove dead code
+ * aggregated while they are computed (robust average of a bounded sample).
  */
 void Calibration::initInterBoardsTransform() {
   inter_board_transform_.clear();
-  for (std::map<std::pair<int, int>, std::vector<cv::Mat>>::iterator it =
+  for (std::map<std::pair<int, int>, PosePairAggregator>::iterator it =
            board_pose_pairs_.begin();
        it != board_pose_pairs_.end(); ++it) {
     std::pair<int, int> board_pair_idx = it->first;
-    std::vector<cv::Mat> board_poses_temp = it->second;
-    cv::Mat average_rotation = cv::Mat::zeros(3, 1, CV_64F);
-    cv::Mat average_translation = cv::Mat::zeros(3, 1, CV_64F);
-
-    // Averaging technique
-    /*for (int i = 0; i < board_poses_temp.size(); i++) {
-      cv::Mat R, T;
-      Proj2RT(board_poses_temp[i], R, T);
-      average_rotation += R;
-      average_translation += T;
-    }
     LOG_DEBUG << "Number images where the 2 boards appear :: "
-             << board_poses_temp.size()  ;
-    average_translation = average_translation / board_poses_temp.size();
-    average_rotation = average_rotation / board_poses_temp.size();*/
-
-    // Median
-    std::vector<double> r1, r2, r3;
-    std::vector<double> t1, t2, t3;
-    for (int i = 0; i < board_poses_temp.size(); i++) {
-      cv::Mat R, T;
-      Proj2RT(board_poses_temp[i], R, T);
-      r1.push_back(R.at<double>(0));
-      r2.push_back(R.at<double>(1));
-      r3.push_back(R.at<double>(2));
-      t1.push_back(T.at<double>(0));
-      t2.push_back(T.at<double>(1));
-      t3.push_back(T.at<double>(2));
-    }
-    average_rotation.at<double>(0) = median(r1);
-    average_rotation.at<double>(1) = median(r2);
-    average_rotation.at<double>(2) = median(r3);
-    average_translation.at<double>(0) = median(t1);
-    average_translation.at<double>(1) = median(t2);
-    average_translation.at<double>(2) = median(t3);
-    // TEST
-    /* cv::Mat R, T;
-     Proj2RT(board_poses_temp[0], R, T);
-     average_translation = T;
-     average_rotation = R;*/
-    //
-    inter_board_transform_[board_pair_idx] =
-        RVecT2Proj(average_rotation, average_translation);
-    LOG_DEBUG << "Average Rot :: " << average_rotation
-              << "    Average Trans :: " << average_translation;
+              << it->second.getNbPoses();
+    Pose average_pose = it->second.getAveragePose();
+    inter_board_transform_[board_pair_idx] = average_pose;
+    LOG_DEBUG << "Average Rot :: " << average_pose.getRotVec().transpose()
+              << "    Average Trans :: "
+              << average_pose.translation_.transpose();
   }
 }
 
@@ -676,13 +1053,12 @@ void Calibration::initInterBoardsGraph() {
     }
   }
 
-  for (std::map<std::pair<int, int>, std::vector<cv::Mat>>::iterator it =
+  for (std::map<std::pair<int, int>, PosePairAggregator>::iterator it =
            board_pose_pairs_.begin();
        it != board_pose_pairs_.end(); ++it) {
     std::pair<int, int> board_pair_idx = it->first;
-    std::vector<cv::Mat> board_poses_temp = it->second;
     covis_boards_graph_.addEdge(board_pair_idx.first, board_pair_idx.second,
-                                ((double)1 / board_poses_temp.size()));
+                                ((double)1 / it->second.getNbPoses()));
   }
 }
 
@@ -712,54 +1088,50 @@ void Calibration::init3DObjects() {
 
     // Declare a new 3D object
     std::shared_ptr<Object3D> newObject3D =
-        std::make_shared<Object3D>(); // declare new object 3D in heap
+        std::make_shared<Object3D>(parameter_arena_); // new object 3D
     newObject3D->initializeObject3D(connect_comp[i].size(), ref_board_id, i,
                                     boards_3d_[ref_board_id]->color_);
-    int pts_count = 0;
 
-    // Compute the shortest path between the reference and the other board
+    // Compute the transformation between the reference board and the other
+    // boards in the object by chaining the transformations along the shortest
+    // path tree of the reference board
+    ShortestPathTree path_tree =
+        covis_boards_graph_.shortestPathTree(ref_board_id);
+    std::map<int, Pose> board_pose_to_ref;
+    for (const int &current_board_id : path_tree.vertices_) {
+      int previous_board_id = path_tree.predecessor_[current_board_id];
+      if (current_board_id == ref_board_id) {
+        board_pose_to_ref[current_board_id] = Pose();
+        continue;
+      }
+      std::pair<int, int> board_pair_idx =
+          std::make_pair(previous_board_id, current_board_id);
+      board_pose_to_ref[current_board_id] =
+          board_pose_to_ref[previous_board_id] *
+          inter_board_transform_[board_pair_idx].inverse();
+    }
+    if (pose_graph_refinement_ == 1)
+      refinePoseGraph("pose_graph_boards_" + std::to_string(i), ref_board_id,
+                      inter_board_transform_, board_pose_pairs_, true,
+                      board_pose_to_ref);
+
     for (int j = 0; j < connect_comp[i].size(); j++) {
       int current_board_id = connect_comp[i][j];
       newObject3D->insertBoardInObject(boards_3d_[current_board_id]);
-
-      // Compute the transformation between the reference board and the other
-      // boards in the object if the board is not the referential board compute
-      // the path
-      std::vector<int> short_path = covis_boards_graph_.shortestPathBetween(
-          ref_board_id, current_board_id);
-      // Compute the transformation wrt. the reference board
-      cv::Mat transform = (cv::Mat_<double>(4, 4) << 1, 0, 0, 0, 0, 1, 0, 0, 0,
-                           0, 1, 0, 0, 0, 0,
-                           1); // initialize the transformation to identity
-      for (int k = 0; k < short_path.size() - 1; k++) {
-        int current_board = short_path[k];
-        int next_board = short_path[k + 1];
-        std::pair<int, int> board_pair_idx =
-            std::make_pair(current_board, next_board);
-        cv::Mat current_trans = inter_board_transform_[board_pair_idx];
-        transform = transform * current_trans.inv();
-      }
+      const Pose &transform = board_pose_to_ref[current_board_id];
 
       // Store the relative board transformation in the object
-      newObject3D->setBoardPoseMat(transform, current_board_id);
+      newObject3D->setBoardPose(transform, current_board_id);
 
       // Transform the 3D pts to push in the object 3D
       std::vector<cv::Point3f> trans_pts =
           transform3DPts(boards_3d_[current_board_id]->pts_3d_,
-                         newObject3D->getBoardRotVec(current_board_id),
-                         newObject3D->getBoardTransVec(current_board_id));
+                         newObject3D->getBoardPose(current_board_id));
       // Make a indexing between board to object
-      for (int k = 0; k < trans_pts.size(); k++) {
-        int char_id = k;
-        std::pair<int, int> boardid_charid =
-            std::make_pair(current_board_id, char_id);
-        newObject3D->pts_board_2_obj_[boardid_charid] = pts_count;
-        newObject3D->pts_obj_2_board_.push_back(boardid_charid);
-        newObject3D->pts_3d_.push_back(trans_pts[k]);
-        pts_count++;
-      }
+      newObject3D->insertBoardPts(current_board_id, trans_pts);
       LOG_DEBUG << "Board ID :: " << current_board_id;
     }
+    newObject3D->initializePtsTable();
     // Add the 3D object into the structure
     object_3d_[i] = newObject3D;
   }
@@ -774,22 +1146,35 @@ void Calibration::init3DObjects() {
  * @param object_idx index of the 3D object observed
  */
 void Calibration::init3DObjectObs(int object_idx) {
-
-  // Iterate through cameraobs
+  std::vector<std::pair<int, int>> cam_frame_idx;
   for (std::map<std::pair<int, int>, std::shared_ptr<CameraObs>>::iterator
            it_cam_obs = cams_obs_.begin();
-       it_cam_obs != cams_obs_.end(); ++it_cam_obs) {
-    std::pair<int, int> cam_id_frame_id =
-        it_cam_obs->first; // Cam ind/Frame ind
-    std::shared_ptr<CameraObs> current_camobs = it_cam_obs->second;
+       it_cam_obs != cams_obs_.end(); ++it_cam_obs)
+    cam_frame_idx.push_back(it_cam_obs->first);
+  init3DObjectObs(object_idx, cam_frame_idx);
+}
+
+/**
+ * @brief Initialize the observations of a 3D object in some camera observations
+ *
+ * @param object_idx index of the 3D object observed
+ * @param cam_frame_idx keys (Cam ind/Frame ind) of the camera observations
+ */
+void Calibration::init3DObjectObs(
+    int object_idx, const std::vector<std::pair<int, int>> &cam_frame_idx) {
+
+  // Iterate through cameraobs
+  for (const std::pair<int, int> &cam_id_frame_id : cam_frame_idx) {
+    std::shared_ptr<CameraObs> current_camobs = cams_obs_[cam_id_frame_id];
 
     // Declare the 3D object observed in this camera observation
     // Keep in mind that a single object can be observed in one image
-    std::shared_ptr<Object3DObs> object_obs = std::make_shared<Object3DObs>();
+    std::shared_ptr<Object3DObs> object_obs =
+        std::make_shared<Object3DObs>(parameter_arena_);
     object_obs->initializeObject(object_3d_[object_idx], object_idx);
 
     // Check the boards observing this camera
-    std::map<int, std::weak_ptr<BoardObs>> current_board_obs =
+    std::map<int, std::weak_ptr<BoardObs>> &current_board_obs =
         current_camobs->board_observations_;
     for (std::map<int, std::weak_ptr<BoardObs>>::iterator it_board_obs =
              current_board_obs.begin();
@@ -809,7 +1194,7 @@ void Calibration::init3DObjectObs(int object_idx) {
       // Update the camobs//frame//camera//3DObject
       cams_obs_[cam_id_frame_id]->insertNewObject(object_obs);
       frames_[cam_id_frame_id.second]->insertNewObject(object_obs);
-      cams_[it_cam_obs->first.first]->insertNewObject(object_obs);
+      cams_[cam_id_frame_id.first]->insertNewObject(object_obs);
       object_3d_[object_idx]->insertNewObject(object_obs);
       object_3d_[object_idx]->insertNewFrame(frames_[cam_id_frame_id.second]);
       insertNewObjectObservation(object_obs);
@@ -822,11 +1207,13 @@ void Calibration::init3DObjectObs(int object_idx) {
  *
  */
 void Calibration::initAll3DObjectObs() {
+  PerfScope perf("init_object_observations");
   for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
            object_3d_.begin();
        it != object_3d_.end(); ++it) {
     this->init3DObjectObs(it->first);
   }
+  observation_store_.updateObjectObservations(object_3d_, object_observations_);
 }
 
 /**
@@ -860,114 +1247,96 @@ void Calibration::computeReproErrAllObject() {
 /**
  * @brief Refine the structure of all the 3D objects
  *
+ * The objects do not share any parameter, they are refined concurrently.
  */
 void Calibration::refineAllObject3D() {
+  std::vector<std::shared_ptr<Object3D>> objects;
   for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
            object_3d_.begin();
        it != object_3d_.end(); ++it)
-    it->second->refineObject(nb_iterations_);
+    objects.push_back(it->second);
+  thread_pool_->parallelFor(objects.size(), [&](int i) {
+    objects[i]->refineObject(nb_iterations_, observation_store_);
+  });
 }
 
 /**
  * @brief Find all view where multiple camera share visible objects and store
  * their relative transformation
  *
+ * The frames are processed by chunks in parallel, the poses of each chunk are
+ * merged in the order of the chunks.
  */
 void Calibration::computeCamerasPairPose() {
   camera_pose_pairs_.clear();
-  // Iterate through frames
+  std::vector<std::shared_ptr<Frame>> frames;
+  frames.reserve(frames_.size());
   for (std::map<int, std::shared_ptr<Frame>>::iterator it_frame =
            frames_.begin();
-       it_frame != frames_.end(); ++it_frame) {
-    if (it_frame->second->board_observations_.size() >
-        1) // if more than one observation is available
-    {
+       it_frame != frames_.end(); ++it_frame)
+    frames.push_back(it_frame->second);
+
+  const int nb_chunks =
+      (frames.size() + pair_pose_chunk_ - 1) / pair_pose_chunk_;
+  std::vector<std::map<std::pair<int, int>, PosePairAggregator>> chunk_pairs(
+      nb_chunks);
+  thread_pool_->parallelFor(nb_chunks, [&](int chunk) {
+    const int end =
+        std::min<int>((chunk + 1) * pair_pose_chunk_, frames.size());
+    for (int i = chunk * pair_pose_chunk_; i < end; i++) {
+      // if more than one observation is available
+      if (frames[i]->board_observations_.size() <= 1)
+        continue;
+
       // Iterate through the object observation
-      std::map<int, std::weak_ptr<Object3DObs>> frame_obj_obs =
-          it_frame->second->object_observations_;
+      std::map<int, std::weak_ptr<Object3DObs>> &frame_obj_obs =
+          frames[i]->object_observations_;
       for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_objectobs1 =
                frame_obj_obs.begin();
            it_objectobs1 != frame_obj_obs.end(); ++it_objectobs1) {
         int cam_id_1 = it_objectobs1->second.lock()->camera_id_;
         int obj_id_1 = it_objectobs1->second.lock()->object_3d_id_;
-        cv::Mat pose_cam_1 = it_objectobs1->second.lock()->getPoseMat();
+        Pose pose_cam_1 = it_objectobs1->second.lock()->getPose();
         for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_objectobs2 =
                  frame_obj_obs.begin();
              it_objectobs2 != frame_obj_obs.end(); ++it_objectobs2) {
           int cam_id_2 = it_objectobs2->second.lock()->camera_id_;
           int obj_id_2 = it_objectobs2->second.lock()->object_3d_id_;
-          cv::Mat pose_cam_2 = it_objectobs2->second.lock()->getPoseMat();
-          if (cam_id_1 != cam_id_2) // if the camera is not the same
-          {
-            // if the same object is visible from the two cameras
-            if (obj_id_1 == obj_id_2) {
-              // Compute the relative pose between the cameras
-              cv::Mat inter_cam_pose =
-                  pose_cam_2 * pose_cam_1.inv(); // not sure here ...
-
-              // Store in a database
-              camera_pose_pairs_[std::make_pair(cam_id_1, cam_id_2)].push_back(
-                  inter_cam_pose);
-            }
+          // if the camera is not the same and the same object is visible from
+          // the two cameras
+          if (cam_id_1 != cam_id_2 && obj_id_1 == obj_id_2) {
+            // Compute the relative pose between the cameras
+            Pose pose_cam_2 = it_objectobs2->second.lock()->getPose();
+            Pose inter_cam_pose =
+                pose_cam_2 * pose_cam_1.inverse(); // not sure here ...
+
+            // Store in a database
+            chunk_pairs[chunk][std::make_pair(cam_id_1, cam_id_2)].addPose(
+                inter_cam_pose);
           }
         }
       }
     }
-  }
+  });
+  mergePosePairs(chunk_pairs, camera_pose_pairs_);
 }
 
 /**
  * @brief Find average transformation between pairs of cameras to form groups
- *
- * @todo remove dead code
  */
 void Calibration::initInterCamerasTransform() {
   inter_camera_transform_.clear();
-  for (std::map<std::pair<int, int>, std::vector<cv::Mat>>::iterator it =
+  for (std::map<std::pair<int, int>, PosePairAggregator>::iterator it =
            camera_pose_pairs_.begin();
        it != camera_pose_pairs_.end(); ++it) {
     std::pair<int, int> camera_pair_idx = it->first;
-    std::vector<cv::Mat> camera_poses_temp = it->second;
-    cv::Mat average_rotation = cv::Mat::zeros(3, 1, CV_64F);
-    cv::Mat average_translation = cv::Mat::zeros(3, 1, CV_64F);
-
-    // Averaging technique
-    /*for (int i = 0; i < camera_poses_temp.size(); i++) {
-      cv::Mat R, T;
-      Proj2RT(camera_poses_temp[i], R, T);
-      average_rotation += R;
-      average_translation += T;
-    }
     LOG_DEBUG << "Number images where the 2 camera see the same object :: "
-             << camera_poses_temp.size()  ;
-    average_translation = average_translation / camera_poses_temp.size();
-    average_rotation = average_rotation / camera_poses_temp.size();*/
-
-    // Median technique
-    // Median
-    std::vector<double> r1, r2, r3;
-    std::vector<double> t1, t2, t3;
-    for (int i = 0; i < camera_poses_temp.size(); i++) {
-      cv::Mat R, T;
-      Proj2RT(camera_poses_temp[i], R, T);
-      r1.push_back(R.at<double>(0));
-      r2.push_back(R.at<double>(1));
-      r3.push_back(R.at<double>(2));
-      t1.push_back(T.at<double>(0));
-      t2.push_back(T.at<double>(1));
-      t3.push_back(T.at<double>(2));
-    }
-    average_rotation.at<double>(0) = median(r1);
-    average_rotation.at<double>(1) = median(r2);
-    average_rotation.at<double>(2) = median(r3);
-    average_translation.at<double>(0) = median(t1);
-    average_translation.at<double>(1) = median(t2);
-    average_translation.at<double>(2) = median(t3);
-
-    inter_camera_transform_[camera_pair_idx] =
-        RVecT2Proj(average_rotation, average_translation);
-    LOG_DEBUG << "Average Rot :: " << average_rotation
-              << "    Average Trans :: " << average_translation;
+              << it->second.getNbPoses();
+    Pose average_pose = it->second.getAveragePose();
+    inter_camera_transform_[camera_pair_idx] = average_pose;
+    LOG_DEBUG << "Average Rot :: " << average_pose.getRotVec().transpose()
+              << "    Average Trans :: "
+              << average_pose.translation_.transpose();
   }
 }
 
@@ -986,13 +1355,12 @@ void Calibration::initInterCamerasGraph() {
     }
   }
   // Build the graph with cameras' pairs
-  for (std::map<std::pair<int, int>, std::vector<cv::Mat>>::iterator it =
+  for (std::map<std::pair<int, int>, PosePairAggregator>::iterator it =
            camera_pose_pairs_.begin();
        it != camera_pose_pairs_.end(); ++it) {
     std::pair<int, int> camera_pair_idx = it->first;
-    std::vector<cv::Mat> camera_poses_temp = it->second;
     covis_camera_graph_.addEdge(camera_pair_idx.first, camera_pair_idx.second,
-                                ((double)1 / camera_poses_temp.size()));
+                                ((double)1 / it->second.getNbPoses()));
   }
 }
 
@@ -1018,33 +1386,37 @@ void Calibration::initCameraGroup() {
 
     // Declare a new camera group
     std::shared_ptr<CameraGroup> new_camera_group =
-        std::make_shared<CameraGroup>();
+        std::make_shared<CameraGroup>(parameter_arena_);
     new_camera_group->initializeCameraGroup(id_ref_cam, i);
 
-    // Compute the shortest path between the reference and the other cams
+    // Compute the transformation between the reference cam and the other
+    // cams in the group along the shortest path tree of the reference cam
+    ShortestPathTree path_tree =
+        covis_camera_graph_.shortestPathTree(id_ref_cam);
+    std::map<int, Pose> cam_pose_to_ref;
+    for (const int &current_camera_id : path_tree.vertices_) {
+      int previous_camera_id = path_tree.predecessor_[current_camera_id];
+      if (current_camera_id == id_ref_cam) {
+        cam_pose_to_ref[current_camera_id] = Pose();
+        continue;
+      }
+      std::pair<int, int> cam_pair_idx =
+          std::make_pair(previous_camera_id, current_camera_id);
+      cam_pose_to_ref[current_camera_id] =
+          cam_pose_to_ref[previous_camera_id] *
+          inter_camera_transform_[cam_pair_idx];
+    }
+    if (pose_graph_refinement_ == 1)
+      refinePoseGraph("pose_graph_cameras_" + std::to_string(i), id_ref_cam,
+                      inter_camera_transform_, camera_pose_pairs_, false,
+                      cam_pose_to_ref);
+
     for (int j = 0; j < connect_comp[i].size(); j++) {
       int current_camera_id = connect_comp[i][j];
       new_camera_group->insertCamera(cams_[current_camera_id]);
-
-      // Compute the transformation between the reference cam and the other
-      // cam in the group
-      std::vector<int> short_path = covis_camera_graph_.shortestPathBetween(
-          id_ref_cam, current_camera_id);
-      // Compute the transformation wrt. the reference camera
-      cv::Mat transform =
-          (cv::Mat_<double>(4, 4) << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0,
-           0, 1); // initialize the transformation to identity
-      for (int k = 0; k < short_path.size() - 1; k++) {
-        int current_cam = short_path[k];
-        int next_cam = short_path[k + 1];
-        std::pair<int, int> cam_pair_idx =
-            std::make_pair(current_cam, next_cam);
-        cv::Mat current_trans = inter_camera_transform_[cam_pair_idx];
-        // transform = transform * current_trans.inv();
-        transform = transform * current_trans;
-      }
       // Store the relative camera transformation in the object
-      new_camera_group->setCameraPoseMat(transform, current_camera_id);
+      new_camera_group->setCameraPose(cam_pose_to_ref[current_camera_id],
+                                      current_camera_id);
     }
     // Add the 3D camera group into the structure
     cam_group_[i] = new_camera_group;
@@ -1058,7 +1430,7 @@ void Calibration::initCameraGroup() {
  */
 void Calibration::initCameraGroupObs(int camera_group_idx) {
   // List of camera idx in the group
-  std::vector<int> cam_in_group = cam_group_[camera_group_idx]->cam_idx;
+  const std::vector<int> &cam_in_group = cam_group_[camera_group_idx]->cam_idx;
 
   // Iterate through frame
   for (std::map<int, std::shared_ptr<Frame>>::iterator it_frame =
@@ -1066,10 +1438,10 @@ void Calibration::initCameraGroupObs(int camera_group_idx) {
        it_frame != frames_.end(); ++it_frame) {
     int current_frame_id = it_frame->second->frame_idx_;
     std::shared_ptr<CameraGroupObs> new_cam_group_obs =
-        std::make_shared<CameraGroupObs>(); // declare a new observation
+        std::make_shared<CameraGroupObs>(parameter_arena_); // new observation
     new_cam_group_obs->insertCameraGroup(cam_group_[camera_group_idx]);
 
-    std::map<int, std::weak_ptr<Object3DObs>> current_object_obs =
+    std::map<int, std::weak_ptr<Object3DObs>> &current_object_obs =
         it_frame->second->object_observations_;
     for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj_obs =
              current_object_obs.begin();
@@ -1117,20 +1489,33 @@ void Calibration::initAllCameraGroupObs() {
     int camera_group_idx = it->second->cam_group_idx_;
     initCameraGroupObs(camera_group_idx);
   }
+  observation_store_.updateCameraGroupObservations(cams_group_obs_);
 }
 
 /**
  * @brief Non-linear optimization of the camera pose in the groups and the pose
  * of the observed objects
  *
+ * The boards poses in the objects are fixed, the 3D points of the objects are
+ * computed once before the refinement. The camera groups do not share any
+ * parameter in this case, they are refined concurrently.
  */
 void Calibration::refineAllCameraGroup() {
+  // Precompute the 3D points of the objects
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           object_3d_.begin();
+       it != object_3d_.end(); it++) {
+    it->second->updateObjectPts();
+  }
+
+  std::vector<std::shared_ptr<CameraGroup>> cam_groups;
   for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
            cam_group_.begin();
-       it != cam_group_.end(); ++it) {
-    // it->second->computeObjPoseInCameraGroup();
-    it->second->refineCameraGroup(nb_iterations_);
-  }
+       it != cam_group_.end(); ++it)
+    cam_groups.push_back(it->second);
+  thread_pool_->parallelFor(cam_groups.size(), [&](int i) {
+    cam_groups[i]->refineCameraGroup(nb_iterations_, observation_store_);
+  });
 
   // Update the object3D observation
   for (std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
@@ -1140,123 +1525,96 @@ void Calibration::refineAllCameraGroup() {
   }
 }
 
+/**
+ * @brief Index the frames shared by the pairs of camera groups
+ *
+ * For each (ordered) pair of camera groups observing the same frames, store the
+ * camera group observations of the two groups in every common frame (in the
+ * order of the frames). The index is built in one pass over the frames, so the
+ * work is proportional to the actual co-occurrences of the groups.
+ */
+void Calibration::initNonOverlapCommonObs() {
+  no_overlap_common_obs_.clear();
+  for (std::map<int, std::shared_ptr<Frame>>::iterator it_frame =
+           frames_.begin();
+       it_frame != frames_.end(); ++it_frame) {
+    const std::vector<int> &frame_groups = it_frame->second->cam_group_idx_;
+    std::map<int, std::weak_ptr<CameraGroupObs>> &frame_group_obs =
+        it_frame->second->cam_group_observations_;
+    for (int i = 0; i < frame_groups.size(); i++) {
+      for (int j = 0; j < frame_groups.size(); j++) {
+        if (frame_groups[i] == frame_groups[j])
+          continue;
+        // a group is only considered once per frame
+        if (std::find(frame_groups.begin(), frame_groups.begin() + i,
+                      frame_groups[i]) != frame_groups.begin() + i ||
+            std::find(frame_groups.begin(), frame_groups.begin() + j,
+                      frame_groups[j]) != frame_groups.begin() + j)
+          continue;
+        no_overlap_common_obs_[std::make_pair(frame_groups[i],
+                                              frame_groups[j])]
+            .push_back(std::make_pair(frame_group_obs[i], frame_group_obs[j]));
+      }
+    }
+  }
+}
+
 /**
  * @brief Find the pair of objects to use to calibrate the pairs of camera
  * groups
  *
  * The pair of object with the highest number of occurrences are used for
- * calibration.
+ * calibration. Only the pairs of camera groups sharing frames are considered.
  */
 void Calibration::findPairObjectForNonOverlap() {
   no_overlap_object_pair_.clear();
-  // Iterate through the camera groups
-  for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it_groups_1 =
-           cam_group_.begin();
-       it_groups_1 != cam_group_.end(); ++it_groups_1) {
-    int group_idx1 = it_groups_1->first;
-    for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it_groups_2 =
-             cam_group_.begin();
-         it_groups_2 != cam_group_.end(); ++it_groups_2) {
-      int group_idx2 = it_groups_2->first;
-      if (group_idx1 != group_idx2) // if the two groups are different
-      {
-        // Prepare the list of possible objects pairs
-        std::map<std::pair<int, int>, int> count_pair_obs;
-        for (std::map<int, std::shared_ptr<Object3D>>::iterator it_obj1 =
-                 object_3d_.begin();
-             it_obj1 != object_3d_.end(); ++it_obj1) {
-          for (std::map<int, std::shared_ptr<Object3D>>::iterator it_obj2 =
-                   object_3d_.begin();
-               it_obj2 != object_3d_.end(); ++it_obj2) {
-            int obj_id1 = it_obj1->second->obj_id_;
-            int obj_id2 = it_obj2->second->obj_id_;
-            if (obj_id1 != obj_id2) {
-              count_pair_obs[std::make_pair(obj_id1, obj_id2)] =
-                  0; // initialize the count to zero
-            }
-          }
-        }
-
-        // move to shared_ptr cause there is no = for weak_ptr
-        std::map<int, std::shared_ptr<Frame>> it_groups_1_frames;
-        std::map<int, std::shared_ptr<Frame>> it_groups_2_frames;
-        for (auto item : it_groups_1->second->frames_)
-          it_groups_1_frames[item.first] = item.second.lock();
-        for (auto item : it_groups_2->second->frames_)
-          it_groups_2_frames[item.first] = item.second.lock();
-
-        // Find frames in common
-        std::map<int, std::shared_ptr<Frame>> common_frames;
-        std::map<int, std::shared_ptr<Frame>>::iterator it_frames(
-            common_frames.begin());
-        std::set_intersection(
-            it_groups_1_frames.begin(), it_groups_1_frames.end(),
-            it_groups_2_frames.begin(), it_groups_2_frames.end(),
-            std::inserter(common_frames, it_frames));
-
-        // Iterate through the frames and count the occurrence of object pair
-        // (to select the pair of object appearing the most)
-        for (std::map<int, std::shared_ptr<Frame>>::iterator it_common_frames =
-                 common_frames.begin();
-             it_common_frames != common_frames.end(); ++it_common_frames) {
-          // Find the index of the observation corresponding to the groups in
-          // cam group obs
-          auto it_camgroupid_1 =
-              find(it_common_frames->second->cam_group_idx_.begin(),
-                   it_common_frames->second->cam_group_idx_.end(), group_idx1);
-          auto it_camgroupid_2 =
-              find(it_common_frames->second->cam_group_idx_.begin(),
-                   it_common_frames->second->cam_group_idx_.end(), group_idx2);
-          int index_camgroup_1 =
-              it_camgroupid_1 -
-              it_common_frames->second->cam_group_idx_.begin();
-          int index_camgroup_2 =
-              it_camgroupid_2 -
-              it_common_frames->second->cam_group_idx_.begin();
-
-          // Access the objects 3D index for both groups
-          std::map<int, std::weak_ptr<Object3DObs>> object_obs_1 =
-              it_common_frames->second
-                  ->cam_group_observations_[index_camgroup_1]
-                  .lock()
-                  ->object_observations_;
-          std::map<int, std::weak_ptr<Object3DObs>> object_obs_2 =
-              it_common_frames->second
-                  ->cam_group_observations_[index_camgroup_2]
-                  .lock()
-                  ->object_observations_;
-          for (std::map<int, std::weak_ptr<Object3DObs>>::iterator
-                   it_object_obs_1 = object_obs_1.begin();
-               it_object_obs_1 != object_obs_1.end(); ++it_object_obs_1) {
-            int obj_ind_1 = it_object_obs_1->second.lock()->object_3d_id_;
-            for (std::map<int, std::weak_ptr<Object3DObs>>::iterator
-                     it_object_obs_2 = object_obs_2.begin();
-                 it_object_obs_2 != object_obs_2.end(); ++it_object_obs_2) {
-              int obj_ind_2 = it_object_obs_2->second.lock()->object_3d_id_;
-              count_pair_obs[std::make_pair(obj_ind_1, obj_ind_2)]++;
-            }
-          }
-        }
-
-        // find the pair of object with the maximum shared frames
-        unsigned currentMax = 0;
-        std::pair<int, int> arg_max = std::make_pair(0, 0);
-        for (auto it = count_pair_obs.cbegin(); it != count_pair_obs.cend();
-             ++it) {
-          if (it->second > currentMax) {
-            arg_max = it->first;
-            currentMax = it->second;
-          }
+  initNonOverlapCommonObs();
+  // Iterate through the pairs of camera groups sharing frames
+  for (std::map<std::pair<int, int>,
+                std::vector<std::pair<std::weak_ptr<CameraGroupObs>,
+                                      std::weak_ptr<CameraGroupObs>>>>::
+           iterator it_pair = no_overlap_common_obs_.begin();
+       it_pair != no_overlap_common_obs_.end(); ++it_pair) {
+    // Iterate through the frames and count the occurrence of object pair
+    // (to select the pair of object appearing the most)
+    std::map<std::pair<int, int>, int> count_pair_obs;
+    for (const std::pair<std::weak_ptr<CameraGroupObs>,
+                         std::weak_ptr<CameraGroupObs>> &common_obs :
+         it_pair->second) {
+      // Access the objects 3D index for both groups
+      std::map<int, std::weak_ptr<Object3DObs>> &object_obs_1 =
+          common_obs.first.lock()->object_observations_;
+      std::map<int, std::weak_ptr<Object3DObs>> &object_obs_2 =
+          common_obs.second.lock()->object_observations_;
+      for (std::map<int, std::weak_ptr<Object3DObs>>::iterator
+               it_object_obs_1 = object_obs_1.begin();
+           it_object_obs_1 != object_obs_1.end(); ++it_object_obs_1) {
+        int obj_ind_1 = it_object_obs_1->second.lock()->object_3d_id_;
+        for (std::map<int, std::weak_ptr<Object3DObs>>::iterator
+                 it_object_obs_2 = object_obs_2.begin();
+             it_object_obs_2 != object_obs_2.end(); ++it_object_obs_2) {
+          int obj_ind_2 = it_object_obs_2->second.lock()->object_3d_id_;
+          count_pair_obs[std::make_pair(obj_ind_1, obj_ind_2)]++;
         }
+      }
+    }
 
-        // Save in the data structure
-        LOG_DEBUG << "max visibility, Object 1 :: " << arg_max.first
-                  << "Object 2 :: " << arg_max.second;
-        LOG_DEBUG << "Number of occurrence :: " << currentMax;
-        no_overlap_object_pair_[std::make_pair(group_idx1, group_idx2)] =
-            arg_max;
+    // find the pair of object with the maximum shared frames
+    unsigned currentMax = 0;
+    std::pair<int, int> arg_max = std::make_pair(0, 0);
+    for (auto it = count_pair_obs.cbegin(); it != count_pair_obs.cend();
+         ++it) {
+      if (it->second > currentMax) {
+        arg_max = it->first;
+        currentMax = it->second;
       }
     }
+
+    // Save in the data structure
+    LOG_DEBUG << "max visibility, Object 1 :: " << arg_max.first
+              << "Object 2 :: " << arg_max.second;
+    LOG_DEBUG << "Number of occurrence :: " << currentMax;
+    no_overlap_object_pair_[it_pair->first] = arg_max;
   }
 }
 
@@ -1267,10 +1625,6 @@ void Calibration::findPairObjectForNonOverlap() {
  * @todo remove dead code
  */
 void Calibration::initNonOverlapPair(int cam_group_id1, int cam_group_id2) {
-  // Prepare the group of interest
-  std::shared_ptr<CameraGroup> cam_group1 = cam_group_[cam_group_id1];
-  std::shared_ptr<CameraGroup> cam_group2 = cam_group_[cam_group_id2];
-
   // Check the object per camera
   std::pair<int, int> object_pair =
       no_overlap_object_pair_[std::make_pair(cam_group_id1, cam_group_id2)];
@@ -1280,55 +1634,24 @@ void Calibration::initNonOverlapPair(int cam_group_id1, int cam_group_id2) {
   // Prepare the 3D objects
   std::shared_ptr<Object3D> object_3D_1 = object_3d_[object_cam_1];
   std::shared_ptr<Object3D> object_3D_2 = object_3d_[object_cam_2];
-  std::vector<cv::Point3f> pts_3d_obj_1 = object_3D_1->pts_3d_;
-  std::vector<cv::Point3f> pts_3d_obj_2 = object_3D_2->pts_3d_;
 
   // std::vector to store data for non-overlapping calibration
   std::vector<cv::Mat> pose_abs_1,
       pose_abs_2; // absolute pose stored to compute relative displacements
   cv::Mat repo_obj_1_2; // reprojected pts for clustering
 
-  // move to shared_ptr cause there is no = for weak_ptr
-  std::map<int, std::shared_ptr<Frame>> cam_group1_frames;
-  std::map<int, std::shared_ptr<Frame>> cam_group2_frames;
-  for (auto item : cam_group1->frames_)
-    cam_group1_frames[item.first] = item.second.lock();
-  for (auto item : cam_group2->frames_)
-    cam_group2_frames[item.first] = item.second.lock();
-
-  // Find frames in common
-  std::map<int, std::shared_ptr<Frame>> common_frames;
-  std::map<int, std::shared_ptr<Frame>>::iterator it_frames(
-      common_frames.begin());
-  std::set_intersection(cam_group1_frames.begin(), cam_group1_frames.end(),
-                        cam_group2_frames.begin(), cam_group2_frames.end(),
-                        std::inserter(common_frames, it_frames));
-
-  // Iterate through common frames and reproject the objects in the images to
-  // cluster
-  for (std::map<int, std::shared_ptr<Frame>>::iterator it_common_frames =
-           common_frames.begin();
-       it_common_frames != common_frames.end(); ++it_common_frames) {
-    // Find the index of the observation corresponding to the groups in cam
-    // group obs
-    auto it_camgroupid_1 =
-        find(it_common_frames->second->cam_group_idx_.begin(),
-             it_common_frames->second->cam_group_idx_.end(), cam_group_id1);
-    auto it_camgroupid_2 =
-        find(it_common_frames->second->cam_group_idx_.begin(),
-             it_common_frames->second->cam_group_idx_.end(), cam_group_id2);
-    int index_camgroup_1 =
-        it_camgroupid_1 - it_common_frames->second->cam_group_idx_.begin();
-    int index_camgroup_2 =
-        it_camgroupid_2 - it_common_frames->second->cam_group_idx_.begin();
-
+  // Iterate through common frames and collect the poses of the objects
+  const std::vector<std::pair<std::weak_ptr<CameraGroupObs>,
+                              std::weak_ptr<CameraGroupObs>>> &common_obs =
+      no_overlap_common_obs_[std::make_pair(cam_group_id1, cam_group_id2)];
+  for (int i = 0; i < common_obs.size(); i++) {
     // check if both objects of interest are in the frame
-    std::weak_ptr<CameraGroupObs> cam_group_obs1 =
-        it_common_frames->second->cam_group_observations_[index_camgroup_1];
-    std::weak_ptr<CameraGroupObs> cam_group_obs2 =
-        it_common_frames->second->cam_group_observations_[index_camgroup_2];
-    std::vector<int> cam_group_obs_obj1 = cam_group_obs1.lock()->object_idx_;
-    std::vector<int> cam_group_obs_obj2 = cam_group_obs2.lock()->object_idx_;
+    std::weak_ptr<CameraGroupObs> cam_group_obs1 = common_obs[i].first;
+    std::weak_ptr<CameraGroupObs> cam_group_obs2 = common_obs[i].second;
+    const std::vector<int> &cam_group_obs_obj1 =
+        cam_group_obs1.lock()->object_idx_;
+    const std::vector<int> &cam_group_obs_obj2 =
+        cam_group_obs2.lock()->object_idx_;
     auto it1 = find(cam_group_obs_obj1.begin(), cam_group_obs_obj1.end(),
                     object_cam_1);
     auto it2 = find(cam_group_obs_obj2.begin(), cam_group_obs_obj2.end(),
@@ -1340,20 +1663,6 @@ void Calibration::initNonOverlapPair(int cam_group_id1, int cam_group_id2) {
 
     // if both objects are visible
     if (obj_vis1 & obj_vis2) {
-      // Reproject 3D objects in ref camera group
-      std::weak_ptr<Camera> ref_cam_1 =
-          cam_group_obs1.lock()
-              ->cam_group_.lock()
-              ->cameras_[cam_group_obs1.lock()->cam_group_.lock()->id_ref_cam_];
-      std::weak_ptr<Camera> ref_cam_2 =
-          cam_group_obs2.lock()
-              ->cam_group_.lock()
-              ->cameras_[cam_group_obs2.lock()->cam_group_.lock()->id_ref_cam_];
-      cv::Mat cam_mat_1, dist_1;
-      cv::Mat cam_mat_2, dist_2;
-      ref_cam_1.lock()->getIntrinsics(cam_mat_1, dist_1);
-      ref_cam_2.lock()->getIntrinsics(cam_mat_2, dist_2);
-
       int object_id1 = cam_group_obs1.lock()
                            ->object_observations_[index_objobs_1]
                            .lock()
@@ -1382,10 +1691,9 @@ void Calibration::initNonOverlapPair(int cam_group_id1, int cam_group_id2) {
     pose_g1_g2 = handeyeCalibration(pose_abs_1, pose_abs_2);
   }
 
-  pose_g1_g2 = pose_g1_g2.inv();
   // Save the parameter in the datastructure
   no_overlap_camgroup_pair_pose_[std::make_pair(cam_group_id1, cam_group_id2)] =
-      pose_g1_g2;
+      Pose::fromMat(pose_g1_g2).inverse();
   no_overlap__camgroup_pair_common_cnt_[std::make_pair(
       cam_group_id1, cam_group_id2)] = pose_abs_1.size();
 }
@@ -1395,22 +1703,15 @@ void Calibration::initNonOverlapPair(int cam_group_id1, int cam_group_id2) {
  */
 void Calibration::findPoseNoOverlapAllCamGroup() {
   no_overlap_camgroup_pair_pose_.clear();
-  no_overlap_camgroup_pair_pose_.clear();
+  no_overlap__camgroup_pair_common_cnt_.clear();
 
-  // Iterate through the camera groups
-  for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it_groups_1 =
-           cam_group_.begin();
-       it_groups_1 != cam_group_.end(); ++it_groups_1) {
-    int group_idx1 = it_groups_1->first;
-    for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it_groups_2 =
-             cam_group_.begin();
-         it_groups_2 != cam_group_.end(); ++it_groups_2) {
-      int group_idx2 = it_groups_2->first;
-      if (group_idx1 != group_idx2) // if the two groups are different
-      {
-        initNonOverlapPair(group_idx1, group_idx2);
-      }
-    }
+  // Iterate through the pairs of camera groups sharing frames
+  for (std::map<std::pair<int, int>,
+                std::vector<std::pair<std::weak_ptr<CameraGroupObs>,
+                                      std::weak_ptr<CameraGroupObs>>>>::
+           iterator it_pair = no_overlap_common_obs_.begin();
+       it_pair != no_overlap_common_obs_.end(); ++it_pair) {
+    initNonOverlapPair(it_pair->first.first, it_pair->first.second);
   }
 }
 
@@ -1430,11 +1731,10 @@ void Calibration::initInterCamGroupGraph() {
   }
 
   // Create the graph
-  for (std::map<std::pair<int, int>, cv::Mat>::iterator it =
+  for (std::map<std::pair<int, int>, Pose>::iterator it =
            no_overlap_camgroup_pair_pose_.begin();
        it != no_overlap_camgroup_pair_pose_.end(); ++it) {
     std::pair<int, int> camgroup_pair_idx = it->first;
-    cv::Mat camgroup_poses_temp = it->second;
     int nb_common_frame =
         no_overlap__camgroup_pair_common_cnt_[camgroup_pair_idx];
     no_overlap_camgroup_graph_.addEdge(camgroup_pair_idx.first,
@@ -1461,38 +1761,29 @@ void Calibration::mergeCameraGroup() {
     int id_ref_cam = cam_group_[id_ref_cam_group]->id_ref_cam_;
 
     // Recompute the camera pose in the referential of the reference group
-    std::map<int, cv::Mat>
+    std::map<int, Pose>
         cam_group_pose_to_ref; // pose of the cam group in the cam group
 
-    // Used the graph to find the transformations of camera groups to the
-    // reference group
-    for (int j = 0; j < connect_comp[i].size(); j++) {
-      int current_cam_group_id = connect_comp[i][j];
-      // Compute the transformation between the reference group and the current
-      // group
-      std::vector<int> short_path =
-          no_overlap_camgroup_graph_.shortestPathBetween(id_ref_cam_group,
-                                                         current_cam_group_id);
-      // Compute the transformation wrt. the reference camera
-      cv::Mat transform =
-          (cv::Mat_<double>(4, 4) << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0,
-           0, 1); // initialize the transformation to identity
-      for (int k = 0; k < short_path.size() - 1; k++) {
-        int current_group = short_path[k];
-        int next_group = short_path[k + 1];
-        std::pair<int, int> group_pair_idx =
-            std::make_pair(current_group, next_group);
-        cv::Mat current_trans = no_overlap_camgroup_pair_pose_[group_pair_idx];
-        // transform = transform * current_trans.inv();
-        transform = transform * current_trans;
+    // Used the shortest path tree of the reference group to find the
+    // transformations of camera groups to the reference group
+    ShortestPathTree path_tree =
+        no_overlap_camgroup_graph_.shortestPathTree(id_ref_cam_group);
+    for (const int &current_cam_group_id : path_tree.vertices_) {
+      int previous_cam_group_id = path_tree.predecessor_[current_cam_group_id];
+      if (current_cam_group_id == id_ref_cam_group) {
+        cam_group_pose_to_ref[current_cam_group_id] = Pose();
+        continue;
       }
-      // Store the poses
-      cam_group_pose_to_ref[current_cam_group_id] = transform;
+      std::pair<int, int> group_pair_idx =
+          std::make_pair(previous_cam_group_id, current_cam_group_id);
+      cam_group_pose_to_ref[current_cam_group_id] =
+          cam_group_pose_to_ref[previous_cam_group_id] *
+          no_overlap_camgroup_pair_pose_[group_pair_idx];
     }
 
     // initialize the camera group
     std::shared_ptr<CameraGroup> new_camera_group =
-        std::make_shared<CameraGroup>();
+        std::make_shared<CameraGroup>(parameter_arena_);
     new_camera_group->initializeCameraGroup(id_ref_cam, i);
     // Iterate through the camera groups and add all the cameras individually in
     // the new group
@@ -1505,7 +1796,7 @@ void Calibration::mergeCameraGroup() {
                     current_cam_group_idx) != connect_comp[i].end()) {
         // Prepare the current group pose in the referential of the final group
         std::weak_ptr<CameraGroup> current_group = it_group->second;
-        cv::Mat pose_in_final =
+        const Pose &pose_in_final =
             cam_group_pose_to_ref[current_group.lock()->cam_group_idx_];
         // the camera group is in the final group so we include its cameras
         for (std::map<int, std::weak_ptr<Camera>>::iterator it_cam =
@@ -1513,13 +1804,12 @@ void Calibration::mergeCameraGroup() {
              it_cam != current_group.lock()->cameras_.end(); ++it_cam) {
           std::weak_ptr<Camera> current_camera = it_cam->second;
           // Update the pose in the referential of the final group
-          cv::Mat pose_cam_in_current_group =
-              current_group.lock()->getCameraPoseMat(
-                  current_camera.lock()->cam_idx_);
-          cv::Mat transform = pose_cam_in_current_group * pose_in_final;
+          Pose pose_cam_in_current_group = current_group.lock()->getCameraPose(
+              current_camera.lock()->cam_idx_);
+          Pose transform = pose_cam_in_current_group * pose_in_final;
           new_camera_group->insertCamera(it_cam->second.lock());
-          new_camera_group->setCameraPoseMat(transform,
-                                             current_camera.lock()->cam_idx_);
+          new_camera_group->setCameraPose(transform,
+                                          current_camera.lock()->cam_idx_);
         }
       }
     }
@@ -1551,6 +1841,7 @@ void Calibration::mergeAllCameraGroupObs() {
     int camera_group_idx = it->second->cam_group_idx_;
     initCameraGroupObs(camera_group_idx);
   }
+  observation_store_.updateCameraGroupObservations(cams_group_obs_);
 }
 
 /**
@@ -1577,97 +1868,76 @@ void Calibration::computeAllObjPoseInCameraGroup() {
  * relative transformation.
  *
  * If two object appears in a single frames their
- * interpose can be computed and stored.
+ * interpose can be computed and stored. The camera group observations are
+ * processed by chunks in parallel, the poses of each chunk are merged in the
+ * order of the chunks.
  */
 void Calibration::computeObjectsPairPose() {
   object_pose_pairs_.clear();
-  // Iterate through camera group obs
+  std::vector<std::shared_ptr<CameraGroupObs>> cam_group_obs;
+  cam_group_obs.reserve(cams_group_obs_.size());
   for (std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
            it_cam_group_obs = cams_group_obs_.begin();
-       it_cam_group_obs != cams_group_obs_.end(); it_cam_group_obs++) {
-    if (it_cam_group_obs->second->object_idx_.size() > 1) {
-      std::map<int, std::weak_ptr<Object3DObs>> obj_obs =
-          it_cam_group_obs->second->object_observations_;
+       it_cam_group_obs != cams_group_obs_.end(); it_cam_group_obs++)
+    cam_group_obs.push_back(it_cam_group_obs->second);
+
+  const int nb_chunks =
+      (cam_group_obs.size() + pair_pose_chunk_ - 1) / pair_pose_chunk_;
+  std::vector<std::map<std::pair<int, int>, PosePairAggregator>> chunk_pairs(
+      nb_chunks);
+  thread_pool_->parallelFor(nb_chunks, [&](int chunk) {
+    const int end =
+        std::min<int>((chunk + 1) * pair_pose_chunk_, cam_group_obs.size());
+    for (int i = chunk * pair_pose_chunk_; i < end; i++) {
+      std::shared_ptr<CameraGroupObs> current_cam_group_obs = cam_group_obs[i];
+      if (current_cam_group_obs->object_idx_.size() <= 1)
+        continue;
+
+      std::map<int, std::weak_ptr<Object3DObs>> &obj_obs =
+          current_cam_group_obs->object_observations_;
       for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_object1 =
                obj_obs.begin();
            it_object1 != obj_obs.end(); it_object1++) {
         int object_3d_id_1 = it_object1->second.lock()->object_3d_id_;
-        cv::Mat obj_pose_1 =
-            it_cam_group_obs->second->getObjectPoseMat(object_3d_id_1);
-        // cv::Mat obj_pose_1 = it_object1->second->getPoseInGroupMat();
+        Pose obj_pose_1 = current_cam_group_obs->getObjectPose(object_3d_id_1);
         for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_object2 =
                  obj_obs.begin();
              it_object2 != obj_obs.end(); it_object2++) {
           int object_3d_id_2 = it_object2->second.lock()->object_3d_id_;
-          cv::Mat obj_pose_2 =
-              it_cam_group_obs->second->getObjectPoseMat(object_3d_id_2);
-          // cv::Mat obj_pose_2 = it_object2->second->getPoseInGroupMat();
           if (object_3d_id_1 != object_3d_id_2) {
-            cv::Mat inter_object_pose = obj_pose_2.inv() * obj_pose_1;
+            Pose obj_pose_2 =
+                current_cam_group_obs->getObjectPose(object_3d_id_2);
+            Pose inter_object_pose = obj_pose_2.inverse() * obj_pose_1;
             std::pair<int, int> object_idx_pair =
                 std::make_pair(object_3d_id_1, object_3d_id_2);
-            object_pose_pairs_[object_idx_pair].push_back(inter_object_pose);
+            chunk_pairs[chunk][object_idx_pair].addPose(inter_object_pose);
           }
         }
       }
     }
-  }
+  });
+  mergePosePairs(chunk_pairs, object_pose_pairs_);
 }
 
 /**
  * @brief Compute the mean transformation between all objects' observations
  *
  * Multiple interobject pose can be computed per frames, these measurements are
- * averaged in this function.
- *
- * @todo remove dead code
+ * aggregated while they are computed (robust average of a bounded sample).
  */
 void Calibration::initInterObjectsTransform() {
   inter_object_transform_.clear();
-  for (std::map<std::pair<int, int>, std::vector<cv::Mat>>::iterator it =
+  for (std::map<std::pair<int, int>, PosePairAggregator>::iterator it =
            object_pose_pairs_.begin();
        it != object_pose_pairs_.end(); ++it) {
     std::pair<int, int> object_pair_idx = it->first;
-    std::vector<cv::Mat> object_poses_temp = it->second;
-    cv::Mat average_rotation = cv::Mat::zeros(3, 1, CV_64F);
-    cv::Mat average_translation = cv::Mat::zeros(3, 1, CV_64F);
-
-    // Average technique
-    /*for (int i = 0; i < object_poses_temp.size(); i++) {
-      cv::Mat R, T;
-      Proj2RT(object_poses_temp[i], R, T);
-      average_rotation += R;
-      average_translation += T;
-    }
     LOG_DEBUG << "Number images where the 2 object appear :: "
-             << object_poses_temp.size()  ;
-    average_translation = average_translation / object_poses_temp.size();
-    average_rotation = average_rotation / object_poses_temp.size();*/
-
-    // Median
-    std::vector<double> r1, r2, r3;
-    std::vector<double> t1, t2, t3;
-    for (int i = 0; i < object_poses_temp.size(); i++) {
-      cv::Mat R, T;
-      Proj2RT(object_poses_temp[i], R, T);
-      r1.push_back(R.at<double>(0));
-      r2.push_back(R.at<double>(1));
-      r3.push_back(R.at<double>(2));
-      t1.push_back(T.at<double>(0));
-      t2.push_back(T.at<double>(1));
-      t3.push_back(T.at<double>(2));
-    }
-    average_rotation.at<double>(0) = median(r1);
-    average_rotation.at<double>(1) = median(r2);
-    average_rotation.at<double>(2) = median(r3);
-    average_translation.at<double>(0) = median(t1);
-    average_translation.at<double>(1) = median(t2);
-    average_translation.at<double>(2) = median(t3);
-
-    inter_object_transform_[object_pair_idx] =
-        RVecT2Proj(average_rotation, average_translation);
-    LOG_DEBUG << "Average Rot :: " << average_rotation
-              << "    Average Trans :: " << average_translation;
+              << it->second.getNbPoses();
+    Pose average_pose = it->second.getAveragePose();
+    inter_object_transform_[object_pair_idx] = average_pose;
+    LOG_DEBUG << "Average Rot :: " << average_pose.getRotVec().transpose()
+              << "    Average Trans :: "
+              << average_pose.translation_.transpose();
   }
 }
 
@@ -1687,13 +1957,12 @@ void Calibration::initInterObjectsGraph() {
     }
   }
 
-  for (std::map<std::pair<int, int>, std::vector<cv::Mat>>::iterator it =
+  for (std::map<std::pair<int, int>, PosePairAggregator>::iterator it =
            object_pose_pairs_.begin();
        it != object_pose_pairs_.end(); ++it) {
     std::pair<int, int> object_pair_idx = it->first;
-    std::vector<cv::Mat> object_poses_temp = it->second;
     covis_objects_graph_.addEdge(object_pair_idx.first, object_pair_idx.second,
-                                 ((double)1 / (object_poses_temp.size())));
+                                 ((double)1 / it->second.getNbPoses()));
   }
   LOG_DEBUG << "GRAPH INTER OBJECT DONE";
 }
@@ -1717,41 +1986,37 @@ void Calibration::mergeObjects() {
     int ref_board_id = object_3d_[id_ref_object]->ref_board_id_;
 
     // recompute the board poses in the referential of the reference object
-    std::map<int, cv::Mat>
+    std::map<int, Pose>
         object_pose_to_ref; // pose of the object in the ref object
     int nb_board_in_obj = 0;
 
     // Used the graph to find the transformations of objects to the reference
     // object
-    for (int j = 0; j < connect_comp[i].size(); j++) {
+    for (int j = 0; j < connect_comp[i].size(); j++)
       nb_board_in_obj += object_3d_[connect_comp[i][j]]->boards_.size();
-      int current_object_id = connect_comp[i][j];
-      // Compute the transformation between the reference object and the current
-      // object
-      std::vector<int> short_path = covis_objects_graph_.shortestPathBetween(
-          id_ref_object, current_object_id);
-      // Compute the transformation wrt. the reference object
-      cv::Mat transform =
-          (cv::Mat_<double>(4, 4) << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0,
-           0, 1); // initialize the transformation to identity
-      for (int k = 0; k < short_path.size() - 1; k++) {
-        int current_object = short_path[k];
-        int next_object = short_path[k + 1];
-        std::pair<int, int> object_pair_idx =
-            std::make_pair(current_object, next_object);
-        cv::Mat current_trans = inter_object_transform_[object_pair_idx];
-        transform = transform * current_trans.inv(); // original
-        // transform = transform * current_trans;
+    ShortestPathTree path_tree =
+        covis_objects_graph_.shortestPathTree(id_ref_object);
+    for (const int &current_object_id : path_tree.vertices_) {
+      int previous_object_id = path_tree.predecessor_[current_object_id];
+      if (current_object_id == id_ref_object) {
+        object_pose_to_ref[current_object_id] = Pose();
+        continue;
       }
-      // Store the poses
-      object_pose_to_ref[current_object_id] = transform;
+      std::pair<int, int> object_pair_idx =
+          std::make_pair(previous_object_id, current_object_id);
+      object_pose_to_ref[current_object_id] =
+          object_pose_to_ref[previous_object_id] *
+          inter_object_transform_[object_pair_idx].inverse();
     }
+    if (pose_graph_refinement_ == 1)
+      refinePoseGraph("pose_graph_objects_" + std::to_string(i), id_ref_object,
+                      inter_object_transform_, object_pose_pairs_, true,
+                      object_pose_to_ref);
     // initialize the object
     std::shared_ptr<Object3D> newObject3D =
-        std::make_shared<Object3D>(); // declare new object 3D in heap
+        std::make_shared<Object3D>(parameter_arena_); // new object 3D
     newObject3D->initializeObject3D(nb_board_in_obj, ref_board_id, i,
                                     boards_3d_[ref_board_id]->color_);
-    int pts_count = 0;
     // Iterate through the objects and add all of them individually in the new
     // object
     for (std::map<int, std::shared_ptr<Object3D>>::iterator it_object =
@@ -1764,47 +2029,39 @@ void Calibration::mergeObjects() {
         // Prepare the current object pose in the referential of the merged
         // object
         std::shared_ptr<Object3D> current_object = it_object->second;
-        cv::Mat pose_in_merged = object_pose_to_ref[current_object->obj_id_];
+        const Pose &pose_in_merged =
+            object_pose_to_ref[current_object->obj_id_];
         // the object is in the merged group so we include its boards
         for (std::map<int, std::weak_ptr<Board>>::iterator it_board =
                  current_object->boards_.begin();
              it_board != current_object->boards_.end(); ++it_board) {
           std::weak_ptr<Board> current_board = it_board->second;
           // Update the pose to be in the referential of the merged object
-          cv::Mat pose_board_in_current_obj =
-              current_object->getBoardPoseMat(current_board.lock()->board_id_);
+          Pose pose_board_in_current_obj =
+              current_object->getBoardPose(current_board.lock()->board_id_);
           // cv::Mat transform = pose_board_in_current_obj*pose_in_merged; //
           // previous wrong version cv::Mat transform =
           // pose_in_merged*pose_board_in_current_obj.inv(); // second version
           // that failed cv::Mat transform =
           // pose_board_in_current_obj.inv()*pose_in_merged; // Does not work at
           // all
-          cv::Mat transform = pose_in_merged * pose_board_in_current_obj;
+          Pose transform = pose_in_merged * pose_board_in_current_obj;
 
           // insert new board
           newObject3D->insertBoardInObject(current_board.lock());
           // Store the relative board transformation in the object
-          newObject3D->setBoardPoseMat(transform,
-                                       current_board.lock()->board_id_);
+          newObject3D->setBoardPose(transform, current_board.lock()->board_id_);
           // Transform the 3D pts to push in the object 3D
-          std::vector<cv::Point3f> trans_pts = transform3DPts(
-              current_board.lock()->pts_3d_,
-              newObject3D->getBoardRotVec(current_board.lock()->board_id_),
-              newObject3D->getBoardTransVec(current_board.lock()->board_id_));
+          std::vector<cv::Point3f> trans_pts =
+              transform3DPts(current_board.lock()->pts_3d_, transform);
           // Make a indexing between board to object
-          for (int k = 0; k < trans_pts.size(); k++) {
-            int char_id = k;
-            std::pair<int, int> boardid_charid =
-                std::make_pair(current_board.lock()->board_id_, char_id);
-            newObject3D->pts_board_2_obj_[boardid_charid] = pts_count;
-            newObject3D->pts_obj_2_board_.push_back(boardid_charid);
-            newObject3D->pts_3d_.push_back(trans_pts[k]);
-            pts_count++;
-          }
+          newObject3D->insertBoardPts(current_board.lock()->board_id_,
+                                      trans_pts);
         }
       }
     }
 
+    newObject3D->initializePtsTable();
     // Add the 3D object into the structure
     object_3d[i] = newObject3D;
   }
@@ -1819,6 +2076,7 @@ void Calibration::mergeObjects() {
  *
  */
 void Calibration::mergeAllObjectObs() {
+  PerfScope perf("merge_object_observations");
 
   // First we erase all the object observation in the entire datastructure
   for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
@@ -1862,17 +2120,8 @@ void Calibration::mergeAllObjectObs() {
 
   object_observations_.clear();
 
-  // Reinitialize all the 3D object
-  for (std::map<int, std::shared_ptr<Object3D>>::iterator it_object =
-           object_3d_.begin();
-       it_object != object_3d_.end(); ++it_object) {
-    // Reinitialize all object obserations
-    for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
-             object_3d_.begin();
-         it != object_3d_.end(); ++it) {
-      this->init3DObjectObs(it->first);
-    }
-  }
+  // Reinitialize all object obserations (once per object)
+  initAll3DObjectObs();
 }
 
 /**
@@ -1883,22 +2132,144 @@ void Calibration::reproErrorAllCamGroup() {
   for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
            cam_group_.begin();
        it != cam_group_.end(); it++) {
-    it->second->reproErrorCameraGroup();
+    it->second->reproErrorCameraGroup(observation_store_);
   }
 }
 
 /**
- * @brief Non-linear optimization of the camera pose in the groups, the pose
- * of the observed objects, and the pose of the boards in the 3D objects
+ * @brief Split the camera groups into sets refinable independently
+ *
+ * Two camera groups observing the same 3D object both refine the pose of its
+ * boards, they are therefore placed in the same set. Within a set, the groups
+ * are kept in the ascending order of their index.
  *
+ * @return sets of camera group indexes
  */
-void Calibration::refineAllCameraGroupAndObjects() {
+std::vector<std::vector<int>> Calibration::findIndependentCameraGroups() {
+  // Link the camera groups sharing objects
+  Graph groups_graph;
+  std::map<int, int> object_to_group; // first group observing the object
   for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
            cam_group_.begin();
        it != cam_group_.end(); ++it) {
-    it->second->refineCameraGroupAndObjects(nb_iterations_);
+    int cam_group_idx = it->first;
+    groups_graph.addVertex(cam_group_idx);
+    for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj_obs =
+             it->second->object_observations_.begin();
+         it_obj_obs != it->second->object_observations_.end(); ++it_obj_obs) {
+      int object_id = it_obj_obs->second.lock()->object_3d_id_;
+      std::map<int, int>::iterator it_group = object_to_group.find(object_id);
+      if (it_group == object_to_group.end())
+        object_to_group[object_id] = cam_group_idx;
+      else if (it_group->second != cam_group_idx)
+        groups_graph.addEdge(it_group->second, cam_group_idx, 1);
+    }
   }
 
+  std::vector<std::vector<int>> independent_groups =
+      groups_graph.connectedComponents();
+  for (std::vector<int> &groups : independent_groups)
+    std::sort(groups.begin(), groups.end());
+  return independent_groups;
+}
+
+/**
+ * @brief Refine the poses of a connected component with all its pairs
+ *
+ * The poses are initialized by chaining the pair transformations along a
+ * spanning tree, so the errors accumulate along the paths. Each pair of the
+ * component (including the ones outside the tree) constrains the two poses it
+ * links; the pose graph is optimized with the reference pose fixed. Nothing is
+ * done when the pairs form a tree (the chained poses are then exact).
+ *
+ * @param stage name of the refinement (solver telemetry)
+ * @param ref_id id of the reference (pose fixed to identity)
+ * @param inter_transform averaged transformation of each pair
+ * @param pose_pairs all the transformations measured for each pair (the number
+ * of measurements weights the pair)
+ * @param invert_transform true if a pose is the pose of the previous vertex
+ * composed with the inverse of the pair transformation (boards and objects),
+ * false if composed with the pair transformation (cameras)
+ * @param pose_to_ref poses of the component in the referential of the
+ * reference, refined in place
+ */
+void Calibration::refinePoseGraph(
+    std::string stage, int ref_id,
+    const std::map<std::pair<int, int>, Pose> &inter_transform,
+    const std::map<std::pair<int, int>, PosePairAggregator> &pose_pairs,
+    bool invert_transform, std::map<int, Pose> &pose_to_ref) {
+  // Parameter blocks of the poses
+  std::map<int, std::array<double, 6>> pose_blocks;
+  for (std::map<int, Pose>::iterator it = pose_to_ref.begin();
+       it != pose_to_ref.end(); ++it)
+    it->second.toBlock(pose_blocks[it->first].data());
+
+  ceres::Problem problem;
+  int nb_pairs = 0;
+  for (std::map<std::pair<int, int>, Pose>::const_iterator it =
+           inter_transform.begin();
+       it != inter_transform.end(); ++it) {
+    int id_1 = it->first.first;
+    int id_2 = it->first.second;
+    if (pose_to_ref.find(id_1) == pose_to_ref.end() ||
+        pose_to_ref.find(id_2) == pose_to_ref.end())
+      continue;
+    // The pairs are usually stored in both directions, keep only one
+    if (id_1 > id_2 && inter_transform.find(std::make_pair(id_2, id_1)) !=
+                           inter_transform.end())
+      continue;
+
+    double relative_pose[6];
+    if (invert_transform)
+      it->second.inverse().toBlock(relative_pose);
+    else
+      it->second.toBlock(relative_pose);
+    std::map<std::pair<int, int>, PosePairAggregator>::const_iterator
+        it_pairs = pose_pairs.find(it->first);
+    double weight = 1.0;
+    if (it_pairs != pose_pairs.end() && it_pairs->second.getNbPoses() > 0)
+      weight = double(it_pairs->second.getNbPoses());
+    // The weight scales the robust cost, not the residual, so the Huber
+    // threshold stays the same for all the pairs
+    ceres::CostFunction *transformation_error = TransformationError::Create(
+        relative_pose, pose_graph_translation_weight_);
+    ceres::LossFunction *loss = new ceres::ScaledLoss(
+        new ceres::HuberLoss(1.0), weight, ceres::TAKE_OWNERSHIP);
+    problem.AddResidualBlock(transformation_error, loss,
+                             pose_blocks[id_1].data(),
+                             pose_blocks[id_2].data());
+    nb_pairs++;
+  }
+
+  // A spanning tree has no redundant pair
+  if (nb_pairs < pose_to_ref.size())
+    return;
+  problem.SetParameterBlockConstant(pose_blocks[ref_id].data());
+
+  // Run the optimization
+  ceres::Solver::Summary summary;
+  solveProblem(stage, nb_iterations_, &problem, &summary);
+
+  for (std::map<int, Pose>::iterator it = pose_to_ref.begin();
+       it != pose_to_ref.end(); ++it)
+    it->second = Pose::fromBlock(pose_blocks[it->first].data());
+}
+
+/**
+ * @brief Non-linear optimization of the camera pose in the groups, the pose
+ * of the observed objects, and the pose of the boards in the 3D objects
+ *
+ * The camera groups which do not share any object are refined concurrently.
+ */
+void Calibration::refineAllCameraGroupAndObjects() {
+  std::vector<std::vector<int>> independent_groups =
+      findIndependentCameraGroups();
+  thread_pool_->parallelFor(independent_groups.size(), [&](int i) {
+    for (const int &cam_group_idx : independent_groups[i])
+      cam_group_.at(cam_group_idx)
+          ->refineCameraGroupAndObjects(nb_iterations_, observation_store_);
+  });
+
   // Update the 3D objects
   for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
            object_3d_.begin();
@@ -1914,6 +2285,97 @@ void Calibration::refineAllCameraGroupAndObjects() {
   }
 }
 
+/**
+ * @brief Build the problems of the final refinement
+ *
+ * The residual structure of each camera group (including the intrinsic
+ * parameters) is built once and reused by the successive calls to
+ * runFinalRefinement. The structure of the calibration (camera groups, objects
+ * and observations) must not change until releaseFinalRefinement is called.
+ */
+void Calibration::buildFinalRefinement() {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<std::vector<int>> independent_groups =
+      findIndependentCameraGroups();
+  thread_pool_->parallelFor(independent_groups.size(), [&](int i) {
+    for (const int &cam_group_idx : independent_groups[i])
+      cam_group_.at(cam_group_idx)->buildFinalProblem(observation_store_);
+  });
+  std::chrono::duration<double> build_time =
+      std::chrono::steady_clock::now() - start;
+  LOG_INFO << "Final refinement problems built in " << build_time.count()
+           << " s";
+}
+
+/**
+ * @brief Non-linear optimization of the camera pose in the groups, the pose
+ * of the observed objects, the pose of the boards in the 3D objects and
+ * optionally the intrinsic parameters, using the problems of
+ * buildFinalRefinement
+ *
+ * The optimization starts from the current parameters (e.g. the solution of a
+ * previous call).
+ *
+ * @param refine_intrinsics if false the intrinsic parameters are kept constant
+ */
+void Calibration::runFinalRefinement(bool refine_intrinsics) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<std::vector<int>> independent_groups =
+      findIndependentCameraGroups();
+  thread_pool_->parallelFor(independent_groups.size(), [&](int i) {
+    for (const int &cam_group_idx : independent_groups[i])
+      cam_group_.at(cam_group_idx)
+          ->solveFinalProblem(nb_iterations_, refine_intrinsics);
+  });
+  std::chrono::duration<double> solve_time =
+      std::chrono::steady_clock::now() - start;
+  LOG_INFO << "Final refinement (intrinsics refined: " << refine_intrinsics
+           << ") solved in " << solve_time.count() << " s";
+
+  // Update the 3D objects
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           object_3d_.begin();
+       it != object_3d_.end(); it++) {
+    it->second->updateObjectPts();
+  }
+
+  // Update the object3D observation
+  for (std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+           it = cams_group_obs_.begin();
+       it != cams_group_obs_.end(); it++) {
+    it->second->updateObjObsPose();
+  }
+}
+
+/**
+ * @brief Release the problems of the final refinement
+ *
+ */
+void Calibration::releaseFinalRefinement() {
+  for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
+           cam_group_.begin();
+       it != cam_group_.end(); ++it)
+    it->second->releaseFinalProblem();
+}
+
+/**
+ * @brief Final refinement of all the parameters of the camera groups
+ *
+ * The problems are built once and solved twice: without, then with the
+ * intrinsic parameters (unless they are fixed).
+ */
+void Calibration::finalRefinement() {
+  LOG_INFO << "Final refinement initiated";
+  buildFinalRefinement();
+  runFinalRefinement(false);
+  // Optimize everything including intrinsics
+  if (fix_intrinsic_ == 0)
+    runFinalRefinement(true);
+  releaseFinalRefinement();
+}
+
 /**
  * @brief Save reprojection results images for a given camera.
  *
@@ -1945,30 +2407,31 @@ void Calibration::saveReprojection(int cam_id) {
     cv::Mat image = cv::imread(im_path);
 
     // Iterate through the camera group observations
-    std::map<int, std::weak_ptr<CameraGroupObs>> cam_group_obs =
+    std::map<int, std::weak_ptr<CameraGroupObs>> &cam_group_obs =
         it_frame->second->cam_group_observations_;
     for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
              it_cam_group_obs = cam_group_obs.begin();
          it_cam_group_obs != cam_group_obs.end(); it_cam_group_obs++) {
       // Iterate through the object observation
-      std::map<int, std::weak_ptr<Object3DObs>> object_observations =
+      std::map<int, std::weak_ptr<Object3DObs>> &object_observations =
           it_cam_group_obs->second.lock()->object_observations_;
       for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj_obs =
                object_observations.begin();
            it_obj_obs != object_observations.end(); it_obj_obs++) {
         if (it_obj_obs->second.lock()->camera_id_ == cam_id) {
           // Prepare the transformation matrix
-          cv::Mat cam_pose = it_cam_group_obs->second.lock()
-                                 ->cam_group_.lock()
-                                 ->getCameraPoseMat(cam_id) *
-                             it_obj_obs->second.lock()->getPoseInGroupMat();
-          cv::Mat rot_vec, trans_vec;
-          Proj2RT(cam_pose, rot_vec, trans_vec);
+          Pose cam_pose =
+              it_cam_group_obs->second.lock()->cam_group_.lock()->getCameraPose(
+                  cam_id) *
+              it_obj_obs->second.lock()->getPoseInGroup();
+          cv::Mat rot_vec = cam_pose.getRotVecMat();
+          cv::Mat trans_vec = cam_pose.getTransVecMat();
 
           // Get the 2d and 3d pts
-          std::vector<cv::Point2f> pts_2d = it_obj_obs->second.lock()->pts_2d_;
-          std::vector<int> pts_ind = it_obj_obs->second.lock()->pts_id_;
-          std::vector<cv::Point3f> pts_3d_obj =
+          const std::vector<cv::Point2f> &pts_2d =
+              it_obj_obs->second.lock()->pts_2d_;
+          const std::vector<int> &pts_ind = it_obj_obs->second.lock()->pts_id_;
+          const std::vector<cv::Point3f> &pts_3d_obj =
               it_obj_obs->second.lock()->object_3d_.lock()->pts_3d_;
           std::vector<cv::Point3f> pts_3d;
           std::vector<cv::Point2f> pts_repro;
@@ -2057,22 +2520,23 @@ void Calibration::saveDetection(int cam_id) {
     cv::Mat image = cv::imread(im_path);
 
     // Iterate through the camera group observations
-    std::map<int, std::weak_ptr<CameraGroupObs>> cam_group_obs =
+    std::map<int, std::weak_ptr<CameraGroupObs>> &cam_group_obs =
         it_frame->second->cam_group_observations_;
     for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
              it_cam_group_obs = cam_group_obs.begin();
          it_cam_group_obs != cam_group_obs.end(); it_cam_group_obs++) {
       // Iterate through the object observation
-      std::map<int, std::weak_ptr<Object3DObs>> object_observations =
+      std::map<int, std::weak_ptr<Object3DObs>> &object_observations =
           it_cam_group_obs->second.lock()->object_observations_;
       for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj_obs =
                object_observations.begin();
            it_obj_obs != object_observations.end(); it_obj_obs++) {
         if (it_obj_obs->second.lock()->camera_id_ == cam_id) {
           // Get the 2d and 3d pts
-          std::vector<cv::Point2f> pts_2d = it_obj_obs->second.lock()->pts_2d_;
+          const std::vector<cv::Point2f> &pts_2d =
+              it_obj_obs->second.lock()->pts_2d_;
           // plot the keypoints on the image (red project // green detected)
-          std::vector<double> color =
+          const std::vector<double> &color =
               it_obj_obs->second.lock()->object_3d_.lock()->color_;
           for (int i = 0; i < pts_2d.size(); i++) {
             circle(image, cv::Point(pts_2d[i].x, pts_2d[i].y), 4,
@@ -2114,13 +2578,12 @@ void Calibration::saveDetectionAllCam() {
  *
  */
 void Calibration::initIntrinsic() {
-  initializeCalibrationAllCam();
-  estimatePoseAllBoards();
-  if (fix_intrinsic_ == 0)
-  {
-    refineIntrinsicAndPoseAllCam();
+  // with preloaded intrinsics the poses are estimated by boardExtraction
+  if (!hasPreloadedIntrinsics()) {
+    initializeCalibrationAllCam();
+    estimatePoseAllBoards();
   }
-  computeReproErrAllBoard();
+  refineIntrinsic();
 }
 
 /**
@@ -2173,7 +2636,10 @@ void Calibration::merge3DObjects() {
   mergeAllCameraGroupObs();
   estimatePoseAllObjects();
   computeAllObjPoseInCameraGroup();
-  refineAllCameraGroupAndObjects();
+  if (fix_board_merge_ == 1)
+    refineAllCameraGroup();
+  else
+    refineAllCameraGroupAndObjects();
   this->reproErrorAllCamGroup();
 }
 
@@ -2183,8 +2649,9 @@ void Calibration::merge3DObjects() {
  * @return list of distances between points
  */
 cv::Mat
-Calibration::computeDistanceBetweenPoints(std::vector<cv::Point2f> obj_pts_2d,
-                                          std::vector<cv::Point2f> repro_pts) {
+Calibration::computeDistanceBetweenPoints(
+    const std::vector<cv::Point2f> &obj_pts_2d,
+    const std::vector<cv::Point2f> &repro_pts) {
   cv::Mat error_list;
   for (int i = 0; i < repro_pts.size(); i++) {
     float rep_err = std::sqrt(std::pow((obj_pts_2d[i].x - repro_pts[i].x), 2) +
@@ -2201,81 +2668,70 @@ Calibration::computeDistanceBetweenPoints(std::vector<cv::Point2f> obj_pts_2d,
  * @return average reprojection error
  */
 double Calibration::computeAvgReprojectionError() {
-  cv::Mat frame_list;
-  cv::Scalar total_avg_error_sum;
+  double total_avg_error_sum = 0;
   int number_of_adds = 0;
 
+  // The intrinsics are converted once per camera and the points are
+  // transformed in the camera referential before the projection, the buffers
+  // are reused for all the observations
+  std::map<int, cv::Mat> camera_matrix, distortion_vector;
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
+       it != cams_.end(); ++it) {
+    camera_matrix[it->first] = it->second->getCameraMat();
+    distortion_vector[it->first] = it->second->getDistortionVectorVector();
+  }
+  cv::Mat null_r_vec = cv::Mat::zeros(3, 1, CV_64F);
+  cv::Mat null_t_vec = cv::Mat::zeros(3, 1, CV_64F);
+  std::vector<cv::Point3f> object_pts;
+  std::vector<cv::Point2f> repro_pts;
+
   for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
            cam_group_.begin();
        it != cam_group_.end(); it++) {
     int cam_group_idx = it->second->cam_group_idx_;
-    std::shared_ptr<CameraGroup> cur_cam_group = it->second;
-
-    // iterate through frames
-    for (std::map<int, std::weak_ptr<Frame>>::iterator it_frame =
-             cur_cam_group->frames_.begin();
-         it_frame != cur_cam_group->frames_.end(); ++it_frame) {
-      cv::Mat camera_list;
-      frame_list.push_back(it_frame->second.lock()->frame_idx_);
-
-      // iterate through cameraGroupObs
-      std::map<int, std::weak_ptr<CameraGroupObs>> current_cam_group_obs_vec =
-          it_frame->second.lock()->cam_group_observations_;
-      for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
-               it_cam_group_obs = current_cam_group_obs_vec.begin();
-           it_cam_group_obs != current_cam_group_obs_vec.end();
-           ++it_cam_group_obs) {
-
-        // check if the current group is the camera group of interest
-        if (cam_group_idx == it_cam_group_obs->second.lock()->cam_group_idx_) {
-          std::map<int, std::weak_ptr<Object3DObs>> current_obj3d_obs_vec =
-              it_cam_group_obs->second.lock()->object_observations_;
-
-          // iterate through 3D object obs
-          for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj3d =
-                   current_obj3d_obs_vec.begin();
-               it_obj3d != current_obj3d_obs_vec.end(); ++it_obj3d) {
-            int current_cam_id = it_obj3d->second.lock()->camera_id_;
-            std::vector<cv::Point3f> obj_pts_3d =
-                it_obj3d->second.lock()->object_3d_.lock()->pts_3d_;
-            std::vector<int> obj_pts_idx = it_obj3d->second.lock()->pts_id_;
-            std::vector<cv::Point2f> obj_pts_2d =
-                it_obj3d->second.lock()->pts_2d_;
-            camera_list.push_back(current_cam_id);
-
-            // compute the reprojection error
-            std::vector<cv::Point3f> object_pts;
-            for (int i = 0; i < obj_pts_idx.size(); i++)
-              object_pts.push_back(obj_pts_3d[obj_pts_idx[i]]);
 
-            // apply object pose transform
-            std::vector<cv::Point3f> object_pts_trans1 = transform3DPts(
-                object_pts,
-                it_cam_group_obs->second.lock()->getObjectRotVec(
-                    it_obj3d->second.lock()->object_3d_id_),
-                it_cam_group_obs->second.lock()->getObjectTransVec(
-                    it_obj3d->second.lock()->object_3d_id_));
-            // reproject pts
-            std::vector<cv::Point2f> repro_pts;
-            std::shared_ptr<Camera> cam_ptr =
-                it_obj3d->second.lock()->cam_.lock();
-            projectPointsWithDistortion(
-                object_pts_trans1, it->second->getCameraRotVec(current_cam_id),
-                it->second->getCameraTransVec(current_cam_id),
-                cam_ptr->getCameraMat(), cam_ptr->getDistortionVectorVector(),
-                repro_pts, cam_ptr->distortion_model_);
-
-            cv::Mat error_list =
-                computeDistanceBetweenPoints(obj_pts_2d, repro_pts);
-            total_avg_error_sum += cv::mean(error_list);
-            number_of_adds++;
-          }
-        }
+    // iterate through the object observations of the group (sorted by frame)
+    std::pair<int, int> obs_range =
+        observation_store_.getCameraGroupObjectObs(cam_group_idx);
+    for (int obs_idx = obs_range.first; obs_idx < obs_range.second;
+         obs_idx++) {
+      int current_cam_id = observation_store_.object_obs_camera_id_[obs_idx];
+      int current_obj_id = observation_store_.object_obs_object_id_[obs_idx];
+      const std::vector<cv::Point3f> &obj_pts_3d =
+          object_3d_[current_obj_id]->pts_3d_;
+      int pts_begin = observation_store_.object_obs_pts_begin_[obs_idx];
+      int pts_end = observation_store_.object_obs_pts_begin_[obs_idx + 1];
+
+      // apply object and camera pose transform
+      Pose object_pose_in_cam =
+          it->second->getCameraPose(current_cam_id) *
+          Pose::fromBlock(observation_store_.object_obs_group_pose_[obs_idx]);
+      object_pts.clear();
+      for (int i = pts_begin; i < pts_end; i++)
+        object_pts.push_back(
+            object_pose_in_cam *
+            obj_pts_3d[observation_store_.object_pts_id_[i]]);
+
+      // reproject pts
+      projectPointsWithDistortion(
+          object_pts, null_r_vec, null_t_vec, camera_matrix[current_cam_id],
+          distortion_vector[current_cam_id], repro_pts,
+          cams_[current_cam_id]->distortion_model_);
+
+      // compute the reprojection error
+      double sum_error = 0;
+      for (int i = 0; i < repro_pts.size(); i++) {
+        const cv::Point2f &pts_2d =
+            observation_store_.object_pts_2d_[pts_begin + i];
+        sum_error += std::sqrt(std::pow((pts_2d.x - repro_pts[i].x), 2) +
+                               std::pow((pts_2d.y - repro_pts[i].y), 2));
       }
+      total_avg_error_sum += sum_error / repro_pts.size();
+      number_of_adds++;
     }
   }
 
-  return total_avg_error_sum.val[0] / number_of_adds;
+  return total_avg_error_sum / number_of_adds;
 }
 
 /**
@@ -2308,7 +2764,7 @@ void Calibration::saveReprojectionErrorToFile() {
       frame_list.push_back(it_frame_ptr->frame_idx_);
 
       // iterate through cameraGroupObs
-      std::map<int, std::weak_ptr<CameraGroupObs>> current_cam_group_obs_vec =
+      std::map<int, std::weak_ptr<CameraGroupObs>> &current_cam_group_obs_vec =
           it_frame_ptr->cam_group_observations_;
       for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
                it_cam_group_obs = current_cam_group_obs_vec.begin();
@@ -2317,7 +2773,7 @@ void Calibration::saveReprojectionErrorToFile() {
 
         // check if the current group is the camera group of interest
         if (cam_group_idx == it_cam_group_obs->second.lock()->cam_group_idx_) {
-          std::map<int, std::weak_ptr<Object3DObs>> current_obj3d_obs_vec =
+          std::map<int, std::weak_ptr<Object3DObs>> &current_obj3d_obs_vec =
               it_cam_group_obs->second.lock()->object_observations_;
 
           // iterate through 3D object obs
@@ -2325,10 +2781,11 @@ void Calibration::saveReprojectionErrorToFile() {
                    current_obj3d_obs_vec.begin();
                it_obj3d != current_obj3d_obs_vec.end(); ++it_obj3d) {
             int current_cam_id = it_obj3d->second.lock()->camera_id_;
-            std::vector<cv::Point3f> obj_pts_3d =
+            const std::vector<cv::Point3f> &obj_pts_3d =
                 it_obj3d->second.lock()->object_3d_.lock()->pts_3d_;
-            std::vector<int> obj_pts_idx = it_obj3d->second.lock()->pts_id_;
-            std::vector<cv::Point2f> obj_pts_2d =
+            const std::vector<int> &obj_pts_idx =
+                it_obj3d->second.lock()->pts_id_;
+            const std::vector<cv::Point2f> &obj_pts_2d =
                 it_obj3d->second.lock()->pts_2d_;
             camera_list.push_back(current_cam_id);
             fs << "camera_" + std::to_string(current_cam_id);
@@ -2344,11 +2801,8 @@ void Calibration::saveReprojectionErrorToFile() {
 
             // apply object pose transform
             std::vector<cv::Point3f> object_pts_trans1 = transform3DPts(
-                object_pts,
-                it_cam_group_obs->second.lock()->getObjectRotVec(
-                    it_obj3d->second.lock()->object_3d_id_),
-                it_cam_group_obs->second.lock()->getObjectTransVec(
-                    it_obj3d->second.lock()->object_3d_id_));
+                object_pts, it_cam_group_obs->second.lock()->getObjectPose(
+                                it_obj3d->second.lock()->object_3d_id_));
             // reproject pts
             std::vector<cv::Point2f> repro_pts;
             std::shared_ptr<Camera> cam_ptr =
@@ -2376,22 +2830,882 @@ void Calibration::saveReprojectionErrorToFile() {
  * @brief Non-linear optimization of the camera pose in the groups, the pose
  * of the observed objects, and the pose of the boards in the 3D objects
  *
+ * The camera groups which do not share any object are refined concurrently.
  */
 void Calibration::refineAllCameraGroupAndObjectsAndIntrinsic() {
+  std::vector<std::vector<int>> independent_groups =
+      findIndependentCameraGroups();
+  thread_pool_->parallelFor(independent_groups.size(), [&](int i) {
+    for (const int &cam_group_idx : independent_groups[i])
+      cam_group_.at(cam_group_idx)->refineCameraGroupAndObjectsAndIntrinsics(
+          nb_iterations_, fix_intrinsic_ != 0, observation_store_);
+  });
+
+  // Update the 3D objects
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           object_3d_.begin();
+       it != object_3d_.end(); it++) {
+    it->second->updateObjectPts();
+  }
+
+  // Update the object3D observation
+  for (std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+           it = cams_group_obs_.begin();
+       it != cams_group_obs_.end(); it++) {
+    it->second->updateObjObsPose();
+  }
+}
+
+/**
+ * @brief Count the objects of the calibration for the stage profiler
+ *
+ * @return number of observations, cameras, objects and parameter blocks
+ */
+std::map<std::string, long> Calibration::getStageCounts() {
+  std::map<std::string, long> counts;
+  counts["frames"] = frames_.size();
+  counts["board_observations"] = board_observations_.size();
+  counts["camera_observations"] = cams_obs_.size();
+  counts["object_observations"] = object_observations_.size();
+  counts["camera_group_observations"] = cams_group_obs_.size();
+  counts["cameras"] = cams_.size();
+  counts["boards"] = boards_3d_.size();
+  counts["objects"] = object_3d_.size();
+  counts["camera_groups"] = cam_group_.size();
+  long nb_parameter_blocks = 0;
+  for (int type = 0; type < ParameterArena::NbBlockTypes; type++)
+    nb_parameter_blocks += parameter_arena_->getNbBlocks(
+        static_cast<ParameterArena::BlockType>(type));
+  counts["parameter_blocks"] = nb_parameter_blocks;
+  return counts;
+}
+
+/**
+ * @brief Get the stages after which a checkpoint can be saved, in their order
+ * of execution
+ *
+ * "board_extraction" covers the detection, the insertion of the boards and
+ * the initialization of the intrinsics of all the cameras.
+ *
+ * @return names of the stages
+ */
+const std::vector<std::string> &Calibration::getCheckpointStages() {
+  static const std::vector<std::string> stages = {
+      "board_extraction",         "intrinsic_calibration",
+      "3d_object_calibration",    "camera_group_calibration",
+      "merge_3d_objects",         "non_overlapping_calibration",
+      "merge_cameras_and_objects", "final_refinement",
+      "reprojection_error"};
+  return stages;
+}
+
+/**
+ * @brief Get the path of the checkpoint saved after a stage
+ *
+ * @param stage name of the stage
+ *
+ * @return path of the checkpoint in save_path_
+ */
+std::string Calibration::getCheckpointPath(std::string stage) {
+  return save_path_ + "checkpoint_" + stage + ".bin";
+}
+
+/**
+ * @brief Save the state of the calibration after a stage
+ *
+ * The cameras, the board observations, the 3D objects and their observations,
+ * the camera groups and their observations, all their pose blocks and the
+ * poses between non-overlapping groups are saved. The relationships between
+ * them (frames, camera observations, observation store) are rebuilt by
+ * loadCheckpoint, the graphs are rebuilt by the stages using them.
+ *
+ * @param stage stage after which the checkpoint is taken
+ */
+void Calibration::saveCheckpoint(std::string stage) {
+  std::string file_path = getCheckpointPath(stage);
+  CheckpointWriter writer(file_path, stage);
+  if (!writer.isOpen())
+    return;
+
+  // Cameras
+  writer.write<int>(cams_.size());
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
+       it != cams_.end(); ++it) {
+    writer.write<int>(it->second->cam_idx_);
+    writer.write<int>(it->second->im_cols_);
+    writer.write<int>(it->second->im_rows_);
+    writer.write<int>(it->second->nb_images_);
+    writer.write<int>(it->second->distortion_model_);
+    writer.writeBlock(it->second->intrinsics_, 9);
+  }
+
+  // Board observations (in their order of insertion)
+  writer.write<int>(board_observations_.size());
+  for (std::map<int, std::shared_ptr<BoardObs>>::iterator it =
+           board_observations_.begin();
+       it != board_observations_.end(); ++it) {
+    std::shared_ptr<BoardObs> board_obs = it->second;
+    writer.write<int>(board_obs->camera_id_);
+    writer.write<int>(board_obs->frame_id_);
+    writer.write<int>(board_obs->board_id_);
+    writer.write<char>(board_obs->valid_);
+    writer.writeBlock(board_obs->pose_, 6);
+    writer.writeVector(board_obs->pts_2d_);
+    writer.writeVector(board_obs->charuco_id_);
+    const std::map<int, std::string> &frame_path =
+        frames_.at(board_obs->frame_id_)->frame_path_;
+    std::map<int, std::string>::const_iterator it_path =
+        frame_path.find(board_obs->camera_id_);
+    writer.writeString(it_path != frame_path.end() ? it_path->second : "");
+  }
+
+  // 3D objects (boards in the order of their points)
+  writer.write<int>(object_3d_.size());
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           object_3d_.begin();
+       it != object_3d_.end(); ++it) {
+    std::shared_ptr<Object3D> object = it->second;
+    std::vector<int> board_ids;
+    for (std::map<int, std::weak_ptr<Board>>::iterator it_board =
+             object->boards_.begin();
+         it_board != object->boards_.end(); ++it_board)
+      board_ids.push_back(it_board->first);
+    std::sort(board_ids.begin(), board_ids.end(), [&object](int a, int b) {
+      return object->board_pts_offset_[a] < object->board_pts_offset_[b];
+    });
+    writer.write<int>(object->obj_id_);
+    writer.write<int>(object->ref_board_id_);
+    writer.write<int>(object->nb_boards_);
+    writer.writeVector(object->color_);
+    writer.writeVector(board_ids);
+    for (const int &board_id : board_ids)
+      writer.writeBlock(object->relative_board_pose_[board_id], 6);
+    writer.writeVector(object->pts_3d_);
+  }
+
+  // 3D object observations (rebuilt from the objects, only their poses are
+  // saved)
+  writer.write<int>(object_observations_.size());
+  for (std::map<int, std::shared_ptr<Object3DObs>>::iterator it =
+           object_observations_.begin();
+       it != object_observations_.end(); ++it) {
+    std::shared_ptr<Object3DObs> object_obs = it->second;
+    writer.write<int>(object_obs->object_3d_id_);
+    writer.write<int>(object_obs->camera_id_);
+    writer.write<int>(object_obs->frame_id_);
+    writer.write<char>(object_obs->valid_);
+    writer.writeBlock(object_obs->pose_, 6);
+    writer.writeBlock(object_obs->group_pose_, 6);
+  }
+
+  // Camera groups
+  writer.write<int>(cam_group_.size());
   for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
            cam_group_.begin();
        it != cam_group_.end(); ++it) {
+    std::shared_ptr<CameraGroup> cam_group = it->second;
+    writer.write<int>(cam_group->cam_group_idx_);
+    writer.write<int>(cam_group->id_ref_cam_);
+    writer.writeVector(cam_group->cam_idx);
+    for (const int &cam_idx : cam_group->cam_idx)
+      writer.writeBlock(cam_group->relative_camera_pose_[cam_idx], 6);
+  }
 
-    it->second->refineCameraGroupAndObjectsAndIntrinsics(nb_iterations_);
+  // Camera group observations (rebuilt from the groups, only the poses of the
+  // objects are saved)
+  writer.write<int>(cams_group_obs_.size());
+  for (std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+           it = cams_group_obs_.begin();
+       it != cams_group_obs_.end(); ++it) {
+    writer.write<int>(it->first.first);
+    writer.write<int>(it->first.second);
+    writer.write<int>(it->second->object_pose_.size());
+    for (std::map<int, double *>::iterator it_pose =
+             it->second->object_pose_.begin();
+         it_pose != it->second->object_pose_.end(); ++it_pose) {
+      writer.write<int>(it_pose->first);
+      writer.writeBlock(it_pose->second, 6);
+    }
   }
 
-  // Update the 3D objects
+  // Non-overlapping camera groups
+  writer.write<int>(no_overlap_object_pair_.size());
+  for (std::map<std::pair<int, int>, std::pair<int, int>>::iterator it =
+           no_overlap_object_pair_.begin();
+       it != no_overlap_object_pair_.end(); ++it) {
+    writer.write<int>(it->first.first);
+    writer.write<int>(it->first.second);
+    writer.write<int>(it->second.first);
+    writer.write<int>(it->second.second);
+  }
+  writer.write<int>(no_overlap_camgroup_pair_pose_.size());
+  for (std::map<std::pair<int, int>, Pose>::iterator it =
+           no_overlap_camgroup_pair_pose_.begin();
+       it != no_overlap_camgroup_pair_pose_.end(); ++it) {
+    writer.write<int>(it->first.first);
+    writer.write<int>(it->first.second);
+    writer.writeBlock(it->second.rotation_.data(), 9);
+    writer.writeBlock(it->second.translation_.data(), 3);
+    writer.write<int>(no_overlap__camgroup_pair_common_cnt_[it->first]);
+  }
+
+  if (writer.close())
+    LOG_INFO << "Checkpoint saved in " << file_path;
+  else
+    LOG_ERROR << "Cannot write the checkpoint " << file_path;
+}
+
+/**
+ * @brief Load the state of the calibration saved after a stage
+ *
+ * It must be called right after initialization, with the configuration used
+ * to save the checkpoint. To update a previous calibration, the configuration
+ * can add cameras and the observations and intrinsics of the cameras listed in
+ * replaced_cameras_ are not loaded.
+ *
+ * @param stage stage after which the checkpoint was taken
+ * @param incremental true to load the state for an incremental calibration
+ *
+ * @return true if the checkpoint was loaded
+ */
+bool Calibration::loadCheckpoint(std::string stage, bool incremental) {
+  std::string file_path = getCheckpointPath(stage);
+  if (!board_observations_.empty()) {
+    LOG_ERROR << "The checkpoint must be loaded before any stage";
+    return false;
+  }
+  CheckpointReader reader(file_path);
+  if (!reader.isValid())
+    return false;
+  if (reader.getStage() != stage) {
+    LOG_ERROR << file_path << " was saved after " << reader.getStage()
+              << " instead of " << stage;
+    return false;
+  }
+
+  // Cameras (created by the initialization)
+  std::set<int> replaced_cams;
+  if (incremental)
+    replaced_cams.insert(replaced_cameras_.begin(), replaced_cameras_.end());
+  const int nb_cams = reader.read<int>();
+  if (incremental ? nb_cams > static_cast<int>(cams_.size())
+                  : nb_cams != static_cast<int>(cams_.size())) {
+    LOG_ERROR << "The checkpoint has " << nb_cams << " cameras instead of "
+              << cams_.size();
+    return false;
+  }
+  for (int i = 0; i < nb_cams && reader.isValid(); i++) {
+    const int cam_idx = reader.read<int>();
+    if (cams_.find(cam_idx) == cams_.end()) {
+      LOG_ERROR << "Unknown camera " << cam_idx << " in the checkpoint";
+      return false;
+    }
+    const int im_cols = reader.read<int>();
+    const int im_rows = reader.read<int>();
+    const int nb_images = reader.read<int>();
+    const int distortion_model = reader.read<int>();
+    double intrinsics[9];
+    reader.readBlock(intrinsics, 9);
+    if (!reader.isValid() || replaced_cams.count(cam_idx) > 0)
+      continue;
+    std::shared_ptr<Camera> cam = cams_[cam_idx];
+    cam->im_cols_ = im_cols;
+    cam->im_rows_ = im_rows;
+    cam->nb_images_ = nb_images;
+    cam->distortion_model_ = distortion_model;
+    std::copy(intrinsics, intrinsics + 9, cam->intrinsics_);
+    if (incremental)
+      calibrated_cameras_.insert(cam_idx);
+  }
+
+  // Board observations
+  const int nb_board_obs = reader.read<int>();
+  for (int i = 0; i < nb_board_obs && reader.isValid(); i++) {
+    const int cam_idx = reader.read<int>();
+    const int frame_idx = reader.read<int>();
+    const int board_idx = reader.read<int>();
+    const bool valid = reader.read<char>() != 0;
+    double pose[6];
+    reader.readBlock(pose, 6);
+    std::vector<cv::Point2f> pts_2d = reader.readVector<cv::Point2f>();
+    std::vector<int> charuco_idx = reader.readVector<int>();
+    std::string frame_path = reader.readString();
+    if (!reader.isValid())
+      break;
+    if (replaced_cams.count(cam_idx) > 0)
+      continue;
+    if (cams_.find(cam_idx) == cams_.end() ||
+        boards_3d_.find(board_idx) == boards_3d_.end()) {
+      LOG_ERROR << "Unknown camera " << cam_idx << " or board " << board_idx
+                << " in the checkpoint";
+      return false;
+    }
+    std::shared_ptr<BoardObs> board_obs =
+        std::make_shared<BoardObs>(parameter_arena_);
+    board_obs->init(cam_idx, frame_idx, board_idx, pts_2d, charuco_idx,
+                    cams_[cam_idx], boards_3d_[board_idx]);
+    board_obs->valid_ = valid;
+    std::copy(pose, pose + 6, board_obs->pose_);
+    insertNewBoard(board_obs, frame_path);
+  }
+  observation_store_.initBoardObservations(board_observations_, cams_);
+
+  // 3D objects
+  const int nb_objects = reader.read<int>();
+  for (int i = 0; i < nb_objects && reader.isValid(); i++) {
+    const int obj_id = reader.read<int>();
+    const int ref_board_id = reader.read<int>();
+    const int nb_boards = reader.read<int>();
+    std::vector<double> color = reader.readVector<double>();
+    std::vector<int> board_ids = reader.readVector<int>();
+    std::vector<double> poses(6 * board_ids.size());
+    for (size_t j = 0; j < board_ids.size(); j++)
+      reader.readBlock(&poses[6 * j], 6);
+    std::vector<cv::Point3f> pts_3d = reader.readVector<cv::Point3f>();
+    if (!reader.isValid())
+      break;
+
+    size_t nb_pts = 0;
+    for (const int &board_id : board_ids) {
+      if (boards_3d_.find(board_id) == boards_3d_.end()) {
+        LOG_ERROR << "Unknown board " << board_id << " in the checkpoint";
+        return false;
+      }
+      nb_pts += boards_3d_[board_id]->pts_3d_.size();
+    }
+    if (nb_pts != pts_3d.size()) {
+      LOG_ERROR << "The object " << obj_id << " of the checkpoint has "
+                << pts_3d.size() << " points instead of " << nb_pts;
+      return false;
+    }
+    std::shared_ptr<Object3D> object =
+        std::make_shared<Object3D>(parameter_arena_);
+    object->initializeObject3D(nb_boards, ref_board_id, obj_id, color);
+    std::vector<cv::Point3f>::iterator it_pts = pts_3d.begin();
+    for (size_t j = 0; j < board_ids.size(); j++) {
+      const int board_id = board_ids[j];
+      object->insertBoardInObject(boards_3d_[board_id]);
+      object->setBoardPose(Pose(), board_id);
+      std::copy(&poses[6 * j], &poses[6 * j] + 6,
+                object->relative_board_pose_[board_id]);
+      std::vector<cv::Point3f>::iterator it_end =
+          it_pts + boards_3d_[board_id]->pts_3d_.size();
+      object->insertBoardPts(board_id,
+                             std::vector<cv::Point3f>(it_pts, it_end));
+      it_pts = it_end;
+    }
+    object->initializePtsTable();
+    object_3d_[obj_id] = object;
+  }
+
+  // 3D object observations
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           object_3d_.begin();
+       it != object_3d_.end(); ++it)
+    init3DObjectObs(it->first);
+  const int nb_object_obs = reader.read<int>();
+  std::map<int, std::shared_ptr<Object3DObs>>::iterator it_object_obs =
+      object_observations_.begin();
+  for (int i = 0; i < nb_object_obs && reader.isValid(); i++) {
+    const int obj_id = reader.read<int>();
+    const int cam_idx = reader.read<int>();
+    const int frame_idx = reader.read<int>();
+    const bool valid = reader.read<char>() != 0;
+    double pose[6], group_pose[6];
+    reader.readBlock(pose, 6);
+    reader.readBlock(group_pose, 6);
+    if (!reader.isValid() || replaced_cams.count(cam_idx) > 0)
+      continue;
+    if (it_object_obs == object_observations_.end() ||
+        obj_id != it_object_obs->second->object_3d_id_ ||
+        cam_idx != it_object_obs->second->camera_id_ ||
+        frame_idx != it_object_obs->second->frame_id_) {
+      LOG_ERROR << "The object observation " << i
+                << " of the checkpoint does not match the rebuilt ones";
+      return false;
+    }
+    std::shared_ptr<Object3DObs> object_obs = it_object_obs->second;
+    object_obs->valid_ = valid;
+    std::copy(pose, pose + 6, object_obs->pose_);
+    std::copy(group_pose, group_pose + 6, object_obs->group_pose_);
+    ++it_object_obs;
+  }
+  if (reader.isValid() && it_object_obs != object_observations_.end()) {
+    LOG_ERROR << "The checkpoint has fewer object observations than the "
+              << object_observations_.size() << " rebuilt ones";
+    return false;
+  }
+  observation_store_.updateObjectObservations(object_3d_,
+                                              object_observations_);
+
+  // Camera groups
+  const int nb_cam_groups = reader.read<int>();
+  for (int i = 0; i < nb_cam_groups && reader.isValid(); i++) {
+    const int cam_group_idx = reader.read<int>();
+    const int id_ref_cam = reader.read<int>();
+    std::vector<int> cam_idx = reader.readVector<int>();
+    std::vector<double> poses(6 * cam_idx.size());
+    for (size_t j = 0; j < cam_idx.size(); j++)
+      reader.readBlock(&poses[6 * j], 6);
+    if (!reader.isValid())
+      break;
+
+    if (replaced_cams.count(id_ref_cam) > 0) {
+      LOG_ERROR << "The camera " << id_ref_cam << " is the reference of the "
+                << "camera group " << cam_group_idx
+                << ", it cannot be replaced";
+      return false;
+    }
+    std::shared_ptr<CameraGroup> cam_group =
+        std::make_shared<CameraGroup>(parameter_arena_);
+    cam_group->initializeCameraGroup(id_ref_cam, cam_group_idx);
+    for (size_t j = 0; j < cam_idx.size(); j++) {
+      if (cams_.find(cam_idx[j]) == cams_.end()) {
+        LOG_ERROR << "Unknown camera " << cam_idx[j] << " in the checkpoint";
+        return false;
+      }
+      if (replaced_cams.count(cam_idx[j]) > 0)
+        continue;
+      cam_group->insertCamera(cams_[cam_idx[j]]);
+      cam_group->setCameraPose(Pose(), cam_idx[j]);
+      std::copy(&poses[6 * j], &poses[6 * j] + 6,
+                cam_group->relative_camera_pose_[cam_idx[j]]);
+    }
+    cam_group_[cam_group_idx] = cam_group;
+  }
+
+  // Camera group observations
+  for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
+           cam_group_.begin();
+       it != cam_group_.end(); ++it)
+    initCameraGroupObs(it->first);
+  const int nb_cam_group_obs = reader.read<int>();
+  if (reader.isValid() && replaced_cams.empty() &&
+      nb_cam_group_obs != static_cast<int>(cams_group_obs_.size())) {
+    LOG_ERROR << "The checkpoint has " << nb_cam_group_obs
+              << " camera group observations, " << cams_group_obs_.size()
+              << " are rebuilt";
+    return false;
+  }
+  for (int i = 0; i < nb_cam_group_obs && reader.isValid(); i++) {
+    const int cam_group_idx = reader.read<int>();
+    const int frame_idx = reader.read<int>();
+    std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+        it_obs = cams_group_obs_.find(std::make_pair(cam_group_idx, frame_idx));
+    const int nb_poses = reader.read<int>();
+    // (the observations made only by replaced cameras are not rebuilt)
+    if (reader.isValid() && it_obs == cams_group_obs_.end() &&
+        replaced_cams.empty()) {
+      LOG_ERROR << "The observation of the camera group " << cam_group_idx
+                << " in the frame " << frame_idx << " is not rebuilt";
+      return false;
+    }
+    for (int j = 0; j < nb_poses && reader.isValid(); j++) {
+      const int object_id = reader.read<int>();
+      double pose[6];
+      reader.readBlock(pose, 6);
+      if (!reader.isValid() || it_obs == cams_group_obs_.end())
+        continue;
+      const std::vector<int> &object_idx = it_obs->second->object_idx_;
+      if (std::find(object_idx.begin(), object_idx.end(), object_id) !=
+          object_idx.end())
+        std::copy(pose, pose + 6,
+                  it_obs->second->getObjectPoseBlock(object_id));
+    }
+  }
+  observation_store_.updateCameraGroupObservations(cams_group_obs_);
+
+  // Non-overlapping camera groups
+  const int nb_object_pairs = reader.read<int>();
+  for (int i = 0; i < nb_object_pairs && reader.isValid(); i++) {
+    std::pair<int, int> cam_group_pair;
+    cam_group_pair.first = reader.read<int>();
+    cam_group_pair.second = reader.read<int>();
+    std::pair<int, int> object_pair;
+    object_pair.first = reader.read<int>();
+    object_pair.second = reader.read<int>();
+    no_overlap_object_pair_[cam_group_pair] = object_pair;
+  }
+  const int nb_group_pairs = reader.read<int>();
+  for (int i = 0; i < nb_group_pairs && reader.isValid(); i++) {
+    std::pair<int, int> cam_group_pair;
+    cam_group_pair.first = reader.read<int>();
+    cam_group_pair.second = reader.read<int>();
+    Pose pose;
+    reader.readBlock(pose.rotation_.data(), 9);
+    reader.readBlock(pose.translation_.data(), 3);
+    no_overlap_camgroup_pair_pose_[cam_group_pair] = pose;
+    no_overlap__camgroup_pair_common_cnt_[cam_group_pair] = reader.read<int>();
+  }
+
+  if (!reader.isValid()) {
+    LOG_ERROR << "The checkpoint " << file_path << " is truncated";
+    return false;
+  }
+  LOG_INFO << "Checkpoint " << file_path << " loaded: "
+           << board_observations_.size() << " board observations, "
+           << object_3d_.size() << " objects, " << cam_group_.size()
+           << " camera groups";
+  return true;
+}
+
+/**
+ * @brief Load the checkpoint saved before a stage to resume the calibration
+ * from this stage
+ *
+ * @param stage first stage to run (it must follow a checkpoint stage)
+ *
+ * @return true if the checkpoint was loaded
+ */
+bool Calibration::resumeCalibration(std::string stage) {
+  const std::vector<std::string> &stages = getCheckpointStages();
+  std::vector<std::string>::const_iterator it =
+      std::find(stages.begin(), stages.end(), stage);
+  if (it == stages.end() || it == stages.begin()) {
+    std::string resumable;
+    for (it = stages.begin() + 1; it != stages.end(); ++it)
+      resumable += " " + *it;
+    LOG_ERROR << "Cannot resume from " << stage
+              << ", the calibration can be resumed from:" << resumable;
+    return false;
+  }
+  LOG_INFO << "Resuming the calibration from " << stage;
+  return loadCheckpoint(*(it - 1));
+}
+
+/**
+ * @brief Load a previous calibration to update it with new images or cameras
+ *
+ * The state saved after the final refinement of the previous calibration
+ * (checkpoint_stages must include "final_refinement") is loaded, except the
+ * observations and the intrinsics of the cameras listed in replaced_cameras_.
+ * The images of the other cameras must be unchanged, only the images added
+ * after them will be detected. As in a full calibration, the images of all
+ * the cameras are synchronized by their position in the folders.
+ *
+ * @param check_images check that the images of the previous calibration are
+ * unchanged (false when the new images are not read from the folders, e.g. in
+ * a CalibrationSession)
+ *
+ * @return true if the previous calibration was loaded
+ */
+bool Calibration::loadPreviousCalibration(bool check_images) {
+  LOG_INFO << "Loading the previous calibration";
+  for (const int &cam_idx : replaced_cameras_)
+    if (cams_.find(cam_idx) == cams_.end())
+      LOG_WARNING << "The replaced camera " << cam_idx << " does not exist";
+  if (!loadCheckpoint("final_refinement", true))
+    return false;
+
+  // The images detected by the previous calibration must not have changed
+  std::set<int> checked_cameras;
+  if (check_images)
+    checked_cameras = calibrated_cameras_;
+  for (const int &cam_idx : checked_cameras) {
+    std::vector<cv::String> fn = getCameraImages(cam_idx);
+    bool unchanged = static_cast<int>(fn.size()) >= cams_[cam_idx]->nb_images_;
+    for (std::map<int, std::shared_ptr<Frame>>::iterator it = frames_.begin();
+         it != frames_.end() && unchanged; ++it) {
+      std::map<int, std::string>::iterator it_path =
+          it->second->frame_path_.find(cam_idx);
+      if (it_path != it->second->frame_path_.end())
+        unchanged = it->first < static_cast<int>(fn.size()) &&
+                    fn[it->first] == it_path->second;
+    }
+    if (!unchanged) {
+      LOG_ERROR << "The images of the camera " << cam_idx
+                << " changed since the previous calibration, a full "
+                << "calibration is needed";
+      return false;
+    }
+  }
+
+  incremental_ = true;
+  nb_calibrated_board_obs_ = board_observations_.size();
+  for (std::map<int, std::shared_ptr<Frame>>::iterator it = frames_.begin();
+       it != frames_.end(); ++it)
+    calibrated_frames_.insert(it->first);
+  LOG_INFO << "Previous calibration loaded: " << calibrated_cameras_.size()
+           << " calibrated cameras, "
+           << cams_.size() - calibrated_cameras_.size()
+           << " cameras to calibrate";
+  return true;
+}
+
+/**
+ * @brief Find the camera group containing a camera
+ *
+ * @param cam_idx camera index
+ *
+ * @return index of the camera group (-1 if the camera is in no group)
+ */
+int Calibration::getCameraGroupIdx(int cam_idx) {
+  for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
+           cam_group_.begin();
+       it != cam_group_.end(); ++it) {
+    const std::vector<int> &cam_in_group = it->second->cam_idx;
+    if (std::find(cam_in_group.begin(), cam_in_group.end(), cam_idx) !=
+        cam_in_group.end())
+      return it->first;
+  }
+  return -1;
+}
+
+/**
+ * @brief Insert an object observation in the camera group of its camera
+ *
+ * The observation of the camera group in this frame is created if needed. The
+ * pose of the object in the group is kept if it is already known (e.g. refined
+ * by the previous calibration), otherwise it is computed from the pose of the
+ * camera in the group.
+ *
+ * @param object_obs object observation (with its estimated pose)
+ *
+ * @return false if the camera is not in a camera group
+ */
+bool Calibration::insertObjectObsInCameraGroup(
+    std::shared_ptr<Object3DObs> object_obs) {
+  const int cam_group_idx = getCameraGroupIdx(object_obs->camera_id_);
+  if (cam_group_idx < 0)
+    return false;
+  std::shared_ptr<CameraGroup> cam_group = cam_group_[cam_group_idx];
+  const int frame_idx = object_obs->frame_id_;
+
+  // Observation of the camera group in this frame
+  std::pair<int, int> cam_group_frame_idx =
+      std::make_pair(cam_group_idx, frame_idx);
+  std::shared_ptr<CameraGroupObs> cam_group_obs;
+  std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+      it_obs = cams_group_obs_.find(cam_group_frame_idx);
+  if (it_obs != cams_group_obs_.end()) {
+    cam_group_obs = it_obs->second;
+  } else {
+    cam_group_obs = std::make_shared<CameraGroupObs>(parameter_arena_);
+    cam_group_obs->insertCameraGroup(cam_group);
+    cams_group_obs_[cam_group_frame_idx] = cam_group_obs;
+    frames_[frame_idx]->insertNewCameraGroupObs(cam_group_obs, cam_group_idx);
+    cam_group->insertNewFrame(frames_[frame_idx]);
+  }
+  cam_group_obs->insertObjectObservation(object_obs);
+  cam_group->insertNewObjectObservation(object_obs);
+
+  // Pose of the object in the group
+  const int object_idx = object_obs->object_3d_id_;
+  if (cam_group_obs->object_pose_.find(object_idx) ==
+      cam_group_obs->object_pose_.end())
+    cam_group_obs->setObjectPose(
+        cam_group->getCameraPose(object_obs->camera_id_).inverse() *
+            object_obs->getPose(),
+        object_idx);
+  object_obs->setPoseInGroup(cam_group_obs->getObjectPose(object_idx));
+  return true;
+}
+
+/**
+ * @brief Insert a camera in the camera group sharing the most observations
+ * with it
+ *
+ * The pose of the camera is measured in each frame where a camera group
+ * observes the same object. The camera is inserted in the group with the most
+ * measurements, with their robust average as pose.
+ *
+ * @param cam_idx camera index
+ *
+ * @return false if no camera group shares an observation with the camera
+ */
+bool Calibration::insertCameraInGroup(int cam_idx) {
+  std::map<int, PosePairAggregator>
+      camera_poses; // key: camera group index, value: measured poses
+  std::map<int, std::weak_ptr<Object3DObs>> &object_obs =
+      cams_[cam_idx]->object_observations_;
+  for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it =
+           object_obs.begin();
+       it != object_obs.end(); ++it) {
+    std::shared_ptr<Object3DObs> current_obs = it->second.lock();
+    if (!current_obs || !current_obs->valid_)
+      continue;
+    for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it_group =
+             cam_group_.begin();
+         it_group != cam_group_.end(); ++it_group) {
+      std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+          it_group_obs = cams_group_obs_.find(
+              std::make_pair(it_group->first, current_obs->frame_id_));
+      if (it_group_obs == cams_group_obs_.end())
+        continue;
+      std::map<int, double *>::iterator it_pose =
+          it_group_obs->second->object_pose_.find(current_obs->object_3d_id_);
+      if (it_pose == it_group_obs->second->object_pose_.end())
+        continue;
+      // pose of the group referential in the camera
+      camera_poses[it_group->first].addPose(
+          current_obs->getPose() * Pose::fromBlock(it_pose->second).inverse());
+    }
+  }
+
+  int best_group = -1;
+  for (std::map<int, PosePairAggregator>::iterator it = camera_poses.begin();
+       it != camera_poses.end(); ++it)
+    if (best_group < 0 ||
+        it->second.getNbPoses() > camera_poses[best_group].getNbPoses())
+      best_group = it->first;
+  if (best_group < 0) {
+    LOG_WARNING << "The camera " << cam_idx << " does not share any object "
+                << "observation with a camera group, it is not calibrated";
+    return false;
+  }
+  cam_group_[best_group]->insertCamera(cams_[cam_idx]);
+  cam_group_[best_group]->setCameraPose(
+      camera_poses[best_group].getAveragePose(), cam_idx);
+  LOG_INFO << "Camera " << cam_idx << " inserted in the camera group "
+           << best_group << " (" << camera_poses[best_group].getNbPoses()
+           << " measured poses)";
+  return true;
+}
+
+/**
+ * @brief Insert a camera and all its object observations in a camera group
+ *
+ * @param cam_idx camera index (not in a camera group yet)
+ *
+ * @return false if no camera group shares an observation with the camera
+ */
+bool Calibration::insertCameraObsInGroup(int cam_idx) {
+  if (!insertCameraInGroup(cam_idx))
+    return false;
+  std::map<int, std::weak_ptr<Object3DObs>> &cam_object_obs =
+      cams_[cam_idx]->object_observations_;
+  for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it =
+           cam_object_obs.begin();
+       it != cam_object_obs.end(); ++it)
+    insertObjectObsInCameraGroup(it->second.lock());
+  return true;
+}
+
+/**
+ * @brief Initialize the objects observed in new camera observations
+ *
+ * The object observations are created, their pose is estimated with a PnP
+ * and they are inserted in the camera groups (the observations of the cameras
+ * without group are inserted when the camera is located). The observation
+ * store is not updated.
+ *
+ * @param cam_frame_idx keys (Cam ind/Frame ind) of the new camera observations
+ *
+ * @return index of the first new object observation
+ */
+int Calibration::initNewObjectObs(
+    const std::set<std::pair<int, int>> &cam_frame_idx) {
+  const int first_object_obs = object_observations_.size();
+  std::vector<std::pair<int, int>> cam_frames(cam_frame_idx.begin(),
+                                              cam_frame_idx.end());
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           object_3d_.begin();
+       it != object_3d_.end(); ++it)
+    init3DObjectObs(it->first, cam_frames);
+  for (std::map<int, std::shared_ptr<Object3DObs>>::iterator it =
+           object_observations_.lower_bound(first_object_obs);
+       it != object_observations_.end(); ++it) {
+    it->second->estimatePose(ransac_thresh_);
+    insertObjectObsInCameraGroup(it->second);
+  }
+  return first_object_obs;
+}
+
+/**
+ * @brief Initialize the observations added to a previous calibration
+ *
+ * The intrinsics of the new cameras are refined, the objects observed in the
+ * new camera observations are initialized with a PnP and inserted in the
+ * camera groups. The cameras which are not in a group are inserted in the
+ * group sharing the most observations with them.
+ */
+void Calibration::initIncrementalCalibration() {
+  LOG_INFO << "Incremental initialization";
+  // The outliers have been removed, the observations can be stored
+  observation_store_.initBoardObservations(board_observations_, cams_);
+
+  // Intrinsics of the new cameras (initialized by the detection stages)
+  std::vector<std::shared_ptr<Camera>> new_cams;
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
+       it != cams_.end(); ++it)
+    if (calibrated_cameras_.count(it->first) == 0)
+      new_cams.push_back(it->second);
+  if (fix_intrinsic_ == 0) {
+    thread_pool_->parallelFor(new_cams.size(), [&](int i) {
+      new_cams[i]->refineIntrinsicCalibration(nb_iterations_,
+                                              observation_store_);
+    });
+  }
+
+  // Observations of the objects in the new camera observations
+  new_cam_frames_.clear();
+  for (std::map<int, std::shared_ptr<BoardObs>>::iterator it =
+           board_observations_.lower_bound(nb_calibrated_board_obs_);
+       it != board_observations_.end(); ++it)
+    new_cam_frames_.insert(
+        std::make_pair(it->second->camera_id_, it->second->frame_id_));
+  const int first_object_obs = initNewObjectObs(new_cam_frames_);
+
+  // The other cameras are located with the poses of the objects in the new
+  // frames
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it = cams_.begin();
+       it != cams_.end(); ++it)
+    if (getCameraGroupIdx(it->first) < 0)
+      insertCameraObsInGroup(it->first);
+  observation_store_.updateObjectObservations(object_3d_,
+                                              object_observations_);
+  observation_store_.updateCameraGroupObservations(cams_group_obs_);
+  LOG_INFO << new_cam_frames_.size() << " new camera observations, "
+           << object_observations_.size() - first_object_obs
+           << " new object observations";
+}
+
+/**
+ * @brief Refine the part of the calibration observed by the new images
+ *
+ * Only the residuals of the new camera observations are used. The poses of
+ * the new cameras and of the objects in the new frames are refined from their
+ * initialization, the cameras and frames of the previous calibration are kept
+ * constant (the final refinement then refines all of them).
+ */
+void Calibration::refineIncrementalCalibration() {
+  // Precompute the 3D points of the objects
   for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
            object_3d_.begin();
        it != object_3d_.end(); it++) {
     it->second->updateObjectPts();
   }
 
+  // Poses of the previous calibration
+  std::vector<std::shared_ptr<CameraGroup>> cam_groups;
+  std::vector<std::set<double *>> constant_blocks;
+  for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
+           cam_group_.begin();
+       it != cam_group_.end(); ++it) {
+    std::set<double *> constant_poses;
+    for (const int &cam_idx : it->second->cam_idx)
+      if (calibrated_cameras_.count(cam_idx) > 0)
+        constant_poses.insert(it->second->relative_camera_pose_[cam_idx]);
+    for (const int &frame_idx : calibrated_frames_) {
+      std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+          it_obs = cams_group_obs_.find(std::make_pair(it->first, frame_idx));
+      if (it_obs == cams_group_obs_.end())
+        continue;
+      for (std::map<int, double *>::iterator it_pose =
+               it_obs->second->object_pose_.begin();
+           it_pose != it_obs->second->object_pose_.end(); ++it_pose)
+        constant_poses.insert(it_pose->second);
+    }
+    cam_groups.push_back(it->second);
+    constant_blocks.push_back(constant_poses);
+  }
+
+  thread_pool_->parallelFor(cam_groups.size(), [&](int i) {
+    cam_groups[i]->refineCameraGroupObservations(
+        nb_iterations_, observation_store_, new_cam_frames_,
+        constant_blocks[i]);
+  });
+
   // Update the object3D observation
   for (std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
            it = cams_group_obs_.begin();
@@ -7,6 +7,7 @@
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/opencv.hpp>
+#include <set>
 #include <stdio.h>
 
 #include "Board.hpp"
@@ -19,8 +20,24 @@
 #include "Graph.hpp"
 #include "Object3D.hpp"
 #include "Object3DObs.hpp"
+#include "ObservationStore.hpp"
+#include "ParameterArena.hpp"
+#include "Pose.hpp"
+#include "Pipeline.hpp"
+#include "PosePairAggregator.hpp"
+#include "ThreadPool.hpp"
 #include "geometrytools.hpp"
 
+// Board detected in an image, waiting to be inserted in the data structures
+struct BoardDetection {
+  int cam_idx, frame_idx, board_idx;
+  std::vector<cv::Point2f> pts_2d;     // detected corners
+  std::vector<int> charuco_idx;        // indices of the detected corners
+  std::string frame_path;              // path of the image
+  std::shared_ptr<BoardObs> board_obs; // observation with its pose (only if
+                                       // the intrinsics are preloaded)
+};
+
 /**
  * @class Calibration
  *
@@ -61,6 +78,12 @@ public:
   // Optimization parameters
   double ransac_thresh_; // threshold in pixel
   int nb_iterations_;    // max number of iteration for refinements
+  int fix_board_merge_;  // do not refine the boards poses when merging objects
+
+  // refine the poses chained along the graphs with all the pairs
+  int pose_graph_refinement_;
+  double pose_graph_translation_weight_ = 1.0; // translation residual weight
+                                               // (rotation residuals in rad)
 
   // hand-eye technique
   int he_approach_;
@@ -68,6 +91,40 @@ public:
   // fix intrinsic parameters
   int fix_intrinsic_;
 
+  // multi-threading
+  int nb_thread_; // number of threads for the refinements (0: all the cores)
+  std::shared_ptr<ThreadPool> thread_pool_; // workers shared by the stages
+  int pair_pose_chunk_ = 64; // frames per job when computing the pair poses
+  int serial_pipeline_; // run the stages one after the other (no overlap)
+
+  // checkpoints
+  std::vector<std::string> checkpoint_stages_; // stages saved in save_path_
+
+  // incremental calibration (update of a previous calibration)
+  std::vector<int> replaced_cameras_; // cameras recalibrated from scratch
+  bool incremental_ = false;          // a previous calibration is updated
+  std::set<int> calibrated_cameras_;  // cameras of the previous calibration
+  std::set<int> calibrated_frames_;   // frames of the previous calibration
+  int nb_calibrated_board_obs_ = 0;   // board observations loaded
+  std::set<std::pair<int, int>>
+      new_cam_frames_; // camera observations (Cam ind/Frame ind) added
+
+  // online calibration session
+  int session_window_;             // keyframes refined after each frame set
+  double session_keyframe_motion_; // corner motion (px) to add a keyframe
+
+  // solver telemetry
+  int solver_telemetry_; // save the solver iterations in solver_telemetry.jsonl
+  int silent_solver_;    // do not print the solver progress on stdout
+  int trace_events_;     // save the timeline in trace_events.json
+  int perf_counters_;    // add the hardware counters to the stage profile
+
+  // Parameter blocks (poses and intrinsics) of all the data structures
+  std::shared_ptr<ParameterArena> parameter_arena_;
+
+  // Flat copy of the observations used by the refinements
+  ObservationStore observation_store_;
+
   // Data structures
   std::map<int, std::shared_ptr<BoardObs>>
       board_observations_; // Observation of the boards (2d points)
@@ -86,18 +143,18 @@ public:
       cams_group_obs_; // The cameras group key=CamGroup ind/Frame ind
 
   // Relationship between boards seen in the same images
-  std::map<std::pair<int, int>, std::vector<cv::Mat>>
-      board_pose_pairs_; // key: (boardind1,boardind2) value: Vector of poses
-  std::map<std::pair<int, int>, cv::Mat>
+  std::map<std::pair<int, int>, PosePairAggregator>
+      board_pose_pairs_; // key: (boardind1,boardind2) value: measured poses
+  std::map<std::pair<int, int>, Pose>
       inter_board_transform_; // key: (boardind1,boardind2) value: Pose between
                               // the two boards
   Graph covis_boards_graph_;  // graph of inter-boards relationship (vertex:
                               // boardId, edge: number of co-visibility)
 
   // Relationship between cameras seeing the same objects
-  std::map<std::pair<int, int>, std::vector<cv::Mat>>
-      camera_pose_pairs_; // key: (boardind1,boardind2) value: Vector of poses
-  std::map<std::pair<int, int>, cv::Mat>
+  std::map<std::pair<int, int>, PosePairAggregator>
+      camera_pose_pairs_; // key: (boardind1,boardind2) value: measured poses
+  std::map<std::pair<int, int>, Pose>
       inter_camera_transform_; // key: (cameraind1,cameraind2) value: Pose
                                // between the two cameras
   Graph covis_camera_graph_;   // graph of inter-cameras relationship (vertex:
@@ -105,9 +162,9 @@ public:
 
   // Relationship between 3d object seeing in the same frame
   // Relationship between object seen in the same images
-  std::map<std::pair<int, int>, std::vector<cv::Mat>>
-      object_pose_pairs_; // key: (objectind1,objectind2) value: Vector of poses
-  std::map<std::pair<int, int>, cv::Mat>
+  std::map<std::pair<int, int>, PosePairAggregator>
+      object_pose_pairs_; // key: (objectind1,objectind2) value: measured poses
+  std::map<std::pair<int, int>, Pose>
       inter_object_transform_; // key: (objectind1,objectind2) value: Pose
                                // between the two objects
   Graph covis_objects_graph_;  // graph of inter-objects relationship (vertex:
@@ -117,14 +174,19 @@ public:
   std::map<std::pair<int, int>, std::pair<int, int>>
       no_overlap_object_pair_; // key: (CamGroup1, CamGroup2) value:
                                // (object id1, object id2)
-  std::map<std::pair<int, int>, cv::Mat>
-      no_overlap_camgroup_pair_pose_; // key (CamGroup1, CamGroup2), value: 4x4
-                                      // transformation matrix
+  std::map<std::pair<int, int>, Pose>
+      no_overlap_camgroup_pair_pose_; // key (CamGroup1, CamGroup2), value:
+                                      // transformation between the groups
   std::map<std::pair<int, int>, int>
       no_overlap__camgroup_pair_common_cnt_; // count number of frame in common
                                              // btw the two groups
   Graph no_overlap_camgroup_graph_;          // graph of inter-camgroup pose
                                              // determined without overlapping
+  std::map<std::pair<int, int>,
+           std::vector<std::pair<std::weak_ptr<CameraGroupObs>,
+                                 std::weak_ptr<CameraGroupObs>>>>
+      no_overlap_common_obs_; // key: (CamGroup1, CamGroup2) value: obs of the
+                              // two groups in each common frame
 
   // Main functions
   void initIntrinsic();
@@ -138,10 +200,24 @@ public:
   void
   initialization(std::string config_path); // initialize the charuco pattern, nb
                                            // of cameras, nb of boards etc.
+  int addCalibrationStages(
+      Pipeline &pipeline,
+      std::string resume_from = ""); // add the stages (from resume_from)
   void boardExtraction();
+  std::vector<cv::String>
+  getCameraImages(int cam_idx); // images of a camera sorted by name
+  void detectCameraBoards(
+      int cam_idx,
+      std::vector<BoardDetection> &detections); // detect in all the images
+  void insertBoardDetections(
+      const std::vector<BoardDetection> &detections); // insert the boards
   void
   detectBoards(cv::Mat image, int cam_idx, int frame_idx,
                std::string frame_path); // detect the board in the input frame
+  void detectBoards(cv::Mat image, int cam_idx, int frame_idx,
+                    std::string frame_path,
+                    std::vector<BoardDetection> &detections,
+                    bool estimate_pose = false);
   void saveCamerasParams();             // Save all cameras params
   void save3DObj();                     // Save 3D objects
   void save3DObjPose();                 // Save 3D objects pose
@@ -151,13 +227,19 @@ public:
                       std::vector<int> charuco_idx,
                       std::string frame_path); // insert a new board in all the
                                                // different datastructure
+  void insertNewBoard(std::shared_ptr<BoardObs> new_board,
+                      std::string frame_path); // insert an initialized board
   void
   insertNewObjectObservation(std::shared_ptr<Object3DObs>
                                  new_obj_obs); // insert new object observation
   void initializeCalibrationAllCam(); // initialize the calibration of all the
                                       // cameras
+  void initializeCalibrationCam(int cam_idx); // initialize one camera
+  bool hasPreloadedIntrinsics(); // intrinsics loaded from cam_params_path_
   void estimatePoseAllBoards(); // Estimate the pose of all visible boards using
                                 // a PnP
+  void estimatePoseCamBoards(int cam_idx); // boards seen by one camera
+  void refineIntrinsic(); // refine the intrinsics initialized for all cameras
   void refineIntrinsicAndPoseAllCam(); // Refine all the cameras intrinsic and
                                        // pose wrt. the boards
   void computeReproErrAllBoard();      // compute the reprojection error for al
@@ -170,6 +252,9 @@ public:
   void init3DObjects(); // initialize the 3D objects with the board graph
   void
   init3DObjectObs(int object_idx); // initialize the 3D objects observations
+  void init3DObjectObs(int object_idx,
+                       const std::vector<std::pair<int, int>>
+                           &cam_frame_idx); // in some camera observations
   void initAll3DObjectObs();       // initialize all the 3D objects observations
   void estimatePoseAllObjects();   // Estimate the pose of all visible object
                                    // using a PnP
@@ -186,6 +271,7 @@ public:
       int camera_group_idx);    // Initialize observation of cameraGroup
   void initAllCameraGroupObs(); // initialize all camera groups
   void refineAllCameraGroup();  // Refine all camera group pose
+  void initNonOverlapCommonObs(); // index the frames shared by camera groups
   void findPairObjectForNonOverlap();
   void
   initNonOverlapPair(int cam_group_id1,
@@ -200,19 +286,52 @@ public:
                                  // camera group
   void computeAllObjPoseInCameraGroup();
   void computeObjectsPairPose();
-  cv::Mat computeDistanceBetweenPoints(std::vector<cv::Point2f> obj_pts_2d,
-                                       std::vector<cv::Point2f> repro_pts);
+  cv::Mat
+  computeDistanceBetweenPoints(const std::vector<cv::Point2f> &obj_pts_2d,
+                               const std::vector<cv::Point2f> &repro_pts);
   double computeAvgReprojectionError();
   void initInterObjectsTransform();
   void initInterObjectsGraph();
   void mergeObjects();
   void mergeAllObjectObs();
   void reproErrorAllCamGroup();
+  std::vector<std::vector<int>>
+  findIndependentCameraGroups(); // camera groups not sharing any object
+  void refinePoseGraph(
+      std::string stage, int ref_id,
+      const std::map<std::pair<int, int>, Pose> &inter_transform,
+      const std::map<std::pair<int, int>, PosePairAggregator> &pose_pairs,
+      bool invert_transform,
+      std::map<int, Pose> &pose_to_ref); // refine the poses with all the pairs
   void refineAllCameraGroupAndObjects();
   void refineAllCameraGroupAndObjectsAndIntrinsic();
+  void buildFinalRefinement(); // build the problems of the final refinement
+  void runFinalRefinement(bool refine_intrinsics); // solve the final problems
+  void releaseFinalRefinement(); // release the final refinement problems
+  void finalRefinement(); // build, run and release the final refinement
   void saveReprojection(int cam_id);
   void saveReprojectionAllCam();
   void saveDetection(int cam_id);
   void saveDetectionAllCam();
   void saveReprojectionErrorToFile();
+  std::map<std::string, long>
+  getStageCounts(); // number of objects recorded by the stage profiler
+  static const std::vector<std::string> &
+  getCheckpointStages(); // stages followed by a checkpoint, in order
+  std::string getCheckpointPath(std::string stage);
+  void saveCheckpoint(std::string stage); // save the state after the stage
+  bool loadCheckpoint(std::string stage,
+                      bool incremental = false); // load the state after stage
+  bool resumeCalibration(std::string stage); // load the state before stage
+  bool loadPreviousCalibration(
+      bool check_images = true); // load a calibration to update it
+  int getCameraGroupIdx(int cam_idx); // camera group of a camera (or -1)
+  bool insertObjectObsInCameraGroup(
+      std::shared_ptr<Object3DObs> object_obs); // insert in the group obs
+  bool insertCameraInGroup(int cam_idx); // locate a new camera in a group
+  bool insertCameraObsInGroup(int cam_idx); // with its object observations
+  int initNewObjectObs(const std::set<std::pair<int, int>>
+                           &cam_frame_idx); // objects in new camera obs
+  void initIncrementalCalibration();   // initialize the new observations
+  void refineIncrementalCalibration(); // refine the new observations
 };
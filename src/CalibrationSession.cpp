@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <chrono>
+
+#include "CalibrationSession.hpp"
+#include "PerfCounters.hpp"
+#include "TraceSink.hpp"
+#include "logger.h"
+
+/**
+ * @brief Create a session updating a calibration
+ *
+ * @param calib calibration initialized with its configuration file
+ */
+CalibrationSession::CalibrationSession(std::shared_ptr<Calibration> calib)
+    : calib_(calib) {}
+
+/**
+ * @brief Load the previous calibration and prepare the session
+ *
+ * The cameras which are not in the previous calibration are initialized with
+ * the intrinsics of cam_params_path_, their images are ignored otherwise.
+ *
+ * @param check_images check that the images of the previous calibration are
+ * still in the folders of the cameras
+ *
+ * @return true if the session can receive frame sets
+ */
+bool CalibrationSession::start(bool check_images) {
+  if (!calib_->loadPreviousCalibration(check_images))
+    return false;
+  window_size_ = std::max(calib_->session_window_, 1);
+
+  // Cameras whose boards can be located
+  session_cameras_.clear();
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it =
+           calib_->cams_.begin();
+       it != calib_->cams_.end(); ++it) {
+    if (calib_->calibrated_cameras_.count(it->first) == 0) {
+      if (!calib_->hasPreloadedIntrinsics()) {
+        LOG_WARNING << "The camera " << it->first << " is not calibrated and "
+                    << "no intrinsics are given (cam_params_path), its "
+                    << "images are ignored by the session";
+        continue;
+      }
+      calib_->initializeCalibrationCam(it->first);
+    }
+    session_cameras_.insert(it->first);
+  }
+
+  // The frame sets follow the frames of the previous calibration
+  next_frame_idx_ = 0;
+  if (!calib_->frames_.empty())
+    next_frame_idx_ = calib_->frames_.rbegin()->first + 1;
+  for (const int &cam_idx : calib_->calibrated_cameras_)
+    next_frame_idx_ =
+        std::max(next_frame_idx_, calib_->cams_[cam_idx]->nb_images_);
+
+  // The cameras and the objects of the window do not change
+  std::map<int, std::shared_ptr<BoardObs>> no_board_obs;
+  std::map<int, std::shared_ptr<Object3DObs>> no_object_obs;
+  window_store_.initBoardObservations(no_board_obs, calib_->cams_);
+  window_store_.updateObjectObservations(calib_->object_3d_, no_object_obs);
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           calib_->object_3d_.begin();
+       it != calib_->object_3d_.end(); ++it)
+    it->second->updateObjectPts();
+
+  window_.clear();
+  keyframe_pts_.clear();
+  nb_frame_sets_ = 0;
+  nb_keyframes_ = 0;
+  total_latency_ = 0.0;
+  max_latency_ = 0.0;
+  started_ = true;
+  LOG_INFO << "Calibration session started at frame " << next_frame_idx_
+           << " (" << session_cameras_.size() << " cameras, window of "
+           << window_size_ << " keyframes)";
+  return true;
+}
+
+/**
+ * @brief Process a synchronized frame set
+ *
+ * The boards are detected in the images of all the cameras concurrently. If
+ * the frame set is a keyframe, its observations are inserted in the
+ * calibration and the window of the last keyframes is refined.
+ *
+ * @param images image of each camera (indexed by camera index, an empty image
+ * if the camera did not capture this frame)
+ * @param frame_paths path of the images, recorded in the frames (optional)
+ *
+ * @return frame index, number of boards and time spent in each step
+ */
+CalibrationSession::FrameReport
+CalibrationSession::pushFrameSet(const std::vector<cv::Mat> &images,
+                                 const std::vector<std::string> &frame_paths) {
+  FrameReport report;
+  if (!started_) {
+    LOG_ERROR << "The calibration session is not started";
+    return report;
+  }
+  if (images.size() != calib_->cams_.size()) {
+    LOG_ERROR << "A frame set must contain one image per camera ("
+              << images.size() << " images for " << calib_->cams_.size()
+              << " cameras)";
+    return report;
+  }
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  report.frame_idx = next_frame_idx_++;
+  TraceScope trace("push_frame_set", "session");
+
+  // The session runs alone on the pool
+  ThreadBudget budget(calib_->thread_pool_->getNbThreads());
+  trace.addArg("frame", report.frame_idx);
+
+  // Detect the boards in all the images
+  std::vector<int> cam_indices(session_cameras_.begin(),
+                               session_cameras_.end());
+  std::vector<std::vector<BoardDetection>> cam_detections(cam_indices.size());
+  calib_->thread_pool_->parallelFor(cam_indices.size(), [&](int i) {
+    const int cam_idx = cam_indices[i];
+    if (images[cam_idx].empty())
+      return;
+    std::string frame_path;
+    if (cam_idx < static_cast<int>(frame_paths.size()))
+      frame_path = frame_paths[cam_idx];
+    PerfScope perf("detect_boards");
+    calib_->detectBoards(images[cam_idx], cam_idx, report.frame_idx,
+                         frame_path, cam_detections[i]);
+  });
+  std::vector<BoardDetection> detections;
+  for (const std::vector<BoardDetection> &cam_detection : cam_detections)
+    detections.insert(detections.end(), cam_detection.begin(),
+                      cam_detection.end());
+  report.nb_boards = detections.size();
+  std::chrono::steady_clock::time_point detected =
+      std::chrono::steady_clock::now();
+  report.detection_time =
+      std::chrono::duration<double>(detected - start).count();
+
+  // Update the calibration with the keyframes only
+  report.keyframe = isKeyframe(detections);
+  if (report.keyframe) {
+    insertKeyframe(report.frame_idx, detections);
+    std::chrono::steady_clock::time_point inserted =
+        std::chrono::steady_clock::now();
+    report.insertion_time =
+        std::chrono::duration<double>(inserted - detected).count();
+    refineWindow();
+    report.refinement_time = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - inserted)
+                                 .count();
+  }
+  report.nb_keyframes = window_.size();
+  report.latency = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  nb_frame_sets_++;
+  total_latency_ += report.latency;
+  max_latency_ = std::max(max_latency_, report.latency);
+  LOG_DEBUG << "Frame set " << report.frame_idx << ": " << report.nb_boards
+            << " boards, keyframe " << report.keyframe << ", detection "
+            << report.detection_time << " s, insertion "
+            << report.insertion_time << " s, refinement "
+            << report.refinement_time << " s, latency " << report.latency
+            << " s";
+  return report;
+}
+
+/**
+ * @brief Refine all the parameters with all the observations
+ *
+ * The final refinement of the calibration is run on the previous observations
+ * and the keyframes of the session. The results can then be saved as after a
+ * calibration.
+ *
+ * @return false if the session was not started
+ */
+bool CalibrationSession::finish() {
+  if (!started_) {
+    LOG_ERROR << "The calibration session is not started";
+    return false;
+  }
+  started_ = false;
+  if (nb_frame_sets_ > 0)
+    LOG_INFO << "Calibration session: " << nb_frame_sets_ << " frame sets, "
+             << nb_keyframes_ << " keyframes, mean latency "
+             << total_latency_ / nb_frame_sets_ << " s, max latency "
+             << max_latency_ << " s";
+  if (nb_keyframes_ == 0) {
+    LOG_WARNING << "No keyframe was added, the calibration is unchanged";
+    return true;
+  }
+
+  // The final refinement runs alone on the pool
+  ThreadBudget budget(calib_->thread_pool_->getNbThreads());
+  calib_->observation_store_.initBoardObservations(calib_->board_observations_,
+                                                   calib_->cams_);
+  calib_->observation_store_.updateObjectObservations(
+      calib_->object_3d_, calib_->object_observations_);
+  calib_->observation_store_.updateCameraGroupObservations(
+      calib_->cams_group_obs_);
+  calib_->finalRefinement();
+  calib_->reproErrorAllCamGroup();
+  return true;
+}
+
+/**
+ * @brief Get the number of keyframes added since the start of the session
+ *
+ * @return number of keyframes
+ */
+int CalibrationSession::getNbKeyframes() const { return nb_keyframes_; }
+
+/**
+ * @brief Check if a frame set brings new observations to the calibration
+ *
+ * @param detections boards detected in the frame set
+ *
+ * @return true if a board is seen by a camera for the first time or if the
+ * mean motion of its corners since the last keyframe exceeds
+ * session_keyframe_motion_
+ */
+bool CalibrationSession::isKeyframe(
+    const std::vector<BoardDetection> &detections) {
+  for (const BoardDetection &detection : detections) {
+    std::map<std::pair<int, int>, std::map<int, cv::Point2f>>::iterator it =
+        keyframe_pts_.find(
+            std::make_pair(detection.cam_idx, detection.board_idx));
+    if (it == keyframe_pts_.end())
+      return true;
+    double motion = 0.0;
+    int nb_common_pts = 0;
+    for (size_t i = 0; i < detection.charuco_idx.size(); i++) {
+      std::map<int, cv::Point2f>::iterator it_pt =
+          it->second.find(detection.charuco_idx[i]);
+      if (it_pt == it->second.end())
+        continue;
+      motion += cv::norm(detection.pts_2d[i] - it_pt->second);
+      nb_common_pts++;
+    }
+    if (nb_common_pts == 0 ||
+        motion / nb_common_pts > calib_->session_keyframe_motion_)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Insert the boards of a keyframe in the calibration
+ *
+ * The poses of the boards and of the objects are estimated with a PnP and the
+ * objects are inserted in the camera groups. The new cameras observing an
+ * object seen by a camera group are located in this group.
+ *
+ * @param frame_idx frame index of the keyframe
+ * @param detections boards detected in the keyframe
+ */
+void CalibrationSession::insertKeyframe(
+    int frame_idx, const std::vector<BoardDetection> &detections) {
+  const int first_board_obs = calib_->board_observations_.size();
+  calib_->insertBoardDetections(detections);
+  std::set<std::pair<int, int>> cam_frame_idx;
+  for (std::map<int, std::shared_ptr<BoardObs>>::iterator it =
+           calib_->board_observations_.lower_bound(first_board_obs);
+       it != calib_->board_observations_.end(); ++it) {
+    it->second->estimatePose(calib_->ransac_thresh_);
+    cam_frame_idx.insert(
+        std::make_pair(it->second->camera_id_, it->second->frame_id_));
+  }
+  calib_->initNewObjectObs(cam_frame_idx);
+  for (const std::pair<int, int> &cam_frame : cam_frame_idx)
+    if (calib_->getCameraGroupIdx(cam_frame.first) < 0)
+      calib_->insertCameraObsInGroup(cam_frame.first);
+
+  // Reference of the motion for the next frame sets
+  for (const BoardDetection &detection : detections) {
+    std::map<int, cv::Point2f> &pts = keyframe_pts_[std::make_pair(
+        detection.cam_idx, detection.board_idx)];
+    pts.clear();
+    for (size_t i = 0; i < detection.charuco_idx.size(); i++)
+      pts[detection.charuco_idx[i]] = detection.pts_2d[i];
+  }
+
+  window_.push_back(frame_idx);
+  if (static_cast<int>(window_.size()) > window_size_)
+    window_.pop_front();
+  nb_keyframes_++;
+}
+
+/**
+ * @brief Refine the poses observed in the window of the last keyframes
+ *
+ * The poses of the objects in the keyframes and of the cameras added during
+ * the session are refined from their current value, the cameras of the
+ * previous calibration are kept constant.
+ */
+void CalibrationSession::refineWindow() {
+  std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>> window_obs;
+  std::set<std::pair<int, int>> cam_frame_idx;
+  for (const int &frame_idx : window_) {
+    for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
+             calib_->cam_group_.begin();
+         it != calib_->cam_group_.end(); ++it) {
+      std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+          it_obs = calib_->cams_group_obs_.find(
+              std::make_pair(it->first, frame_idx));
+      if (it_obs != calib_->cams_group_obs_.end())
+        window_obs[it_obs->first] = it_obs->second;
+    }
+    for (const int &cam_idx : session_cameras_)
+      cam_frame_idx.insert(std::make_pair(cam_idx, frame_idx));
+  }
+  window_store_.updateCameraGroupObservations(window_obs);
+
+  // Poses of the previous calibration
+  std::vector<std::shared_ptr<CameraGroup>> cam_groups;
+  std::vector<std::set<double *>> constant_blocks;
+  for (std::map<int, std::shared_ptr<CameraGroup>>::iterator it =
+           calib_->cam_group_.begin();
+       it != calib_->cam_group_.end(); ++it) {
+    std::set<double *> constant_poses;
+    for (const int &cam_idx : it->second->cam_idx)
+      if (calib_->calibrated_cameras_.count(cam_idx) > 0)
+        constant_poses.insert(it->second->relative_camera_pose_[cam_idx]);
+    cam_groups.push_back(it->second);
+    constant_blocks.push_back(constant_poses);
+  }
+
+  calib_->thread_pool_->parallelFor(cam_groups.size(), [&](int i) {
+    cam_groups[i]->refineCameraGroupObservations(
+        calib_->nb_iterations_, window_store_, cam_frame_idx,
+        constant_blocks[i]);
+  });
+
+  for (std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>::iterator
+           it = window_obs.begin();
+       it != window_obs.end(); ++it)
+    it->second->updateObjObsPose();
+}
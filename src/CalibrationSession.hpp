@@ -0,0 +1,85 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Calibration.hpp"
+#include "ObservationStore.hpp"
+
+/**
+ * @class CalibrationSession
+ *
+ * @brief Online update of a calibration with synchronized frame sets
+ *
+ * The session starts from a previous calibration (loadPreviousCalibration)
+ * and receives one image per camera at a time:
+ *
+ *   CalibrationSession session(calib);
+ *   if (session.start())
+ *     while (capturing)
+ *       CalibrationSession::FrameReport report = session.pushFrameSet(images);
+ *   session.finish();
+ *
+ * The boards are detected in all the images concurrently. A frame set is only
+ * added to the calibration when it brings new information (a keyframe): a
+ * board seen by a camera for the first time or corners moving by more than
+ * session_keyframe_motion_ pixels since the last keyframe. The objects of a
+ * keyframe are initialized with a PnP and the poses in the camera groups are
+ * refined, starting from the current solution, with the residuals of the last
+ * session_window_ keyframes only, so the time spent per frame set does not
+ * grow with the session. The cameras of the previous calibration and the
+ * intrinsics are kept constant until finish, which refines all the parameters
+ * with all the observations.
+ */
+class CalibrationSession {
+public:
+  // Result of a frame set
+  struct FrameReport {
+    int frame_idx = -1;         // index given to the frame set
+    bool keyframe = false;      // true if the frame set was added
+    int nb_boards = 0;          // boards detected in all the images
+    int nb_keyframes = 0;       // keyframes in the refined window
+    double detection_time = 0;  // seconds
+    double insertion_time = 0;  // initialization of the keyframe (seconds)
+    double refinement_time = 0; // refinement of the window (seconds)
+    double latency = 0;         // total time of the frame set (seconds)
+  };
+
+  // Functions
+  CalibrationSession(std::shared_ptr<Calibration> calib);
+  ~CalibrationSession(){};
+  bool start(bool check_images = false);
+  FrameReport pushFrameSet(const std::vector<cv::Mat> &images,
+                           const std::vector<std::string> &frame_paths =
+                               std::vector<std::string>());
+  bool finish();
+  int getNbKeyframes() const;
+
+private:
+  std::shared_ptr<Calibration> calib_; // calibration updated by the session
+  bool started_ = false;               // the previous calibration is loaded
+  int window_size_ = 1;                // keyframes refined per frame set
+  int next_frame_idx_ = 0;             // index of the next frame set
+  std::set<int> session_cameras_;      // cameras with known intrinsics
+  std::deque<int> window_;             // frame index of the last keyframes
+  ObservationStore window_store_;      // observations of the window
+  std::map<std::pair<int, int>, std::map<int, cv::Point2f>>
+      keyframe_pts_; // key: (Cam ind, Board ind), value: corners of the
+                     // last keyframe observing the board (key: corner id)
+
+  // Latency of the session
+  int nb_frame_sets_ = 0;      // frame sets pushed
+  int nb_keyframes_ = 0;       // keyframes added
+  double total_latency_ = 0.0; // seconds
+  double max_latency_ = 0.0;   // seconds
+
+  bool isKeyframe(const std::vector<BoardDetection> &detections);
+  void insertKeyframe(int frame_idx,
+                      const std::vector<BoardDetection> &detections);
+  void refineWindow();
+};
@@ -2,13 +2,26 @@
 #include <iostream>
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/opencv.hpp>
+#include <random>
 #include <stdio.h>
 
 #include "Camera.hpp"
+#include "ObservationStore.hpp"
 #include "OptimizationCeres.h"
+#include "SolverTelemetry.hpp"
 #include "logger.h"
 
-Camera::Camera() {}
+/**
+ * @brief Create the camera
+ *
+ * The intrinsics are allocated in the parameter arena.
+ *
+ * @param parameter_arena storage of the parameter blocks
+ */
+Camera::Camera(std::shared_ptr<ParameterArena> parameter_arena)
+    : parameter_arena_(parameter_arena) {
+  intrinsics_ = parameter_arena_->allocate(ParameterArena::CameraIntrinsics, 9);
+}
 
 /**
  * @brief Get camera matrix (K)
@@ -168,11 +181,13 @@ void Camera::initializeCalibration() {
   for (int i = 0; i < board_observations_.size(); i++) {
     indbv.push_back(i);
   }
-  std::srand(unsigned(std::time(0)));
+  // Cameras are initialized concurrently, so each one shuffles with its own
+  // engine seeded from its index (no shared rand() state, reproducible runs)
+  std::mt19937 rng(cam_idx_);
   std::vector<int> shuffled_board_ind;
   for (unsigned int i = 0; i < indbv.size(); ++i)
     shuffled_board_ind.push_back(i);
-  random_shuffle(shuffled_board_ind.begin(), shuffled_board_ind.end());
+  std::shuffle(shuffled_board_ind.begin(), shuffled_board_ind.end(), rng);
 
   // Prepare list of 2D-3D correspondences
   std::vector<std::vector<cv::Point3f>> obj_points;
@@ -250,25 +265,23 @@ void Camera::computeReproErrAllBoard() {
 /**
  * @brief Refinement of the camera parameters of the current camera
  *
+ * @param nb_iterations number of iterations of non-linear refinement
+ * @param store observations of the calibration
  */
-void Camera::refineIntrinsicCalibration(int nb_iterations) {
+void Camera::refineIntrinsicCalibration(int nb_iterations,
+                                        const ObservationStore &store) {
   ceres::Problem problem;
   double loss = 1;
   LOG_INFO << "Parameters before optimization :: " << this->getCameraMat();
   LOG_INFO << "distortion vector :: " << getDistortionVectorVector();
-  for (std::map<int, std::weak_ptr<BoardObs>>::iterator it =
-           board_observations_.begin();
-       it != board_observations_.end(); ++it) {
-    std::shared_ptr<BoardObs> board_obs_ptr = it->second.lock();
-    if (board_obs_ptr->valid_ == true) {
-      std::shared_ptr<Board> board_3d_ptr = board_obs_ptr->board_3d_.lock();
-      std::vector<cv::Point3f> board_pts_3d = board_3d_ptr->pts_3d_;
-      std::vector<int> board_pts_idx = board_obs_ptr->charuco_id_;
-      std::vector<cv::Point2f> board_pts_2d = board_obs_ptr->pts_2d_;
-      for (int i = 0; i < board_pts_idx.size(); i++) {
-        cv::Point3f current_pts_3d =
-            board_pts_3d[board_pts_idx[i]];           // Current 3D pts
-        cv::Point2f current_pts_2d = board_pts_2d[i]; // Current 2D pts
+  for (const int &board_obs_idx : store.getCameraBoardObs(cam_idx_)) {
+    if (store.board_obs_valid_[board_obs_idx]) {
+      double *board_pose = store.board_obs_pose_[board_obs_idx];
+      for (int i = store.board_obs_pts_begin_[board_obs_idx];
+           i < store.board_obs_pts_begin_[board_obs_idx + 1]; i++) {
+        // Current 3D pts (in the board referential) and 2D pts
+        const cv::Point3f &current_pts_3d = store.board_pts_3d_[i];
+        const cv::Point2f &current_pts_2d = store.board_pts_2d_[i];
         ceres::CostFunction *reprojection_error = ReprojectionError::Create(
             double(current_pts_2d.x), double(current_pts_2d.y),
             double(current_pts_3d.x), double(current_pts_3d.y),
@@ -276,17 +289,14 @@ void Camera::refineIntrinsicCalibration(int nb_iterations) {
         // problem.AddResidualBlock(ReprojectionError, new
         // ceres::ArctanLoss(loss), poses[i], Intrinsics);
         problem.AddResidualBlock(reprojection_error, new ceres::HuberLoss(1.0),
-                                 board_obs_ptr->pose_, intrinsics_);
+                                 board_pose, intrinsics_);
       }
     }
   }
   // Run the optimization
-  ceres::Solver::Options options;
-  options.linear_solver_type = ceres::SPARSE_SCHUR;
-  options.max_num_iterations = nb_iterations;
-  options.minimizer_progress_to_stdout = true;
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
+  solveProblem("refine_intrinsic_cam_" + std::to_string(cam_idx_),
+               nb_iterations, &problem, &summary);
   LOG_INFO << "Parameters after optimization :: " << this->getCameraMat();
   LOG_INFO << "distortion vector after optimization :: "
            << getDistortionVectorVector();
@@ -10,6 +10,9 @@
 #include "BoardObs.hpp"
 #include "Frame.hpp"
 #include "Object3DObs.hpp"
+#include "ParameterArena.hpp"
+
+class ObservationStore;
 
 /**
  * @class Camera
@@ -34,23 +37,25 @@ public:
   std::vector<int> vis_object_idx_; // vector of index of the 3D object
 
   // intrinsic
-  double *intrinsics_ =
-      new double[9]; // fx,fy,u0,v0,r1,r2,t1,t2,r3 (perspective) //
-                     // fx,fy,u0,v0,k1,k2,k3,k4 (Kannala)
+  double *intrinsics_; // fx,fy,u0,v0,r1,r2,t1,t2,r3 (perspective) //
+                       // fx,fy,u0,v0,k1,k2,k3,k4 (Kannala)
+  std::shared_ptr<ParameterArena> parameter_arena_;
   int distortion_model_;
   int im_cols_, im_rows_;
+  int nb_images_ = 0; // images processed by the detection
 
   // camera index
   int cam_idx_;
 
   // Functions
-  Camera();
-  ~Camera() { delete[] intrinsics_; };
+  Camera(std::shared_ptr<ParameterArena> parameter_arena);
+  ~Camera(){};
   void insertNewBoard(std::shared_ptr<BoardObs> newBoard);
   void insertNewFrame(std::shared_ptr<Frame> newFrame);
   void insertNewObject(std::shared_ptr<Object3DObs> new_object);
   void initializeCalibration();
-  void refineIntrinsicCalibration(int nb_iterations);
+  void refineIntrinsicCalibration(int nb_iterations,
+                                  const ObservationStore &store);
   cv::Mat getCameraMat();
   void setCameraMat(cv::Mat K);
   void setDistortionVector(cv::Mat distortion_vector);
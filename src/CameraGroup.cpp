@@ -4,12 +4,23 @@
 #include <iostream>
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/opencv.hpp>
+#include <set>
 #include <stdio.h>
 
 #include "CameraGroup.hpp"
+#include "ObservationStore.hpp"
+#include "SolverTelemetry.hpp"
 #include "logger.h"
 
-CameraGroup::CameraGroup() {}
+/**
+ * @brief Create the camera group
+ *
+ * The camera poses are allocated in the parameter arena.
+ *
+ * @param parameter_arena storage of the parameter blocks
+ */
+CameraGroup::CameraGroup(std::shared_ptr<ParameterArena> parameter_arena)
+    : parameter_arena_(parameter_arena) {}
 
 /**
  * @brief Initialize the camera group
@@ -53,11 +64,7 @@ void CameraGroup::insertNewFrame(std::shared_ptr<Frame> new_frame) {
   frames_[new_frame->frame_idx_] = new_frame;
 }
 
-CameraGroup::~CameraGroup() {
-  for (auto const &item : relative_camera_pose_)
-    delete[] item.second;
-  relative_camera_pose_.clear();
-}
+CameraGroup::~CameraGroup() {}
 
 /**
  * @brief Get camera pose (vector) of the camera "id_cam" in the group
@@ -90,11 +97,18 @@ void CameraGroup::getCameraPoseVec(cv::Mat &r_vec, cv::Mat &t_vec, int id_cam) {
  * @return pose matrix of the camera in the group
  */
 cv::Mat CameraGroup::getCameraPoseMat(int id_cam) {
-  cv::Mat r_vec;
-  cv::Mat t_vec;
-  getCameraPoseVec(r_vec, t_vec, id_cam);
-  cv::Mat pose = RVecT2Proj(r_vec, t_vec);
-  return pose;
+  return getCameraPose(id_cam).toMat();
+}
+
+/**
+ * @brief Get camera pose of the camera "id_cam" in the group
+ *
+ * @param id_cam index of the camera of interest in the group
+ *
+ * @return pose of the camera in the group
+ */
+Pose CameraGroup::getCameraPose(int id_cam) {
+  return Pose::fromBlock(relative_camera_pose_[id_cam]);
 }
 
 /**
@@ -104,15 +118,20 @@ cv::Mat CameraGroup::getCameraPoseMat(int id_cam) {
  * @param id_cam index of the camera of interest in the group
  */
 void CameraGroup::setCameraPoseMat(cv::Mat pose, int id_cam) {
-  relative_camera_pose_[id_cam] = new double[6];
-  cv::Mat r_vec, t_vec;
-  Proj2RT(pose, r_vec, t_vec);
-  relative_camera_pose_[id_cam][0] = r_vec.at<double>(0);
-  relative_camera_pose_[id_cam][1] = r_vec.at<double>(1);
-  relative_camera_pose_[id_cam][2] = r_vec.at<double>(2);
-  relative_camera_pose_[id_cam][3] = t_vec.at<double>(0);
-  relative_camera_pose_[id_cam][4] = t_vec.at<double>(1);
-  relative_camera_pose_[id_cam][5] = t_vec.at<double>(2);
+  setCameraPose(Pose::fromMat(pose), id_cam);
+}
+
+/**
+ * @brief Set "id_cam" camera pose in the data structure
+ *
+ * @param pose pose to set
+ * @param id_cam index of the camera of interest in the group
+ */
+void CameraGroup::setCameraPose(const Pose &pose, int id_cam) {
+  if (relative_camera_pose_.find(id_cam) == relative_camera_pose_.end())
+    relative_camera_pose_[id_cam] =
+        parameter_arena_->allocate(ParameterArena::RelativeCameraPose, 6);
+  pose.toBlock(relative_camera_pose_[id_cam]);
 }
 
 /**
@@ -123,7 +142,9 @@ void CameraGroup::setCameraPoseMat(cv::Mat pose, int id_cam) {
  * @param id_cam index of the camera of interest in the group
  */
 void CameraGroup::setCameraPoseVec(cv::Mat r_vec, cv::Mat t_vec, int id_cam) {
-  relative_camera_pose_[id_cam] = new double[6];
+  if (relative_camera_pose_.find(id_cam) == relative_camera_pose_.end())
+    relative_camera_pose_[id_cam] =
+        parameter_arena_->allocate(ParameterArena::RelativeCameraPose, 6);
   relative_camera_pose_[id_cam][0] = r_vec.at<double>(0);
   relative_camera_pose_[id_cam][1] = r_vec.at<double>(1);
   relative_camera_pose_[id_cam][2] = r_vec.at<double>(2);
@@ -166,7 +187,7 @@ void CameraGroup::computeObjPoseInCameraGroup() {
   for (std::map<int, std::weak_ptr<Frame>>::iterator it_frame = frames_.begin();
        it_frame != frames_.end(); ++it_frame) {
     // Iterate through cameraGroupObs
-    std::map<int, std::weak_ptr<CameraGroupObs>> current_cam_group_obs_vec =
+    std::map<int, std::weak_ptr<CameraGroupObs>> &current_cam_group_obs_vec =
         it_frame->second.lock()->cam_group_observations_;
     for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
              it_cam_group_obs = current_cam_group_obs_vec.begin();
@@ -174,7 +195,7 @@ void CameraGroup::computeObjPoseInCameraGroup() {
          ++it_cam_group_obs) {
       if (cam_group_idx_ == it_cam_group_obs->second.lock()->cam_group_idx_) {
         // iterate through 3D object obs
-        std::map<int, std::weak_ptr<Object3DObs>> current_obj3d_obs_vec =
+        std::map<int, std::weak_ptr<Object3DObs>> &current_obj3d_obs_vec =
             it_cam_group_obs->second.lock()->object_observations_;
         for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj3d =
                  current_obj3d_obs_vec.begin();
@@ -182,11 +203,11 @@ void CameraGroup::computeObjPoseInCameraGroup() {
           // Transform the 3D object in the referential of the group
           std::shared_ptr<Object3DObs> it_obj3d_ptr = it_obj3d->second.lock();
           int current_cam_id = it_obj3d_ptr->camera_id_;
-          cv::Mat pose_cam_mat = getCameraPoseMat(current_cam_id);
-          cv::Mat pose_obj_mat = it_obj3d_ptr->getPoseMat();
-          cv::Mat pose_in_ref_mat = pose_cam_mat.inv() * pose_obj_mat;
+          Pose pose_cam = getCameraPose(current_cam_id);
+          Pose pose_obj = it_obj3d_ptr->getPose();
+          Pose pose_in_ref = pose_cam.inverse() * pose_obj;
           // set in the observation
-          it_obj3d_ptr->setPoseInGroupMat(pose_in_ref_mat);
+          it_obj3d_ptr->setPoseInGroup(pose_in_ref);
         }
       }
     }
@@ -196,81 +217,62 @@ void CameraGroup::computeObjPoseInCameraGroup() {
 /**
  * @brief Refine the objects pose and camera pose in the group
  *
+ * The boards poses in the objects are kept fixed, the residuals directly use
+ * the 3D points of the objects (expressed in the object referential) which
+ * avoids the board transformation in the cost function.
+ *
  * @param nb_iterations number of iterations for non-linear refinement
+ * @param store observations of the calibration
  *
  */
-void CameraGroup::refineCameraGroup(int nb_iterations) {
+void CameraGroup::refineCameraGroup(int nb_iterations,
+                                    const ObservationStore &store) {
   ceres::Problem problem;
   LOG_INFO << "Number of frames for camera group optimization  :: "
            << frames_.size();
-  // Iterate through frames
-  for (std::map<int, std::weak_ptr<Frame>>::iterator it_frame = frames_.begin();
-       it_frame != frames_.end(); ++it_frame) {
-    // Iterate through cameraGroupObs
-    std::map<int, std::weak_ptr<CameraGroupObs>> current_cam_group_obs_vec =
-        it_frame->second.lock()->cam_group_observations_;
-    for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
-             it_cam_group_obs = current_cam_group_obs_vec.begin();
-         it_cam_group_obs != current_cam_group_obs_vec.end();
-         ++it_cam_group_obs) {
-      // Check if the current group the group we refine (be careful)
-      if (cam_group_idx_ == it_cam_group_obs->second.lock()->cam_group_idx_) {
-        // iterate through 3D object obs
-        std::map<int, std::weak_ptr<Object3DObs>> current_obj3d_obs_vec =
-            it_cam_group_obs->second.lock()->object_observations_;
-        for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj3d =
-                 current_obj3d_obs_vec.begin();
-             it_obj3d != current_obj3d_obs_vec.end(); ++it_obj3d) {
-          std::shared_ptr<Object3DObs> it_obj3d_ptr = it_obj3d->second.lock();
-          int current_cam_id = it_obj3d_ptr->camera_id_;
-          std::vector<cv::Point3f> obj_pts_3d =
-              it_obj3d_ptr->object_3d_.lock()->pts_3d_;
-          std::vector<int> obj_pts_idx = it_obj3d_ptr->pts_id_;
-          std::vector<cv::Point2f> obj_pts_2d = it_obj3d_ptr->pts_2d_;
-          std::shared_ptr<Camera> cam_ptr = it_obj3d_ptr->cam_.lock();
-          double fx = cam_ptr->intrinsics_[0];
-          double fy = cam_ptr->intrinsics_[1];
-          double u0 = cam_ptr->intrinsics_[2];
-          double v0 = cam_ptr->intrinsics_[3];
-          double r1 = cam_ptr->intrinsics_[4];
-          double r2 = cam_ptr->intrinsics_[5];
-          double t1 = cam_ptr->intrinsics_[6];
-          double t2 = cam_ptr->intrinsics_[7];
-          double r3 = cam_ptr->intrinsics_[8];
-          bool refine_cam = true;
-          // We do not refine the camera pose if it is the ref camera
-          if (this->id_ref_cam_ == cam_ptr->cam_idx_) {
-            refine_cam = false;
-          }
-          for (int i = 0; i < obj_pts_idx.size(); i++) {
-            cv::Point3f current_pts_3d =
-                obj_pts_3d[obj_pts_idx[i]];             // Current 3D pts
-            cv::Point2f current_pts_2d = obj_pts_2d[i]; // Current 2D pts
-            ceres::CostFunction *reprojection_error =
-                ReprojectionError_CameraGroupRef::Create(
-                    double(current_pts_2d.x), double(current_pts_2d.y),
-                    double(current_pts_3d.x), double(current_pts_3d.y),
-                    double(current_pts_3d.z), fx, fy, u0, v0, r1, r2, r3, t1,
-                    t2, refine_cam, cam_ptr->distortion_model_);
-            problem.AddResidualBlock(
-                reprojection_error, new ceres::HuberLoss(1.0),
-                relative_camera_pose_[current_cam_id],
-                it_cam_group_obs->second.lock()
-                    ->object_pose_[it_obj3d_ptr->object_3d_id_]);
-            // it_obj3d->second->group_pose_);
-            // it_cam_group_obs->second->object_pose_[it_obj3d->second->object_3d_id_]
-          }
-        }
-      }
+  // Iterate through the object observations of the group (sorted by frame)
+  std::pair<int, int> obs_range = store.getCameraGroupObjectObs(cam_group_idx_);
+  for (int obs_idx = obs_range.first; obs_idx < obs_range.second; obs_idx++) {
+    int current_cam_id = store.object_obs_camera_id_[obs_idx];
+    std::shared_ptr<Object3D> object_3d_ptr =
+        store.object_3d_.at(store.object_obs_object_id_[obs_idx]).lock();
+    const std::vector<cv::Point3f> &obj_pts_3d = object_3d_ptr->pts_3d_;
+    const double *intrinsics = store.camera_intrinsics_[current_cam_id];
+    double fx = intrinsics[0];
+    double fy = intrinsics[1];
+    double u0 = intrinsics[2];
+    double v0 = intrinsics[3];
+    double r1 = intrinsics[4];
+    double r2 = intrinsics[5];
+    double t1 = intrinsics[6];
+    double t2 = intrinsics[7];
+    double r3 = intrinsics[8];
+    int distortion_model = store.camera_distortion_model_[current_cam_id];
+    double *camera_pose = relative_camera_pose_[current_cam_id];
+    double *object_pose = store.object_obs_group_pose_[obs_idx];
+    for (int i = store.object_obs_pts_begin_[obs_idx];
+         i < store.object_obs_pts_begin_[obs_idx + 1]; i++) {
+      // Current 3D pts (in the object referential) and 2D pts
+      const cv::Point3f &current_pts_3d = obj_pts_3d[store.object_pts_id_[i]];
+      const cv::Point2f &current_pts_2d = store.object_pts_2d_[i];
+      ceres::CostFunction *reprojection_error =
+          ReprojectionError_CameraGroupRef::Create(
+              double(current_pts_2d.x), double(current_pts_2d.y),
+              double(current_pts_3d.x), double(current_pts_3d.y),
+              double(current_pts_3d.z), fx, fy, u0, v0, r1, r2, r3, t1, t2,
+              distortion_model);
+      problem.AddResidualBlock(reprojection_error, new ceres::HuberLoss(1.0),
+                               camera_pose, object_pose);
     }
   }
+  // The reference camera is the referential of the group
+  if (problem.HasParameterBlock(relative_camera_pose_[id_ref_cam_]))
+    problem.SetParameterBlockConstant(relative_camera_pose_[id_ref_cam_]);
+
   // Run the optimization
-  ceres::Solver::Options options;
-  options.linear_solver_type = ceres::SPARSE_SCHUR;
-  options.max_num_iterations = nb_iterations;
-  options.minimizer_progress_to_stdout = true;
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
+  solveProblem("refine_camera_group_" + std::to_string(cam_group_idx_),
+               nb_iterations, &problem, &summary);
 
   // Display poses in the group
   for (std::map<int, double *>::iterator it = relative_camera_pose_.begin();
@@ -280,72 +282,131 @@ void CameraGroup::refineCameraGroup(int nb_iterations) {
   }
 }
 
+/**
+ * @brief Refine the poses of some camera observations of the group
+ *
+ * Only the residuals of the object observations made in the given camera
+ * observations are used. As in refineCameraGroup, the boards poses in the
+ * objects and the intrinsic parameters are fixed.
+ *
+ * @param nb_iterations number of iterations for non-linear refinement
+ * @param store observations of the calibration
+ * @param cam_frame_idx camera observations (camera index, frame index) used
+ * @param constant_blocks camera and object poses kept constant
+ */
+void CameraGroup::refineCameraGroupObservations(
+    int nb_iterations, const ObservationStore &store,
+    const std::set<std::pair<int, int>> &cam_frame_idx,
+    std::set<double *> constant_blocks) {
+  ceres::Problem problem;
+  // Iterate through the object observations of the group (sorted by frame)
+  std::pair<int, int> obs_range = store.getCameraGroupObjectObs(cam_group_idx_);
+  for (int obs_idx = obs_range.first; obs_idx < obs_range.second; obs_idx++) {
+    int current_cam_id = store.object_obs_camera_id_[obs_idx];
+    if (cam_frame_idx.find(std::make_pair(
+            current_cam_id, store.object_obs_frame_id_[obs_idx])) ==
+        cam_frame_idx.end())
+      continue;
+    std::shared_ptr<Object3D> object_3d_ptr =
+        store.object_3d_.at(store.object_obs_object_id_[obs_idx]).lock();
+    const std::vector<cv::Point3f> &obj_pts_3d = object_3d_ptr->pts_3d_;
+    const double *intrinsics = store.camera_intrinsics_[current_cam_id];
+    int distortion_model = store.camera_distortion_model_[current_cam_id];
+    double *camera_pose = relative_camera_pose_[current_cam_id];
+    double *object_pose = store.object_obs_group_pose_[obs_idx];
+    for (int i = store.object_obs_pts_begin_[obs_idx];
+         i < store.object_obs_pts_begin_[obs_idx + 1]; i++) {
+      // Current 3D pts (in the object referential) and 2D pts
+      const cv::Point3f &current_pts_3d = obj_pts_3d[store.object_pts_id_[i]];
+      const cv::Point2f &current_pts_2d = store.object_pts_2d_[i];
+      ceres::CostFunction *reprojection_error =
+          ReprojectionError_CameraGroupRef::Create(
+              double(current_pts_2d.x), double(current_pts_2d.y),
+              double(current_pts_3d.x), double(current_pts_3d.y),
+              double(current_pts_3d.z), intrinsics[0], intrinsics[1],
+              intrinsics[2], intrinsics[3], intrinsics[4], intrinsics[5],
+              intrinsics[8], intrinsics[6], intrinsics[7], distortion_model);
+      problem.AddResidualBlock(reprojection_error, new ceres::HuberLoss(1.0),
+                               camera_pose, object_pose);
+    }
+  }
+  if (problem.NumResidualBlocks() == 0)
+    return;
+  LOG_INFO << "Number of residuals for camera group " << cam_group_idx_
+           << " observations optimization  :: " << problem.NumResidualBlocks();
+
+  // The reference camera is the referential of the group
+  constant_blocks.insert(relative_camera_pose_[id_ref_cam_]);
+  for (double *block : constant_blocks)
+    if (problem.HasParameterBlock(block))
+      problem.SetParameterBlockConstant(block);
+
+  // Run the optimization
+  ceres::Solver::Summary summary;
+  solveProblem("refine_camera_group_observations_" +
+                   std::to_string(cam_group_idx_),
+               nb_iterations, &problem, &summary);
+}
+
 /**
  * @brief Compute the reprojection error for this camera group
  *
+ * @param store observations of the calibration
  */
-void CameraGroup::reproErrorCameraGroup() {
+void CameraGroup::reproErrorCameraGroup(const ObservationStore &store) {
 
-  // Iterate through frames
-  for (std::map<int, std::weak_ptr<Frame>>::iterator it_frame = frames_.begin();
-       it_frame != frames_.end(); ++it_frame) {
-    // Iterate through cameraGroupObs
-    std::map<int, std::weak_ptr<CameraGroupObs>> current_cam_group_obs_vec =
-        it_frame->second.lock()->cam_group_observations_;
-    for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
-             it_cam_group_obs = current_cam_group_obs_vec.begin();
-         it_cam_group_obs != current_cam_group_obs_vec.end();
-         ++it_cam_group_obs) {
-      // Check if the current group is the camera group of interest
-      if (cam_group_idx_ == it_cam_group_obs->second.lock()->cam_group_idx_) {
-        // iterate through 3D object obs
-        std::map<int, std::weak_ptr<Object3DObs>> current_obj3d_obs_vec =
-            it_cam_group_obs->second.lock()->object_observations_;
-        for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj3d =
-                 current_obj3d_obs_vec.begin();
-             it_obj3d != current_obj3d_obs_vec.end(); ++it_obj3d) {
-          std::shared_ptr<Object3DObs> it_obj3d_ptr = it_obj3d->second.lock();
-          int current_cam_id = it_obj3d_ptr->camera_id_;
-          std::vector<cv::Point3f> obj_pts_3d =
-              it_obj3d_ptr->object_3d_.lock()->pts_3d_;
-          std::vector<int> obj_pts_idx = it_obj3d_ptr->pts_id_;
-          std::vector<cv::Point2f> obj_pts_2d = it_obj3d_ptr->pts_2d_;
-
-          // Compute the reprojection error
-          std::vector<cv::Point3f> object_pts;
-          for (int i = 0; i < obj_pts_idx.size(); i++)
-            object_pts.push_back(obj_pts_3d[obj_pts_idx[i]]);
-
-          // Apply object pose transform
-          std::vector<cv::Point3f> object_pts_trans1 =
-              transform3DPts(object_pts,
-                             it_cam_group_obs->second.lock()->getObjectRotVec(
-                                 it_obj3d_ptr->object_3d_id_),
-                             it_cam_group_obs->second.lock()->getObjectTransVec(
-                                 it_obj3d_ptr->object_3d_id_));
-          // Reproject pts
-          std::vector<cv::Point2f> repro_pts;
-          std::shared_ptr<Camera> cam_ptr = it_obj3d_ptr->cam_.lock();
-          projectPointsWithDistortion(
-              object_pts_trans1, getCameraRotVec(current_cam_id),
-              getCameraTransVec(current_cam_id), cam_ptr->getCameraMat(),
-              cam_ptr->getDistortionVectorVector(), repro_pts,
-              cam_ptr->distortion_model_);
-          float sum_error = 0;
-          // Compute error
-          for (int i = 0; i < repro_pts.size(); i++) {
-            float rep_err = sqrt(pow((obj_pts_2d[i].x - repro_pts[i].x), 2) +
-                                 pow((obj_pts_2d[i].y - repro_pts[i].y), 2));
-            sum_error += rep_err;
-          }
-          float mean_error = sum_error / repro_pts.size();
-          LOG_DEBUG << "cam_id :: " << current_cam_id
-                    << "   object_id :: " << it_obj3d_ptr->object_3d_id_
-                    << "  mean error :: " << mean_error
-                    << "  nb pts :: " << repro_pts.size();
-        }
-      }
+  // The intrinsics are converted once per camera and the points are
+  // transformed in the camera referential before the projection, the buffers
+  // are reused for all the observations
+  std::map<int, cv::Mat> camera_matrix, distortion_vector;
+  for (std::map<int, std::weak_ptr<Camera>>::iterator it = cameras_.begin();
+       it != cameras_.end(); ++it) {
+    camera_matrix[it->first] = it->second.lock()->getCameraMat();
+    distortion_vector[it->first] =
+        it->second.lock()->getDistortionVectorVector();
+  }
+  cv::Mat null_r_vec = cv::Mat::zeros(3, 1, CV_64F);
+  cv::Mat null_t_vec = cv::Mat::zeros(3, 1, CV_64F);
+  std::vector<cv::Point3f> object_pts;
+  std::vector<cv::Point2f> repro_pts;
+
+  // Iterate through the object observations of the group (sorted by frame)
+  std::pair<int, int> obs_range = store.getCameraGroupObjectObs(cam_group_idx_);
+  for (int obs_idx = obs_range.first; obs_idx < obs_range.second; obs_idx++) {
+    int current_cam_id = store.object_obs_camera_id_[obs_idx];
+    int current_obj_id = store.object_obs_object_id_[obs_idx];
+    const std::vector<cv::Point3f> &obj_pts_3d =
+        store.object_3d_.at(current_obj_id).lock()->pts_3d_;
+    int pts_begin = store.object_obs_pts_begin_[obs_idx];
+    int pts_end = store.object_obs_pts_begin_[obs_idx + 1];
+
+    // Apply object and camera pose transform
+    Pose object_pose_in_cam =
+        getCameraPose(current_cam_id) *
+        Pose::fromBlock(store.object_obs_group_pose_[obs_idx]);
+    object_pts.clear();
+    for (int i = pts_begin; i < pts_end; i++)
+      object_pts.push_back(object_pose_in_cam *
+                           obj_pts_3d[store.object_pts_id_[i]]);
+
+    // Reproject pts
+    projectPointsWithDistortion(
+        object_pts, null_r_vec, null_t_vec, camera_matrix[current_cam_id],
+        distortion_vector[current_cam_id], repro_pts,
+        store.camera_distortion_model_[current_cam_id]);
+    float sum_error = 0;
+    // Compute error
+    for (int i = 0; i < repro_pts.size(); i++) {
+      const cv::Point2f &pts_2d = store.object_pts_2d_[pts_begin + i];
+      float rep_err = sqrt(pow((pts_2d.x - repro_pts[i].x), 2) +
+                           pow((pts_2d.y - repro_pts[i].y), 2));
+      sum_error += rep_err;
     }
+    float mean_error = sum_error / repro_pts.size();
+    LOG_DEBUG << "cam_id :: " << current_cam_id
+              << "   object_id :: " << current_obj_id
+              << "  mean error :: " << mean_error
+              << "  nb pts :: " << repro_pts.size();
   }
 }
 
@@ -353,98 +414,68 @@ void CameraGroup::reproErrorCameraGroup() {
  * @brief Refine the objects pose, camera pose in the group and board poses
  *
  * @param nb_iterations number of iterations for non-linear refinement
+ * @param store observations of the calibration
  *
  */
-void CameraGroup::refineCameraGroupAndObjects(int nb_iterations) {
+void CameraGroup::refineCameraGroupAndObjects(int nb_iterations,
+                                              const ObservationStore &store) {
   ceres::Problem problem;
+  std::set<double *> constant_blocks; // blocks not refined
   LOG_INFO << "Number of frames for camera group optimization  :: "
            << frames_.size();
-  // Iterate through frames
-  for (std::map<int, std::weak_ptr<Frame>>::iterator it_frame = frames_.begin();
-       it_frame != frames_.end(); ++it_frame) {
-    // Iterate through cameraGroupObs
-    std::map<int, std::weak_ptr<CameraGroupObs>> current_cam_group_obs_vec =
-        it_frame->second.lock()->cam_group_observations_;
-    for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
-             it_cam_group_obs = current_cam_group_obs_vec.begin();
-         it_cam_group_obs != current_cam_group_obs_vec.end();
-         ++it_cam_group_obs) {
-      // Check if the current group the group we refine (be careful)
-      if (cam_group_idx_ == it_cam_group_obs->second.lock()->cam_group_idx_) {
-        // iterate through 3D object obs
-        std::map<int, std::weak_ptr<Object3DObs>> current_obj3d_obs_vec =
-            it_cam_group_obs->second.lock()->object_observations_;
-        for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj3d =
-                 current_obj3d_obs_vec.begin();
-             it_obj3d != current_obj3d_obs_vec.end(); ++it_obj3d) {
-          std::shared_ptr<Object3DObs> it_obj3d_ptr = it_obj3d->second.lock();
-          int current_cam_id = it_obj3d_ptr->camera_id_;
-          std::shared_ptr<Object3D> object_3d_ptr =
-              it_obj3d_ptr->object_3d_.lock();
-          std::vector<cv::Point3f> obj_pts_3d = object_3d_ptr->pts_3d_;
-          std::vector<int> obj_pts_idx = it_obj3d_ptr->pts_id_;
-          std::vector<cv::Point2f> obj_pts_2d = it_obj3d_ptr->pts_2d_;
-          std::shared_ptr<Camera> cam_ptr = it_obj3d_ptr->cam_.lock();
-          double fx = cam_ptr->intrinsics_[0];
-          double fy = cam_ptr->intrinsics_[1];
-          double u0 = cam_ptr->intrinsics_[2];
-          double v0 = cam_ptr->intrinsics_[3];
-          double r1 = cam_ptr->intrinsics_[4];
-          double r2 = cam_ptr->intrinsics_[5];
-          double t1 = cam_ptr->intrinsics_[6];
-          double t2 = cam_ptr->intrinsics_[7];
-          double r3 = cam_ptr->intrinsics_[8];
-          bool refine_cam = true;
-          // We do not refine the camera pose if it is the ref camera
-          if (this->id_ref_cam_ == cam_ptr->cam_idx_) {
-            refine_cam = false;
-          }
-          for (int i = 0; i < obj_pts_idx.size(); i++) {
-            cv::Point3f current_pts_3d =
-                obj_pts_3d[obj_pts_idx[i]];             // Current 3D pts
-            cv::Point2f current_pts_2d = obj_pts_2d[i]; // Current 2D pts
-
-            // find the board and pts corresponding to the 3D point object
-            std::pair<int, int> board_id_pts_id =
-                object_3d_ptr->pts_obj_2_board_[obj_pts_idx[i]];
-            cv::Point3f current_pts3D_board =
-                object_3d_ptr->boards_[board_id_pts_id.first]
-                    .lock()
-                    ->pts_3d_[board_id_pts_id.second];
-            int ref_board_id = object_3d_ptr->ref_board_id_;
-            bool refine_board = true;
-            if (ref_board_id == board_id_pts_id.first) {
-              refine_board = false;
-            }
-
-            // key(boardid//ptsid)-->pts_ind_board
-            ceres::CostFunction *reprojection_error =
-                ReprojectionError_CameraGroupAndObjectRef::Create(
-                    double(current_pts_2d.x), double(current_pts_2d.y),
-                    double(current_pts3D_board.x),
-                    double(current_pts3D_board.y),
-                    double(current_pts3D_board.z), fx, fy, u0, v0, r1, r2, r3,
-                    t1, t2, refine_cam, refine_board,
-                    cam_ptr->distortion_model_);
-            problem.AddResidualBlock(
-                reprojection_error, new ceres::HuberLoss(1.0), // nullptr,
-                relative_camera_pose_[current_cam_id],
-                it_cam_group_obs->second.lock()
-                    ->object_pose_[it_obj3d_ptr->object_3d_id_],
-                it_obj3d_ptr->object_3d_.lock()
-                    ->relative_board_pose_[board_id_pts_id.first]);
-          }
-        }
-      }
+  // Iterate through the object observations of the group (sorted by frame)
+  std::pair<int, int> obs_range = store.getCameraGroupObjectObs(cam_group_idx_);
+  for (int obs_idx = obs_range.first; obs_idx < obs_range.second; obs_idx++) {
+    int current_cam_id = store.object_obs_camera_id_[obs_idx];
+    std::shared_ptr<Object3D> object_3d_ptr =
+        store.object_3d_.at(store.object_obs_object_id_[obs_idx]).lock();
+    const std::vector<cv::Point3f> &pts_3d_board = object_3d_ptr->pts_3d_board_;
+    const std::vector<double *> &pts_board_pose =
+        object_3d_ptr->pts_board_pose_;
+    const double *intrinsics = store.camera_intrinsics_[current_cam_id];
+    double fx = intrinsics[0];
+    double fy = intrinsics[1];
+    double u0 = intrinsics[2];
+    double v0 = intrinsics[3];
+    double r1 = intrinsics[4];
+    double r2 = intrinsics[5];
+    double t1 = intrinsics[6];
+    double t2 = intrinsics[7];
+    double r3 = intrinsics[8];
+    int distortion_model = store.camera_distortion_model_[current_cam_id];
+    double *camera_pose = relative_camera_pose_[current_cam_id];
+    double *object_pose = store.object_obs_group_pose_[obs_idx];
+    // The reference board is the referential of the object
+    constant_blocks.insert(
+        object_3d_ptr->relative_board_pose_[object_3d_ptr->ref_board_id_]);
+    for (int i = store.object_obs_pts_begin_[obs_idx];
+         i < store.object_obs_pts_begin_[obs_idx + 1]; i++) {
+      // Current 3D pts (in its board referential) and 2D pts
+      int pts_idx = store.object_pts_id_[i];
+      const cv::Point3f &current_pts3D_board = pts_3d_board[pts_idx];
+      const cv::Point2f &current_pts_2d = store.object_pts_2d_[i];
+      ceres::CostFunction *reprojection_error =
+          ReprojectionError_CameraGroupAndObjectRef::Create(
+              double(current_pts_2d.x), double(current_pts_2d.y),
+              double(current_pts3D_board.x), double(current_pts3D_board.y),
+              double(current_pts3D_board.z), fx, fy, u0, v0, r1, r2, r3, t1,
+              t2, distortion_model);
+      problem.AddResidualBlock(reprojection_error,
+                               new ceres::HuberLoss(1.0), // nullptr,
+                               camera_pose, object_pose,
+                               pts_board_pose[pts_idx]);
     }
   }
+  // The reference camera is the referential of the group
+  constant_blocks.insert(relative_camera_pose_[id_ref_cam_]);
+  for (double *block : constant_blocks)
+    if (problem.HasParameterBlock(block))
+      problem.SetParameterBlockConstant(block);
+
   // Run the optimization
-  ceres::Solver::Options options;
-  options.linear_solver_type = ceres::SPARSE_SCHUR;
-  options.max_num_iterations = nb_iterations;
-  options.minimizer_progress_to_stdout = true;
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
+  solveProblem("refine_camera_group_objects_" + std::to_string(cam_group_idx_),
+               nb_iterations, &problem, &summary);
 
   // Display poses in the group
   for (std::map<int, double *>::iterator it = relative_camera_pose_.begin();
@@ -454,95 +485,143 @@ void CameraGroup::refineCameraGroupAndObjects(int nb_iterations) {
   }
 }
 
+/**
+ * @brief Add to a problem the residuals refining the objects pose, camera pose
+ * in the group, board poses and cameras intrinsic parameters
+ *
+ * The poses of the reference camera and of the reference boards are not
+ * refined, they are inserted in "constant_blocks". The intrinsic parameters
+ * blocks used in the problem are inserted in "intrinsic_blocks".
+ *
+ * @param problem problem where the residuals are added
+ * @param store observations of the calibration
+ * @param constant_blocks return the blocks to keep constant
+ * @param intrinsic_blocks return the intrinsic parameters blocks
+ */
+void CameraGroup::addGroupAndObjectsResiduals(
+    ceres::Problem &problem, const ObservationStore &store,
+    std::set<double *> &constant_blocks, std::set<double *> &intrinsic_blocks) {
+  LOG_INFO << "Number of frames for camera group optimization  :: "
+           << frames_.size();
+  // Iterate through the object observations of the group (sorted by frame)
+  std::pair<int, int> obs_range = store.getCameraGroupObjectObs(cam_group_idx_);
+  for (int obs_idx = obs_range.first; obs_idx < obs_range.second; obs_idx++) {
+    int current_cam_id = store.object_obs_camera_id_[obs_idx];
+    std::shared_ptr<Object3D> object_3d_ptr =
+        store.object_3d_.at(store.object_obs_object_id_[obs_idx]).lock();
+    const std::vector<cv::Point3f> &pts_3d_board = object_3d_ptr->pts_3d_board_;
+    const std::vector<double *> &pts_board_pose =
+        object_3d_ptr->pts_board_pose_;
+    double *intrinsics = store.camera_intrinsics_[current_cam_id];
+    int distortion_model = store.camera_distortion_model_[current_cam_id];
+    double *camera_pose = relative_camera_pose_[current_cam_id];
+    double *object_pose = store.object_obs_group_pose_[obs_idx];
+    // The reference board is the referential of the object
+    constant_blocks.insert(
+        object_3d_ptr->relative_board_pose_[object_3d_ptr->ref_board_id_]);
+    intrinsic_blocks.insert(intrinsics);
+    for (int i = store.object_obs_pts_begin_[obs_idx];
+         i < store.object_obs_pts_begin_[obs_idx + 1]; i++) {
+      // Current 3D pts (in its board referential) and 2D pts
+      int pts_idx = store.object_pts_id_[i];
+      const cv::Point3f &current_pts3D_board = pts_3d_board[pts_idx];
+      const cv::Point2f &current_pts_2d = store.object_pts_2d_[i];
+      ceres::CostFunction *reprojection_error =
+          ReprojectionError_CameraGroupAndObjectRefAndIntrinsics::Create(
+              double(current_pts_2d.x), double(current_pts_2d.y),
+              double(current_pts3D_board.x), double(current_pts3D_board.y),
+              double(current_pts3D_board.z), distortion_model);
+      problem.AddResidualBlock(reprojection_error,
+                               new ceres::HuberLoss(1.0), // nullptr,
+                               camera_pose, object_pose,
+                               pts_board_pose[pts_idx], intrinsics);
+    }
+  }
+  // The reference camera is the referential of the group
+  constant_blocks.insert(relative_camera_pose_[id_ref_cam_]);
+}
+
 /**
  * @brief Refine the objects pose, camera pose in the group and board poses
  * and cameras intrinsic parameters
  *
  * @param nb_iterations number of iterations for non-linear refinement
+ * @param fix_intrinsic if true the intrinsic parameters are kept constant
+ * @param store observations of the calibration
  *
  */
-void CameraGroup::refineCameraGroupAndObjectsAndIntrinsics(int nb_iterations) {
+void CameraGroup::refineCameraGroupAndObjectsAndIntrinsics(
+    int nb_iterations, bool fix_intrinsic, const ObservationStore &store) {
   ceres::Problem problem;
-  LOG_INFO << "Number of frames for camera group optimization  :: "
-           << frames_.size();
-  // Iterate through frames
-  for (std::map<int, std::weak_ptr<Frame>>::iterator it_frame = frames_.begin();
-       it_frame != frames_.end(); ++it_frame) {
-    // Iterate through cameraGroupObs
-    std::map<int, std::weak_ptr<CameraGroupObs>> current_cam_group_obs_vec =
-        it_frame->second.lock()->cam_group_observations_;
-    for (std::map<int, std::weak_ptr<CameraGroupObs>>::iterator
-             it_cam_group_obs = current_cam_group_obs_vec.begin();
-         it_cam_group_obs != current_cam_group_obs_vec.end();
-         ++it_cam_group_obs) {
-      // Check if the current group the group we refine (be careful)
-      if (cam_group_idx_ == it_cam_group_obs->second.lock()->cam_group_idx_) {
-        // iterate through 3D object obs
-        std::map<int, std::weak_ptr<Object3DObs>> current_obj3d_obs_vec =
-            it_cam_group_obs->second.lock()->object_observations_;
-        for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj3d =
-                 current_obj3d_obs_vec.begin();
-             it_obj3d != current_obj3d_obs_vec.end(); ++it_obj3d) {
-          std::shared_ptr<Object3DObs> it_obj3d_ptr = it_obj3d->second.lock();
-          int current_cam_id = it_obj3d_ptr->camera_id_;
-          std::shared_ptr<Object3D> object_3d_ptr =
-              it_obj3d_ptr->object_3d_.lock();
-          std::vector<cv::Point3f> obj_pts_3d = object_3d_ptr->pts_3d_;
-          std::vector<int> obj_pts_idx = it_obj3d_ptr->pts_id_;
-          std::vector<cv::Point2f> obj_pts_2d = it_obj3d_ptr->pts_2d_;
-          std::shared_ptr<Camera> cam_ptr = it_obj3d_ptr->cam_.lock();
-          bool refine_cam = true;
-          // We do not refine the camera pose if it is the ref camera
-          if (this->id_ref_cam_ == cam_ptr->cam_idx_) {
-            refine_cam = false;
-          }
-          for (int i = 0; i < obj_pts_idx.size(); i++) {
-            cv::Point3f current_pts_3d =
-                obj_pts_3d[obj_pts_idx[i]];             // Current 3D pts
-            cv::Point2f current_pts_2d = obj_pts_2d[i]; // Current 2D pts
-
-            // find the board and pts corresponding to the 3D point object
-            std::pair<int, int> board_id_pts_id =
-                object_3d_ptr->pts_obj_2_board_[obj_pts_idx[i]];
-            cv::Point3f current_pts3D_board =
-                object_3d_ptr->boards_[board_id_pts_id.first]
-                    .lock()
-                    ->pts_3d_[board_id_pts_id.second];
-            int ref_board_id = object_3d_ptr->ref_board_id_;
-            bool refine_board = true;
-            if (ref_board_id == board_id_pts_id.first) {
-              refine_board = false;
-            }
-
-            // key(boardid//ptsid)-->pts_ind_board
-            ceres::CostFunction *reprojection_error =
-                ReprojectionError_CameraGroupAndObjectRefAndIntrinsics::Create(
-                    double(current_pts_2d.x), double(current_pts_2d.y),
-                    double(current_pts3D_board.x),
-                    double(current_pts3D_board.y),
-                    double(current_pts3D_board.z), refine_cam, refine_board,
-                    it_obj3d->second.lock()->cam_.lock()->distortion_model_);
-            problem.AddResidualBlock(
-                reprojection_error, new ceres::HuberLoss(1.0), // nullptr,
-                relative_camera_pose_[current_cam_id],
-                it_cam_group_obs->second.lock()
-                    ->object_pose_[it_obj3d->second.lock()->object_3d_id_],
-                it_obj3d->second.lock()
-                    ->object_3d_.lock()
-                    ->relative_board_pose_[board_id_pts_id.first],
-                it_obj3d->second.lock()->cam_.lock()->intrinsics_);
-          }
-        }
-      }
-    }
+  std::set<double *> constant_blocks;  // blocks not refined
+  std::set<double *> intrinsic_blocks; // intrinsics of the cameras
+  addGroupAndObjectsResiduals(problem, store, constant_blocks,
+                              intrinsic_blocks);
+  if (fix_intrinsic)
+    constant_blocks.insert(intrinsic_blocks.begin(), intrinsic_blocks.end());
+  for (double *block : constant_blocks)
+    if (problem.HasParameterBlock(block))
+      problem.SetParameterBlockConstant(block);
+
+  // Run the optimization
+  ceres::Solver::Summary summary;
+  solveProblem("refine_camera_group_objects_intrinsics_" +
+                   std::to_string(cam_group_idx_),
+               nb_iterations, &problem, &summary);
+
+  // Display poses in the group
+  for (std::map<int, double *>::iterator it = relative_camera_pose_.begin();
+       it != relative_camera_pose_.end(); ++it) {
+    LOG_INFO << "Camera  " << it->first
+             << "  :: " << getCameraPoseMat(it->first);
   }
+}
+
+/**
+ * @brief Build the problem of the final refinement
+ *
+ * The residual structure (objects pose, camera pose in the group, board poses
+ * and cameras intrinsic parameters) is built once and kept in the camera group
+ * so successive final refinements only need to solve it. The parameters blocks
+ * are the ones of the datastructure: each solve starts from the previous
+ * solution.
+ *
+ * @param store observations of the calibration
+ */
+void CameraGroup::buildFinalProblem(const ObservationStore &store) {
+  final_problem_ = std::make_shared<ceres::Problem>();
+  final_intrinsic_blocks_.clear();
+  std::set<double *> constant_blocks; // blocks not refined
+  addGroupAndObjectsResiduals(*final_problem_, store, constant_blocks,
+                              final_intrinsic_blocks_);
+  for (double *block : constant_blocks)
+    if (final_problem_->HasParameterBlock(block))
+      final_problem_->SetParameterBlockConstant(block);
+}
+
+/**
+ * @brief Solve the problem of the final refinement
+ *
+ * The problem must have been built with buildFinalProblem.
+ *
+ * @param nb_iterations number of iterations for non-linear refinement
+ * @param refine_intrinsics if false the intrinsic parameters are kept constant
+ */
+void CameraGroup::solveFinalProblem(int nb_iterations, bool refine_intrinsics) {
+  // Toggle the intrinsic parameters
+  for (double *block : final_intrinsic_blocks_) {
+    if (!final_problem_->HasParameterBlock(block))
+      continue;
+    if (refine_intrinsics)
+      final_problem_->SetParameterBlockVariable(block);
+    else
+      final_problem_->SetParameterBlockConstant(block);
+  }
+
   // Run the optimization
-  ceres::Solver::Options options;
-  options.linear_solver_type = ceres::SPARSE_SCHUR;
-  options.max_num_iterations = nb_iterations;
-  options.minimizer_progress_to_stdout = true;
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
+  solveProblem("final_refinement_" + std::to_string(cam_group_idx_),
+               nb_iterations, final_problem_.get(), &summary);
 
   // Display poses in the group
   for (std::map<int, double *>::iterator it = relative_camera_pose_.begin();
@@ -551,3 +630,12 @@ void CameraGroup::refineCameraGroupAndObjectsAndIntrinsics(int nb_iterations) {
              << "  :: " << getCameraPoseMat(it->first);
   }
 }
+
+/**
+ * @brief Release the problem of the final refinement
+ *
+ */
+void CameraGroup::releaseFinalProblem() {
+  final_problem_.reset();
+  final_intrinsic_blocks_.clear();
+}
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/opencv.hpp>
+#include <set>
 #include <stdio.h>
 
 #include "Board.hpp"
@@ -11,6 +12,13 @@
 #include "Camera.hpp"
 #include "Frame.hpp"
 #include "Object3DObs.hpp"
+#include "ParameterArena.hpp"
+#include "Pose.hpp"
+
+namespace ceres {
+class Problem;
+}
+class ObservationStore;
 
 /**
  * @class CameraGroup
@@ -37,14 +45,19 @@ public:
   // extrinsic
   std::map<int, double *>
       relative_camera_pose_; // camera pose wrt. the ref. cam
+  std::shared_ptr<ParameterArena> parameter_arena_; // storage of the poses
   int id_ref_cam_;
   std::vector<int> cam_idx; // index of the cameras in the group
 
   // camera group index
   int cam_group_idx_;
 
+  // problem of the final refinement (kept between successive refinements)
+  std::shared_ptr<ceres::Problem> final_problem_;
+  std::set<double *> final_intrinsic_blocks_; // intrinsics in the problem
+
   // Functions
-  CameraGroup();
+  CameraGroup(std::shared_ptr<ParameterArena> parameter_arena);
   ~CameraGroup();
   void initializeCameraGroup(int id_ref_cam, int cam_group_idx);
   void insertCamera(std::shared_ptr<Camera> new_camera);
@@ -53,13 +66,29 @@ public:
   void insertNewFrame(std::shared_ptr<Frame> new_frame);
   void getCameraPoseVec(cv::Mat &r_vec, cv::Mat &t_vec, int id_cam);
   cv::Mat getCameraPoseMat(int id_cam);
+  Pose getCameraPose(int id_cam);
   void setCameraPoseMat(cv::Mat pose, int id_cam);
+  void setCameraPose(const Pose &pose, int id_cam);
   void setCameraPoseVec(cv::Mat r_vec, cv::Mat t_vec, int id_cam);
   cv::Mat getCameraRotVec(int id_cam);
   cv::Mat getCameraTransVec(int id_cam);
   void computeObjPoseInCameraGroup();
-  void refineCameraGroup(int nb_iterations);
-  void reproErrorCameraGroup();
-  void refineCameraGroupAndObjects(int nb_iterations);
-  void refineCameraGroupAndObjectsAndIntrinsics(int nb_iterations);
+  void refineCameraGroup(int nb_iterations, const ObservationStore &store);
+  void refineCameraGroupObservations(
+      int nb_iterations, const ObservationStore &store,
+      const std::set<std::pair<int, int>> &cam_frame_idx,
+      std::set<double *> constant_blocks);
+  void reproErrorCameraGroup(const ObservationStore &store);
+  void refineCameraGroupAndObjects(int nb_iterations,
+                                   const ObservationStore &store);
+  void addGroupAndObjectsResiduals(ceres::Problem &problem,
+                                   const ObservationStore &store,
+                                   std::set<double *> &constant_blocks,
+                                   std::set<double *> &intrinsic_blocks);
+  void refineCameraGroupAndObjectsAndIntrinsics(int nb_iterations,
+                                                bool fix_intrinsic,
+                                                const ObservationStore &store);
+  void buildFinalProblem(const ObservationStore &store);
+  void solveFinalProblem(int nb_iterations, bool refine_intrinsics);
+  void releaseFinalProblem();
 };
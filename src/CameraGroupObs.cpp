@@ -8,7 +8,16 @@
 
 #include "CameraGroupObs.hpp"
 
-CameraGroupObs::CameraGroupObs() {}
+/**
+ * @brief Create the camera group observation
+ *
+ * The object poses are allocated in the parameter arena.
+ *
+ * @param parameter_arena storage of the parameter blocks
+ */
+CameraGroupObs::CameraGroupObs(
+    std::shared_ptr<ParameterArena> parameter_arena)
+    : parameter_arena_(parameter_arena) {}
 
 /**
  * @brief Associate this observation with its respective camera group
@@ -32,11 +41,7 @@ void CameraGroupObs::insertObjectObservation(
   object_observations_[object_observations_.size()] = new_object_observation;
 }
 
-CameraGroupObs::~CameraGroupObs() {
-  for (auto const &item : object_pose_)
-    delete[] item.second;
-  object_pose_.clear();
-}
+CameraGroupObs::~CameraGroupObs() {}
 
 /**
  * @brief Compute pose of object in the camera obs
@@ -156,11 +161,37 @@ void CameraGroupObs::getObjectPoseVec(cv::Mat &r_vec, cv::Mat &t_vec,
  * @return Pose matrix of the object in the group
  */
 cv::Mat CameraGroupObs::getObjectPoseMat(int object_id) {
-  cv::Mat r_vec;
-  cv::Mat t_vec;
-  getObjectPoseVec(r_vec, t_vec, object_id);
-  cv::Mat pose = RVecT2Proj(r_vec, t_vec);
-  return pose;
+  return getObjectPose(object_id).toMat();
+}
+
+/**
+ * @brief Get the "object_id" object pose
+ *
+ * @param object_id object index of interest in the group
+ *
+ * @return pose of the object in the group
+ */
+Pose CameraGroupObs::getObjectPose(int object_id) {
+  return Pose::fromBlock(object_pose_[object_id]);
+}
+
+/**
+ * @brief Get the parameter block of the "object_id" object pose
+ *
+ * The block is allocated in the parameter arena the first time it is requested.
+ *
+ * @param object_id object index of interest in the group
+ *
+ * @return pose block (Rodrigues rotation vector and translation vector)
+ */
+double *CameraGroupObs::getObjectPoseBlock(int object_id) {
+  std::map<int, double *>::iterator it = object_pose_.find(object_id);
+  if (it != object_pose_.end())
+    return it->second;
+  double *pose_block =
+      parameter_arena_->allocate(ParameterArena::GroupObjectPose, 6);
+  object_pose_[object_id] = pose_block;
+  return pose_block;
 }
 
 /**
@@ -170,15 +201,17 @@ cv::Mat CameraGroupObs::getObjectPoseMat(int object_id) {
  * @param object_id object index of interest in the group
  */
 void CameraGroupObs::setObjectPoseMat(cv::Mat pose, int object_id) {
-  object_pose_[object_id] = new double[6];
-  cv::Mat r_vec, t_vec;
-  Proj2RT(pose, r_vec, t_vec);
-  object_pose_[object_id][0] = r_vec.at<double>(0);
-  object_pose_[object_id][1] = r_vec.at<double>(1);
-  object_pose_[object_id][2] = r_vec.at<double>(2);
-  object_pose_[object_id][3] = t_vec.at<double>(0);
-  object_pose_[object_id][4] = t_vec.at<double>(1);
-  object_pose_[object_id][5] = t_vec.at<double>(2);
+  setObjectPose(Pose::fromMat(pose), object_id);
+}
+
+/**
+ * @brief Set "object_id" object pose in the data structure
+ *
+ * @param pose pose to set
+ * @param object_id object index of interest in the group
+ */
+void CameraGroupObs::setObjectPose(const Pose &pose, int object_id) {
+  pose.toBlock(getObjectPoseBlock(object_id));
 }
 
 /**
@@ -190,13 +223,13 @@ void CameraGroupObs::setObjectPoseMat(cv::Mat pose, int object_id) {
  */
 void CameraGroupObs::setObjectPoseVec(cv::Mat r_vec, cv::Mat t_vec,
                                       int object_id) {
-  object_pose_[object_id] = new double[6];
-  object_pose_[object_id][0] = r_vec.at<double>(0);
-  object_pose_[object_id][1] = r_vec.at<double>(1);
-  object_pose_[object_id][2] = r_vec.at<double>(2);
-  object_pose_[object_id][3] = t_vec.at<double>(0);
-  object_pose_[object_id][4] = t_vec.at<double>(1);
-  object_pose_[object_id][5] = t_vec.at<double>(2);
+  double *pose_block = getObjectPoseBlock(object_id);
+  pose_block[0] = r_vec.at<double>(0);
+  pose_block[1] = r_vec.at<double>(1);
+  pose_block[2] = r_vec.at<double>(2);
+  pose_block[3] = t_vec.at<double>(0);
+  pose_block[4] = t_vec.at<double>(1);
+  pose_block[5] = t_vec.at<double>(2);
 }
 
 /**
@@ -233,8 +266,7 @@ cv::Mat CameraGroupObs::getObjectTransVec(int object_id) {
  */
 void CameraGroupObs::updateObjObsPose() {
   for (int i = 0; i < object_idx_.size(); i++) {
-    object_observations_[i].lock()->setPoseInGroupVec(
-        getObjectRotVec(object_observations_[i].lock()->object_3d_id_),
-        getObjectTransVec(object_observations_[i].lock()->object_3d_id_));
+    object_observations_[i].lock()->setPoseInGroup(
+        getObjectPose(object_observations_[i].lock()->object_3d_id_));
   }
 }
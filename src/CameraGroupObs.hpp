@@ -2,6 +2,8 @@
 
 #include "BoardObs.hpp"
 #include "Object3DObs.hpp"
+#include "ParameterArena.hpp"
+#include "Pose.hpp"
 #include "opencv2/core/core.hpp"
 #include <iostream>
 #include <opencv2/aruco/charuco.hpp>
@@ -26,13 +28,14 @@ public:
       object_observations_; // Objects stored
   std::map<int, double *>
       object_pose_; // object pose wrt. the ref. cam of the group
+  std::shared_ptr<ParameterArena> parameter_arena_; // storage of the poses
 
   // Camera group
   int cam_group_idx_;
   std::weak_ptr<CameraGroup> cam_group_;
 
   // Functions
-  CameraGroupObs();
+  CameraGroupObs(std::shared_ptr<ParameterArena> parameter_arena);
   ~CameraGroupObs();
   void insertCameraGroup(std::shared_ptr<CameraGroup> new_cam_group);
   void
@@ -40,7 +43,10 @@ public:
   void computeObjectsPose();
   void getObjectPoseVec(cv::Mat &r_vec, cv::Mat &t_vec, int object_id);
   cv::Mat getObjectPoseMat(int object_id);
+  Pose getObjectPose(int object_id);
+  double *getObjectPoseBlock(int object_id);
   void setObjectPoseMat(cv::Mat pose, int object_id);
+  void setObjectPose(const Pose &pose, int object_id);
   void setObjectPoseVec(cv::Mat r_vec, cv::Mat t_vec, int object_id);
   cv::Mat getObjectRotVec(int object_id);
   cv::Mat getObjectTransVec(int object_id);
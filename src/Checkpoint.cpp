@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "Checkpoint.hpp"
+#include "logger.h"
+
+// Header of the checkpoint files
+static const char checkpoint_magic[8] = {'M', 'C', 'C', 'K', 'P', 'T', 0, 0};
+static const uint32_t checkpoint_version = 2;
+
+/**
+ * @brief Create the temporary file of a checkpoint and write its header
+ *
+ * @param file_path path of the checkpoint
+ * @param stage name of the stage after which the snapshot is taken
+ */
+CheckpointWriter::CheckpointWriter(std::string file_path, std::string stage)
+    : file_path_(file_path), tmp_path_(file_path + ".tmp") {
+  file_.open(tmp_path_,
+             std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+  if (!file_.is_open()) {
+    LOG_ERROR << "Cannot create the checkpoint " << tmp_path_;
+    return;
+  }
+  file_.write(checkpoint_magic, sizeof(checkpoint_magic));
+  write(checkpoint_version);
+  writeString(stage);
+}
+
+/**
+ * @brief Check if the checkpoint file could be created
+ *
+ * @return true if the file is open
+ */
+bool CheckpointWriter::isOpen() const { return file_.is_open(); }
+
+/**
+ * @brief Write a parameter block
+ *
+ * @param block first value of the block
+ * @param size number of doubles in the block
+ */
+void CheckpointWriter::writeBlock(const double *block, int size) {
+  file_.write(reinterpret_cast<const char *>(block), size * sizeof(double));
+}
+
+/**
+ * @brief Write a string preceded by its size
+ *
+ * @param value string to write
+ */
+void CheckpointWriter::writeString(const std::string &value) {
+  write<uint64_t>(value.size());
+  file_.write(value.data(), value.size());
+}
+
+/**
+ * @brief Flush the temporary file and move it over the checkpoint
+ *
+ * @return true if all the values were written and the checkpoint replaced
+ */
+bool CheckpointWriter::close() {
+  if (!file_.is_open())
+    return false;
+  file_.close();
+  if (file_.fail()) {
+    std::remove(tmp_path_.c_str());
+    return false;
+  }
+  return std::rename(tmp_path_.c_str(), file_path_.c_str()) == 0;
+}
+
+/**
+ * @brief Remove the temporary file of a checkpoint which was not closed
+ *
+ */
+CheckpointWriter::~CheckpointWriter() {
+  if (!file_.is_open())
+    return;
+  file_.close();
+  std::remove(tmp_path_.c_str());
+}
+
+/**
+ * @brief Open a checkpoint file and read its header
+ *
+ * @param file_path path of the checkpoint
+ */
+CheckpointReader::CheckpointReader(std::string file_path) {
+  file_.open(file_path,
+             std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+  if (!file_.is_open()) {
+    LOG_ERROR << "Cannot open the checkpoint " << file_path;
+    return;
+  }
+  remaining_ = static_cast<uint64_t>(file_.tellg());
+  file_.seekg(0);
+  valid_ = true;
+
+  char magic[sizeof(checkpoint_magic)];
+  if (!readBytes(magic, sizeof(magic)) ||
+      std::memcmp(magic, checkpoint_magic, sizeof(magic)) != 0) {
+    LOG_ERROR << file_path << " is not a checkpoint";
+    valid_ = false;
+    return;
+  }
+  uint32_t version = read<uint32_t>();
+  if (version != checkpoint_version) {
+    LOG_ERROR << "Checkpoint version " << version << " of " << file_path
+              << " is not supported (expected " << checkpoint_version << ")";
+    valid_ = false;
+    return;
+  }
+  stage_ = readString();
+}
+
+/**
+ * @brief Check if the header and all the values read so far are correct
+ *
+ * @return true if the checkpoint is valid
+ */
+bool CheckpointReader::isValid() const { return valid_; }
+
+/**
+ * @brief Get the stage after which the snapshot was taken
+ *
+ * @return name of the stage
+ */
+std::string CheckpointReader::getStage() const { return stage_; }
+
+/**
+ * @brief Read a parameter block
+ *
+ * @param block first value of the block (left unchanged if the read failed)
+ * @param size number of doubles in the block
+ */
+void CheckpointReader::readBlock(double *block, int size) {
+  std::vector<double> values(size);
+  if (readBytes(reinterpret_cast<char *>(values.data()),
+                size * sizeof(double)))
+    std::copy(values.begin(), values.end(), block);
+}
+
+/**
+ * @brief Read a string written with CheckpointWriter::writeString
+ *
+ * @return string (empty if the read failed)
+ */
+std::string CheckpointReader::readString() {
+  std::vector<char> chars = readVector<char>();
+  return std::string(chars.begin(), chars.end());
+}
+
+/**
+ * @brief Read raw bytes from the file
+ *
+ * @param data buffer receiving the bytes
+ * @param size number of bytes
+ *
+ * @return true if the bytes were read
+ */
+bool CheckpointReader::readBytes(char *data, uint64_t size) {
+  if (!valid_ || size > remaining_) {
+    valid_ = false;
+    return false;
+  }
+  file_.read(data, size);
+  if (!file_) {
+    valid_ = false;
+    return false;
+  }
+  remaining_ -= size;
+  return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @class CheckpointWriter
+ *
+ * @brief Binary file receiving a snapshot of the calibration
+ *
+ * The file starts with a header (magic number, version and name of the stage
+ * after which the snapshot is taken) followed by the values in their native
+ * layout. A checkpoint is meant to be reloaded by the same build on the same
+ * machine, it is not a portable exchange format. The values are written in a
+ * temporary file which replaces the checkpoint when the writer is closed, so
+ * a crash during the write keeps the previous checkpoint intact.
+ *
+ *   CheckpointWriter writer(file_path, "intrinsic_calibration");
+ *   writer.write(nb_camera);
+ *   writer.writeBlock(intrinsics, 9);
+ *   writer.writeVector(pts_2d);
+ *   bool ok = writer.close();
+ */
+class CheckpointWriter {
+public:
+  // Functions
+  CheckpointWriter(std::string file_path, std::string stage);
+  ~CheckpointWriter();
+  bool isOpen() const;
+  template <typename T> void write(const T &value);
+  void writeBlock(const double *block, int size);
+  void writeString(const std::string &value);
+  template <typename T> void writeVector(const std::vector<T> &values);
+  bool close();
+
+private:
+  std::string file_path_; // path of the checkpoint
+  std::string tmp_path_;  // file written until the writer is closed
+  std::ofstream file_;    // output file (tmp_path_)
+};
+
+/**
+ * @class CheckpointReader
+ *
+ * @brief Read back a snapshot written by a CheckpointWriter
+ *
+ * The values must be read in the order they were written. Once a read fails
+ * (truncated file, size larger than the rest of the file), the reader is not
+ * valid anymore and returns zeros and empty values.
+ */
+class CheckpointReader {
+public:
+  // Functions
+  CheckpointReader(std::string file_path);
+  bool isValid() const;
+  std::string getStage() const;
+  template <typename T> T read();
+  void readBlock(double *block, int size);
+  std::string readString();
+  template <typename T> std::vector<T> readVector();
+
+private:
+  std::ifstream file_;     // input file
+  bool valid_ = false;     // false if the header or a read failed
+  std::string stage_;      // stage after which the snapshot was taken
+  uint64_t remaining_ = 0; // bytes not read yet
+
+  bool readBytes(char *data, uint64_t size);
+};
+
+/**
+ * @brief Write a value (plain data: integer, floating point, point...)
+ *
+ * @param value value to write
+ */
+template <typename T> void CheckpointWriter::write(const T &value) {
+  file_.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/**
+ * @brief Write a vector of plain data values preceded by its size
+ *
+ * @param values values to write
+ */
+template <typename T>
+void CheckpointWriter::writeVector(const std::vector<T> &values) {
+  write<uint64_t>(values.size());
+  if (!values.empty())
+    file_.write(reinterpret_cast<const char *>(values.data()),
+                values.size() * sizeof(T));
+}
+
+/**
+ * @brief Read a value written with CheckpointWriter::write
+ *
+ * @return value (zero-initialized if the read failed)
+ */
+template <typename T> T CheckpointReader::read() {
+  T value = T();
+  if (!readBytes(reinterpret_cast<char *>(&value), sizeof(T)))
+    value = T();
+  return value;
+}
+
+/**
+ * @brief Read a vector written with CheckpointWriter::writeVector
+ *
+ * @return values (empty if the read failed)
+ */
+template <typename T> std::vector<T> CheckpointReader::readVector() {
+  uint64_t size = read<uint64_t>();
+  if (!valid_ || size > remaining_ / sizeof(T)) {
+    valid_ = false;
+    return std::vector<T>();
+  }
+  std::vector<T> values(size);
+  if (size > 0 &&
+      !readBytes(reinterpret_cast<char *>(values.data()), size * sizeof(T)))
+    return std::vector<T>();
+  return values;
+}
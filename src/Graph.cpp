@@ -1,7 +1,53 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
 #include "Graph.hpp"
 #include "logger.h"
 
-Graph::GraphUndirectedWeighted Graph::getGraph() { return graph_; }
+/**
+ * @brief Get the path from the source of the tree to a vertex
+ *
+ * @param vertex destination of the path
+ *
+ * @return vector of vertices belonging to the path (empty if the vertex is not
+ * reachable from the source)
+ */
+std::vector<int> ShortestPathTree::pathTo(int vertex) const {
+  std::vector<int> path;
+  if (predecessor_.find(vertex) == predecessor_.end())
+    return path;
+
+  int current = vertex;
+  while (current != source_) {
+    path.push_back(current);
+    current = predecessor_.at(current);
+  }
+  path.push_back(source_);
+
+  std::reverse(path.begin(), path.end()); // return in source->vertex order
+  return path;
+}
+
+/**
+ * @brief Get the vertex associated with a user index, create it if needed
+ *
+ * @param vertex vertex index supplied by the user
+ *
+ * @return vertex in the graph
+ */
+int Graph::getOrAddVertex(int vertex) {
+  std::unordered_map<int, int>::iterator it = idx_to_vertex_.find(vertex);
+  if (it != idx_to_vertex_.end())
+    return it->second;
+
+  int created_vertex = vertex_to_idx_.size();
+  idx_to_vertex_[vertex] = created_vertex;
+  vertex_to_idx_.push_back(vertex);
+  csr_valid_ = false;
+  return created_vertex;
+}
 
 /**
  * @brief Add edge to the graph
@@ -14,18 +60,12 @@ Graph::GraphUndirectedWeighted Graph::getGraph() { return graph_; }
  * @param weight edge weight
  */
 void Graph::addEdge(int v1, int v2, double weight) {
-  // create a new vertex only when no vertex with the same name (i.e.
-  // boost::vertex_name_t) is available, reuse vertices otherwise
-  Vertex vertex1 = (idx_to_vertex_.find(v1) != idx_to_vertex_.end())
-                       ? idx_to_vertex_[v1]
-                       : boost::add_vertex(std::to_string(v1), graph_);
-  Vertex vertex2 = (idx_to_vertex_.find(v2) != idx_to_vertex_.end())
-                       ? idx_to_vertex_[v2]
-                       : boost::add_vertex(std::to_string(v2), graph_);
-  idx_to_vertex_[v1] = vertex1;
-  idx_to_vertex_[v2] = vertex2;
-
-  boost::add_edge(vertex1, vertex2, EdgeWeightProperty(weight), graph_);
+  Edge edge;
+  edge.v1_ = getOrAddVertex(v1);
+  edge.v2_ = getOrAddVertex(v2);
+  edge.weight_ = weight;
+  edges_.push_back(edge);
+  csr_valid_ = false;
 };
 
 /**
@@ -37,117 +77,202 @@ void Graph::addEdge(int v1, int v2, double weight) {
  * @param vertex vertex to be created
  */
 void Graph::addVertex(int vertex) {
-  // create a new vertex only when no vertex with the same name (i.e.
-  // boost::vertex_name_t) is available
   if (idx_to_vertex_.find(vertex) != idx_to_vertex_.end()) {
     LOG_WARNING << "Vertex {" << vertex
                 << "} is not added because it exists in the graph";
   } else {
-    Vertex created_vertex = boost::add_vertex(std::to_string(vertex), graph_);
-    idx_to_vertex_[vertex] = created_vertex;
+    getOrAddVertex(vertex);
   }
 };
 
+/**
+ * @brief Number of vertices in the graph
+ */
+int Graph::numVertices() const { return vertex_to_idx_.size(); }
+
+/**
+ * @brief Number of edges in the graph
+ */
+int Graph::numEdges() const { return edges_.size(); }
+
 /**
  * @brief Clear graph
  *
  */
 void Graph::clearGraph() {
-  graph_.clear();
   idx_to_vertex_.clear();
+  vertex_to_idx_.clear();
+  edges_.clear();
+  adjacency_offset_.clear();
+  adjacency_vertex_.clear();
+  adjacency_weight_.clear();
+  csr_valid_ = false;
+}
+
+/**
+ * @brief Build the CSR adjacency from the list of edges
+ *
+ * Each undirected edge is stored in the neighbourhood of both its vertices, in
+ * the insertion order of the edges.
+ */
+void Graph::buildAdjacency() {
+  if (csr_valid_)
+    return;
+
+  const int num_vertices = vertex_to_idx_.size();
+  adjacency_offset_.assign(num_vertices + 1, 0);
+  for (const Edge &edge : edges_) {
+    adjacency_offset_[edge.v1_ + 1]++;
+    adjacency_offset_[edge.v2_ + 1]++;
+  }
+  for (int v = 0; v < num_vertices; v++)
+    adjacency_offset_[v + 1] += adjacency_offset_[v];
+
+  adjacency_vertex_.resize(2 * edges_.size());
+  adjacency_weight_.resize(2 * edges_.size());
+  std::vector<int> next(adjacency_offset_.begin(), adjacency_offset_.end() - 1);
+  for (const Edge &edge : edges_) {
+    adjacency_vertex_[next[edge.v1_]] = edge.v2_;
+    adjacency_weight_[next[edge.v1_]++] = edge.weight_;
+    adjacency_vertex_[next[edge.v2_]] = edge.v1_;
+    adjacency_weight_[next[edge.v2_]++] = edge.weight_;
+  }
+  csr_valid_ = true;
 }
 
 /**
  * @brief Get al connected components
  *
+ * The components are sorted by their first inserted vertex, and the vertices
+ * of a component in their insertion order.
+ *
  * @return all connected components and a list of vertices belonging to each
  * component
  */
 std::vector<std::vector<int>> Graph::connectedComponents() {
   std::vector<std::vector<int>> all_components;
 
-  int num_vertices = boost::num_vertices(graph_);
-
+  const int num_vertices = vertex_to_idx_.size();
   if (num_vertices == 0)
     return all_components;
 
-  // get connected components with boost
-  std::vector<int> component(num_vertices);
-  int num_components = boost::connected_components(graph_, &component[0]);
-
-  for (int component_idx = 0; component_idx < num_components; ++component_idx) {
+  buildAdjacency();
 
-    std::vector<int> cur_component;
-    for (int vert_idx = 0; vert_idx < num_vertices; ++vert_idx) {
-      if (component[vert_idx] == component_idx) {
-        // get vertex name which was supplied by a user
-        std::string vert_name = boost::get(boost::vertex_name, graph_,
-                                           boost::vertex(vert_idx, graph_));
-
-        cur_component.push_back(std::stoi(vert_name));
+  // label the components with a breadth first search
+  std::vector<int> component(num_vertices, -1);
+  std::vector<int> queue;
+  queue.reserve(num_vertices);
+  int num_components = 0;
+  for (int root = 0; root < num_vertices; root++) {
+    if (component[root] != -1)
+      continue;
+    component[root] = num_components;
+    queue.clear();
+    queue.push_back(root);
+    for (int head = 0; head < queue.size(); head++) {
+      const int v = queue[head];
+      for (int e = adjacency_offset_[v]; e < adjacency_offset_[v + 1]; e++) {
+        const int neighbour = adjacency_vertex_[e];
+        if (component[neighbour] == -1) {
+          component[neighbour] = num_components;
+          queue.push_back(neighbour);
+        }
       }
     }
-    all_components.push_back(cur_component);
+    num_components++;
   }
 
+  all_components.resize(num_components);
+  for (int vert_idx = 0; vert_idx < num_vertices; ++vert_idx)
+    all_components[component[vert_idx]].push_back(vertex_to_idx_[vert_idx]);
+
   return all_components;
 };
 
 /**
- * @brief Get a shortest path between two vertices
+ * @brief Get the shortest paths from a vertex to all the other vertices
  *
- * Dijkstra Shortest Path algorithm on connected graph.
- * Inspired by https://siavashk.github.io/2019/01/23/boost-graph-library/
+ * Dijkstra Shortest Path algorithm run once from the source, all the paths of
+ * its connected component can then be read from the tree.
  *
- * @return vector of vertices belonging to the path
+ * @note Distances are accumulated as doubles. The former boost::graph version
+ * stored them as int, which truncated the 1/nb_poses covisibility weights to 0
+ * (or 1 for a single pose) so most paths were ties. Fractional weights are now
+ * honoured, hence the path, and the reference chosen through it, may differ
+ * from older releases on the same dataset.
+ *
+ * @param source root of the tree
+ *
+ * @return shortest path tree (empty if the source is not in the graph)
  */
-std::vector<int> Graph::shortestPathBetween(int v1, int v2) {
-  std::vector<int> vert_in_path;
+ShortestPathTree Graph::shortestPathTree(int source) {
+  ShortestPathTree tree;
+  tree.source_ = source;
 
-  if (idx_to_vertex_.find(v1) == idx_to_vertex_.end() ||
-      idx_to_vertex_.find(v2) == idx_to_vertex_.end()) {
-    LOG_ERROR << "Vertices with names {" << v1 << "," << v2
-              << "} are not in the graph";
-    return vert_in_path;
+  std::unordered_map<int, int>::iterator it_source =
+      idx_to_vertex_.find(source);
+  if (it_source == idx_to_vertex_.end()) {
+    LOG_ERROR << "Vertex with name {" << source << "} is not in the graph";
+    return tree;
   }
 
-  std::vector<VertexProperties> p(boost::num_vertices(graph_));
-  std::vector<int> d(boost::num_vertices(graph_));
-
-  const int num_vertices = boost::num_vertices(graph_);
-  std::vector<int> distances(num_vertices);
-  std::vector<Vertex> p_map(num_vertices);
+  buildAdjacency();
 
-  auto distance_map =
-      boost::predecessor_map(
-          boost::make_iterator_property_map(
-              p_map.begin(), boost::get(boost::vertex_index, graph_)))
-          .distance_map(boost::make_iterator_property_map(
-              distances.begin(), boost::get(boost::vertex_index, graph_)));
+  const int num_vertices = vertex_to_idx_.size();
+  std::vector<double> distances(num_vertices,
+                                std::numeric_limits<double>::infinity());
+  std::vector<int> predecessor(num_vertices, -1);
+  std::vector<bool> settled(num_vertices, false);
 
-  boost::dijkstra_shortest_paths(graph_, idx_to_vertex_[v1], distance_map);
+  typedef std::pair<double, int> QueueItem; // (distance, vertex)
+  std::priority_queue<QueueItem, std::vector<QueueItem>,
+                      std::greater<QueueItem>>
+      queue;
+  const int source_vertex = it_source->second;
+  distances[source_vertex] = 0.0;
+  predecessor[source_vertex] = source_vertex;
+  queue.push(std::make_pair(0.0, source_vertex));
+  while (!queue.empty()) {
+    const int v = queue.top().second;
+    queue.pop();
+    if (settled[v])
+      continue;
+    settled[v] = true;
+    tree.vertices_.push_back(vertex_to_idx_[v]);
+    tree.predecessor_[vertex_to_idx_[v]] = vertex_to_idx_[predecessor[v]];
 
-  vert_in_path = Graph::getPath(p_map, idx_to_vertex_[v1], idx_to_vertex_[v2]);
+    for (int e = adjacency_offset_[v]; e < adjacency_offset_[v + 1]; e++) {
+      const int neighbour = adjacency_vertex_[e];
+      const double distance = distances[v] + adjacency_weight_[e];
+      if (!settled[neighbour] && distance < distances[neighbour]) {
+        distances[neighbour] = distance;
+        predecessor[neighbour] = v;
+        queue.push(std::make_pair(distance, neighbour));
+      }
+    }
+  }
 
-  return vert_in_path;
-};
+  return tree;
+}
 
 /**
- * @brief Utility function to build a path after Dijkstra run
+ * @brief Get a shortest path between two vertices
+ *
+ * @note To get the paths from one vertex to many others, use shortestPathTree
+ * which runs Dijkstra only once.
  *
  * @return vector of vertices belonging to the path
  */
-std::vector<int> Graph::getPath(const std::vector<Vertex> &p_map,
-                                const Vertex &source,
-                                const Vertex &destination) {
-  std::vector<int> path;
-  Vertex current = destination;
-  while (current != source) {
-    path.push_back(std::stoi(boost::get(boost::vertex_name, graph_, current)));
-    current = p_map[current];
+std::vector<int> Graph::shortestPathBetween(int v1, int v2) {
+  std::vector<int> vert_in_path;
+
+  if (idx_to_vertex_.find(v1) == idx_to_vertex_.end() ||
+      idx_to_vertex_.find(v2) == idx_to_vertex_.end()) {
+    LOG_ERROR << "Vertices with names {" << v1 << "," << v2
+              << "} are not in the graph";
+    return vert_in_path;
   }
-  path.push_back(std::stoi(boost::get(boost::vertex_name, graph_, source)));
 
-  std::reverse(path.begin(), path.end()); // return in v1->v2 order
-  return path;
-}
+  vert_in_path = shortestPathTree(v1).pathTo(v2);
+  return vert_in_path;
+};
@@ -1,9 +1,26 @@
+#pragma once
+
 #include <unordered_map>
+#include <vector>
 
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/connected_components.hpp>
-#include <boost/graph/dijkstra_shortest_paths.hpp>
-#include <boost/graph/graph_traits.hpp>
+/**
+ * @struct ShortestPathTree
+ *
+ * @brief Shortest paths from one source vertex to all the vertices reachable
+ * from it.
+ *
+ * The vertices are sorted by increasing distance to the source, so every
+ * vertex is listed after its predecessor: transformations can be chained along
+ * the tree in a single pass.
+ */
+struct ShortestPathTree {
+  int source_;                 // root of the tree
+  std::vector<int> vertices_;  // reachable vertices (source first)
+  std::unordered_map<int, int> predecessor_; // vertex -> previous vertex in
+                                             // the path (source -> source)
+
+  std::vector<int> pathTo(int vertex) const;
+};
 
 /**
  * @class Graph
@@ -11,38 +28,39 @@
  * @brief Undirected weighted graph with connected components and shortest path
  * functionalities.
  *
- * Relies on boost. Reference:
- * https://www.boost.org/doc/libs/1_75_0/libs/graph/example/dijkstra-example.cpp
+ * The edges are stored in a compressed sparse row (CSR) adjacency, rebuilt
+ * once after the graph has been modified, so the traversals read contiguous
+ * memory.
  */
 class Graph {
 public:
-  // edge weight
-  typedef boost::property<boost::edge_weight_t, double> EdgeWeightProperty;
-  // vertex descriptor
-  typedef boost::property<boost::vertex_name_t, std::string> VertexProperties;
-
-  // graph
-  typedef boost::adjacency_list<boost::listS, boost::vecS, boost::undirectedS,
-                                VertexProperties, EdgeWeightProperty>
-      GraphUndirectedWeighted;
-
-  typedef
-      typename boost::graph_traits<GraphUndirectedWeighted>::vertex_descriptor
-          Vertex;
-
   void addVertex(int vertex);
   void addEdge(int v1, int v2, double weight);
-  GraphUndirectedWeighted getGraph();
+  int numVertices() const;
+  int numEdges() const;
   std::vector<std::vector<int>> connectedComponents();
+  ShortestPathTree shortestPathTree(int source);
   std::vector<int> shortestPathBetween(int v1, int v2);
   void clearGraph();
 
 private:
+  struct Edge {
+    int v1_;
+    int v2_;
+    double weight_;
+  };
+
   // map vertex index (supplied by a user) and actual vertex in the graph
-  std::unordered_map<int, Vertex> idx_to_vertex_;
+  std::unordered_map<int, int> idx_to_vertex_;
+  std::vector<int> vertex_to_idx_;
+  std::vector<Edge> edges_;
 
-  GraphUndirectedWeighted graph_;
+  // CSR adjacency (neighbours of vertex v in [offset_[v], offset_[v+1]))
+  bool csr_valid_ = false;
+  std::vector<int> adjacency_offset_;
+  std::vector<int> adjacency_vertex_;
+  std::vector<double> adjacency_weight_;
 
-  std::vector<int> getPath(const std::vector<Vertex> &p_map,
-                           const Vertex &source, const Vertex &destination);
+  int getOrAddVertex(int vertex);
+  void buildAdjacency();
 };
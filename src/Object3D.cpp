@@ -7,11 +7,21 @@
 #include "Camera.hpp"
 #include "Frame.hpp"
 #include "Object3D.hpp"
+#include "ObservationStore.hpp"
 #include "OptimizationCeres.h"
+#include "SolverTelemetry.hpp"
 #include "geometrytools.hpp"
 #include "logger.h"
 
-Object3D::Object3D() {}
+/**
+ * @brief Create the 3D object
+ *
+ * The board poses are allocated in the parameter arena.
+ *
+ * @param parameter_arena storage of the parameter blocks
+ */
+Object3D::Object3D(std::shared_ptr<ParameterArena> parameter_arena)
+    : parameter_arena_(parameter_arena) {}
 
 /**
  * @brief Insert a new object observation for this 3D object
@@ -50,6 +60,59 @@ void Object3D::insertBoardInObject(std::shared_ptr<Board> new_board) {
   nb_pts_ += new_board->nb_pts_;
 }
 
+/**
+ * @brief Append the 3D points of a board to the object
+ *
+ * The points of a board are stored contiguously in pts_3d_, so only the offset
+ * of the first point of the board is recorded.
+ *
+ * @param board_id id of the board the points belong to
+ * @param pts 3D points of the board in the referential of the object
+ */
+void Object3D::insertBoardPts(int board_id,
+                              const std::vector<cv::Point3f> &pts) {
+  if (board_id >= static_cast<int>(board_pts_offset_.size()))
+    board_pts_offset_.resize(board_id + 1, -1);
+  board_pts_offset_[board_id] = pts_3d_.size();
+  pts_3d_.reserve(pts_3d_.size() + pts.size());
+  pts_obj_2_board_.reserve(pts_obj_2_board_.size() + pts.size());
+  for (int k = 0; k < pts.size(); k++) {
+    pts_obj_2_board_.push_back(std::make_pair(board_id, k));
+    pts_3d_.push_back(pts[k]);
+  }
+}
+
+/**
+ * @brief Get the index in the object of a point of a board
+ *
+ * @param board_id id of the board (must belong to the object)
+ * @param pts_id index of the point in the board
+ *
+ * @return index of the point in pts_3d_
+ */
+int Object3D::getPtsIndex(int board_id, int pts_id) const {
+  return board_pts_offset_[board_id] + pts_id;
+}
+
+/**
+ * @brief Build the contiguous point table of the object
+ *
+ * For each point of the object, store its coordinates in the referential of its
+ * board and the pose block of this board. The refinements can then read them
+ * directly instead of looking up the boards for every corner. It must be called
+ * once all the boards and their poses are inserted in the object.
+ */
+void Object3D::initializePtsTable() {
+  pts_3d_board_.resize(pts_obj_2_board_.size());
+  pts_board_pose_.resize(pts_obj_2_board_.size());
+  for (int i = 0; i < pts_obj_2_board_.size(); i++) {
+    int board_id = pts_obj_2_board_[i].first;
+    int pts_id = pts_obj_2_board_[i].second;
+    pts_3d_board_[i] = boards_[board_id].lock()->pts_3d_[pts_id];
+    pts_board_pose_[i] = relative_board_pose_[board_id];
+  }
+}
+
 /**
  * @brief Insert a new frame associated to this 3D object
  *
@@ -59,11 +122,7 @@ void Object3D::insertNewFrame(std::shared_ptr<Frame> new_frame) {
   frames_[new_frame->frame_idx_] = new_frame;
 }
 
-Object3D::~Object3D() {
-  for (auto const &item : relative_board_pose_)
-    delete[] item.second;
-  relative_board_pose_.clear();
-}
+Object3D::~Object3D() {}
 
 /**
  * @brief Return (by reference) the pose vector of the board "board_id" in the
@@ -94,11 +153,18 @@ void Object3D::getBoardPoseVec(cv::Mat &r_vec, cv::Mat &t_vec, int board_id) {
  * @return 4x4 pose matrix of the board in the object
  */
 cv::Mat Object3D::getBoardPoseMat(int board_id) {
-  cv::Mat r_vec;
-  cv::Mat t_vec;
-  getBoardPoseVec(r_vec, t_vec, board_id);
-  cv::Mat pose = RVecT2Proj(r_vec, t_vec);
-  return pose;
+  return getBoardPose(board_id).toMat();
+}
+
+/**
+ * @brief Return the pose of "board_id" in the object
+ *
+ * @param board_id id of the board of interest in the object
+ *
+ * @return pose of the board in the object
+ */
+Pose Object3D::getBoardPose(int board_id) {
+  return Pose::fromBlock(relative_board_pose_[board_id]);
 }
 
 /**
@@ -108,15 +174,20 @@ cv::Mat Object3D::getBoardPoseMat(int board_id) {
  * @param board_id board index of interest
  */
 void Object3D::setBoardPoseMat(cv::Mat pose, int board_id) {
-  relative_board_pose_[board_id] = new double[6];
-  cv::Mat r_vec, t_vec;
-  Proj2RT(pose, r_vec, t_vec);
-  relative_board_pose_[board_id][0] = r_vec.at<double>(0);
-  relative_board_pose_[board_id][1] = r_vec.at<double>(1);
-  relative_board_pose_[board_id][2] = r_vec.at<double>(2);
-  relative_board_pose_[board_id][3] = t_vec.at<double>(0);
-  relative_board_pose_[board_id][4] = t_vec.at<double>(1);
-  relative_board_pose_[board_id][5] = t_vec.at<double>(2);
+  setBoardPose(Pose::fromMat(pose), board_id);
+}
+
+/**
+ * @brief Set pose of the board "board_id" in the object
+ *
+ * @param pose pose of the board in the object
+ * @param board_id board index of interest
+ */
+void Object3D::setBoardPose(const Pose &pose, int board_id) {
+  if (relative_board_pose_.find(board_id) == relative_board_pose_.end())
+    relative_board_pose_[board_id] =
+        parameter_arena_->allocate(ParameterArena::RelativeBoardPose, 6);
+  pose.toBlock(relative_board_pose_[board_id]);
 }
 
 /**
@@ -127,7 +198,9 @@ void Object3D::setBoardPoseMat(cv::Mat pose, int board_id) {
  * @param board_id board index of interest
  */
 void Object3D::setBoardPoseVec(cv::Mat r_vec, cv::Mat t_vec, int board_id) {
-  relative_board_pose_[board_id] = new double[6];
+  if (relative_board_pose_.find(board_id) == relative_board_pose_.end())
+    relative_board_pose_[board_id] =
+        parameter_arena_->allocate(ParameterArena::RelativeBoardPose, 6);
   relative_board_pose_[board_id][0] = r_vec.at<double>(0);
   relative_board_pose_[board_id][1] = r_vec.at<double>(1);
   relative_board_pose_[board_id][2] = r_vec.at<double>(2);
@@ -168,91 +241,61 @@ cv::Mat Object3D::getBoardTransVec(int board_id) {
  * @brief Refine the 3D object (board absolute pose) and pose of the object
  *
  * @param nb_iterations number of iterations of non-linear refinement
+ * @param store observations of the calibration
  *
  * @todo The current 3D object refinement refines all frames even when a single
  * board of the object is visible. We might need to include yet another
  * objective function
  */
-void Object3D::refineObject(int nb_iterations) {
+void Object3D::refineObject(int nb_iterations, const ObservationStore &store) {
 
   ceres::Problem problem;
 
-  // Iterate through the object obs
-  for (std::map<int, std::weak_ptr<Object3DObs>>::iterator it_obj_obs =
-           object_observations_.begin();
-       it_obj_obs != object_observations_.end(); ++it_obj_obs) {
-    std::shared_ptr<Object3DObs> current_object_obs = it_obj_obs->second.lock();
-    for (std::map<int, std::weak_ptr<BoardObs>>::iterator it_board_obs =
-             current_object_obs->board_observations_.begin();
-         it_board_obs != current_object_obs->board_observations_.end();
-         ++it_board_obs) {
-      if (it_board_obs->second.lock()->valid_ == true) {
-        std::shared_ptr<Board> board_3d_ptr =
-            it_board_obs->second.lock()->board_3d_.lock();
-        std::vector<cv::Point3f> board_pts_3d = board_3d_ptr->pts_3d_;
-        std::vector<int> board_pts_idx =
-            it_board_obs->second.lock()->charuco_id_;
-        std::vector<cv::Point2f> board_pts_2d =
-            it_board_obs->second.lock()->pts_2d_;
-        std::shared_ptr<Camera> cam_ptr =
-            it_board_obs->second.lock()->cam_.lock();
-        double fx = cam_ptr->intrinsics_[0];
-        double fy = cam_ptr->intrinsics_[1];
-        double u0 = cam_ptr->intrinsics_[2];
-        double v0 = cam_ptr->intrinsics_[3];
-        double r1 = cam_ptr->intrinsics_[4];
-        double r2 = cam_ptr->intrinsics_[5];
-        double t1 = cam_ptr->intrinsics_[6];
-        double t2 = cam_ptr->intrinsics_[7];
-        double r3 = cam_ptr->intrinsics_[8];
-        bool refine_board = true;
-        // We do not refine the board pose if only one board is visible or if
-        // it is the ref board
-        if (ref_board_id_ == it_board_obs->second.lock()->board_id_) {
-          refine_board = false;
-        }
-        for (int i = 0; i < board_pts_idx.size(); i++) {
-          cv::Point3f current_pts_3d =
-              board_pts_3d[board_pts_idx[i]];           // Current 3D pts
-          cv::Point2f current_pts_2d = board_pts_2d[i]; // Current 2D pts
-          ceres::CostFunction *reprojection_error =
-              ReprojectionError_3DObjRef::Create(
-                  double(current_pts_2d.x), double(current_pts_2d.y),
-                  double(current_pts_3d.x), double(current_pts_3d.y),
-                  double(current_pts_3d.z), fx, fy, u0, v0, r1, r2, r3, t1, t2,
-                  refine_board, cam_ptr->distortion_model_);
-          problem.AddResidualBlock(
-              reprojection_error, new ceres::HuberLoss(1.0),
-              it_obj_obs->second.lock()->pose_,
-              relative_board_pose_[it_board_obs->second.lock()->board_id_]);
-        }
+  // Iterate through the board obs of the object obs
+  for (const std::pair<int, double *> &board_obs :
+       store.getObjectBoardObs(obj_id_)) {
+    int board_obs_idx = board_obs.first;
+    if (store.board_obs_valid_[board_obs_idx]) {
+      int cam_idx = store.board_obs_camera_id_[board_obs_idx];
+      const double *intrinsics = store.camera_intrinsics_[cam_idx];
+      double fx = intrinsics[0];
+      double fy = intrinsics[1];
+      double u0 = intrinsics[2];
+      double v0 = intrinsics[3];
+      double r1 = intrinsics[4];
+      double r2 = intrinsics[5];
+      double t1 = intrinsics[6];
+      double t2 = intrinsics[7];
+      double r3 = intrinsics[8];
+      double *board_pose =
+          relative_board_pose_[store.board_obs_board_id_[board_obs_idx]];
+      for (int i = store.board_obs_pts_begin_[board_obs_idx];
+           i < store.board_obs_pts_begin_[board_obs_idx + 1]; i++) {
+        // Current 3D pts (in the board referential) and 2D pts
+        const cv::Point3f &current_pts_3d = store.board_pts_3d_[i];
+        const cv::Point2f &current_pts_2d = store.board_pts_2d_[i];
+        ceres::CostFunction *reprojection_error =
+            ReprojectionError_3DObjRef::Create(
+                double(current_pts_2d.x), double(current_pts_2d.y),
+                double(current_pts_3d.x), double(current_pts_3d.y),
+                double(current_pts_3d.z), fx, fy, u0, v0, r1, r2, r3, t1, t2,
+                store.camera_distortion_model_[cam_idx]);
+        problem.AddResidualBlock(reprojection_error, new ceres::HuberLoss(1.0),
+                                 board_obs.second, board_pose);
       }
     }
   }
+  // The reference board is the referential of the object
+  if (problem.HasParameterBlock(relative_board_pose_[ref_board_id_]))
+    problem.SetParameterBlockConstant(relative_board_pose_[ref_board_id_]);
+
   // Run the optimization
-  ceres::Solver::Options options;
-  options.linear_solver_type = ceres::SPARSE_SCHUR;
-  options.max_num_iterations = nb_iterations;
-  options.minimizer_progress_to_stdout = true;
   ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
+  solveProblem("refine_object_" + std::to_string(obj_id_),
+               nb_iterations, &problem, &summary);
 
   // Update the pts3d in the object
-  for (std::map<int, std::weak_ptr<Board>>::iterator it_board = boards_.begin();
-       it_board != boards_.end(); ++it_board) {
-    int board_idx = it_board->second.lock()->board_id_;
-
-    // Transform the 3D pts to push in the object 3D
-    std::vector<cv::Point3f> trans_pts =
-        transform3DPts(it_board->second.lock()->pts_3d_,
-                       getBoardRotVec(board_idx), getBoardTransVec(board_idx));
-
-    // Replace the keypoints
-    for (int i = 0; i < trans_pts.size(); i++) {
-      std::pair<int, int> board_id_pts_id = std::make_pair(board_idx, i);
-      pts_3d_[pts_board_2_obj_[board_id_pts_id]] = trans_pts[i];
-    }
-  }
+  updateObjectPts();
 }
 
 /**
@@ -264,16 +307,13 @@ void Object3D::updateObjectPts() {
   for (std::map<int, std::weak_ptr<Board>>::iterator it_board = boards_.begin();
        it_board != boards_.end(); ++it_board) {
     int board_idx = it_board->second.lock()->board_id_;
+    const std::vector<cv::Point3f> &board_pts =
+        it_board->second.lock()->pts_3d_;
+    Pose board_pose = getBoardPose(board_idx);
 
-    // Transform the 3D pts to push in the object 3D
-    std::vector<cv::Point3f> trans_pts =
-        transform3DPts(it_board->second.lock()->pts_3d_,
-                       getBoardRotVec(board_idx), getBoardTransVec(board_idx));
-
-    // Replace the keypoints
-    for (int i = 0; i < trans_pts.size(); i++) {
-      std::pair<int, int> board_id_pts_id = std::make_pair(board_idx, i);
-      pts_3d_[pts_board_2_obj_[board_id_pts_id]] = trans_pts[i];
-    }
+    // Replace the keypoints (transformed in the object referential)
+    const int offset = board_pts_offset_[board_idx];
+    for (int i = 0; i < board_pts.size(); i++)
+      pts_3d_[offset + i] = board_pose * board_pts[i];
   }
 }
@@ -6,11 +6,15 @@
 #include <opencv2/opencv.hpp>
 #include <stdio.h>
 
+#include "ParameterArena.hpp"
+#include "Pose.hpp"
+
 class Board;
 class BoardObs;
 class Object3DObs;
 class Frame;
 class Camera;
+class ObservationStore;
 
 /**
  * @class Object3D
@@ -36,14 +40,18 @@ public:
   std::vector<cv::Point3f> pts_3d_; // 3D points in the object
 
   // Indexing (from pts board to pts 3D obj and vice-versa)
-  std::map<std::pair<int, int>, int>
-      pts_board_2_obj_; // key(board_ind,pts_ind) --> pts_ind_obj
+  std::vector<int> board_pts_offset_; // board_id --> index of its first pts in
+                                      // pts_3d_ (-1 if not in the object)
   std::vector<std::pair<int, int>>
       pts_obj_2_board_; // key(boardid//ptsid)-->pts_ind_board
 
+  // Contiguous point table (indexed by the object points index)
+  std::vector<cv::Point3f> pts_3d_board_; // 3D points in their board frame
+  std::vector<double *> pts_board_pose_;  // pose of the board of each point
+
   // Boards composing the object
   std::map<int, std::weak_ptr<Board>> boards_;
-  std::map<int, double *> relative_board_pose_;
+  std::map<int, double *> relative_board_pose_; // blocks in the parameter arena
 
   // List of object observation for this 3D object
   std::map<int, std::weak_ptr<Object3DObs>> object_observations_;
@@ -51,20 +59,28 @@ public:
   // List of frames where this board is visible
   std::map<int, std::weak_ptr<Frame>> frames_;
 
+  // Storage of the board poses
+  std::shared_ptr<ParameterArena> parameter_arena_;
+
   // Functions
-  Object3D();
+  Object3D(std::shared_ptr<ParameterArena> parameter_arena);
   ~Object3D();
   void initializeObject3D(int nb_boards, int ref_board_id, int obj_id,
                           std::vector<double> color);
   void insertBoardInObject(std::shared_ptr<Board> new_board);
+  void insertBoardPts(int board_id, const std::vector<cv::Point3f> &pts);
+  int getPtsIndex(int board_id, int pts_id) const;
   void insertNewObject(std::shared_ptr<Object3DObs> new_object);
   void insertNewFrame(std::shared_ptr<Frame> new_frame);
   void getBoardPoseVec(cv::Mat &r_vec, cv::Mat &t_vec, int board_id);
   cv::Mat getBoardPoseMat(int board_id);
+  Pose getBoardPose(int board_id);
   void setBoardPoseMat(cv::Mat pose, int board_id);
+  void setBoardPose(const Pose &pose, int board_id);
   void setBoardPoseVec(cv::Mat r_vec, cv::Mat t_vec, int board_id);
   cv::Mat getBoardRotVec(int board_id);
   cv::Mat getBoardTransVec(int board_id);
-  void refineObject(int nb_iterations);
+  void refineObject(int nb_iterations, const ObservationStore &store);
   void updateObjectPts();
+  void initializePtsTable();
 };
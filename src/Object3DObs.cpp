@@ -6,10 +6,22 @@
 
 #include "Camera.hpp"
 #include "Object3DObs.hpp"
+#include "TraceSink.hpp"
 #include "geometrytools.hpp"
 #include "logger.h"
 
-Object3DObs::Object3DObs() {}
+/**
+ * @brief Create the object observation
+ *
+ * The poses are allocated in the parameter arena.
+ *
+ * @param parameter_arena storage of the parameter blocks
+ */
+Object3DObs::Object3DObs(std::shared_ptr<ParameterArena> parameter_arena)
+    : parameter_arena_(parameter_arena) {
+  pose_ = parameter_arena_->allocate(ParameterArena::ObjectPose, 6);
+  group_pose_ = parameter_arena_->allocate(ParameterArena::ObjectGroupPose, 6);
+}
 
 /**
  * @brief initialize the object in the observation (what board is observed)
@@ -38,20 +50,19 @@ void Object3DObs::insertNewBoardObs(std::shared_ptr<BoardObs> new_board_obs) {
   board_observations_[board_observations_.size()] = new_board_obs;
 
   // push the 2d pts and index
+  std::shared_ptr<Object3D> object_3d = object_3d_.lock();
+  pts_2d_.reserve(pts_2d_.size() + new_board_obs->pts_2d_.size());
+  pts_id_.reserve(pts_id_.size() + new_board_obs->pts_2d_.size());
   for (int i = 0; i < new_board_obs->pts_2d_.size(); i++) {
     // Convert the index from the board to the object
-    std::pair<int, int> board_id_pts_id =
-        std::make_pair(new_board_obs->board_id_, new_board_obs->charuco_id_[i]);
-    int pts_idx_obj = object_3d_.lock()->pts_board_2_obj_[board_id_pts_id];
+    int pts_idx_obj = object_3d->getPtsIndex(new_board_obs->board_id_,
+                                             new_board_obs->charuco_id_[i]);
     pts_2d_.push_back(new_board_obs->pts_2d_[i]);
     pts_id_.push_back(pts_idx_obj);
   }
 }
 
-Object3DObs::~Object3DObs() {
-  delete[] pose_;
-  delete[] group_pose_;
-}
+Object3DObs::~Object3DObs() {}
 
 /**
  * @brief Get the pose of the object w.r.t. the camera
@@ -77,13 +88,14 @@ void Object3DObs::getPoseVec(cv::Mat &r_vec, cv::Mat &t_vec) {
  *
  * @return 4x4 pose matrix
  */
-cv::Mat Object3DObs::getPoseMat() {
-  cv::Mat r_vec;
-  cv::Mat t_vec;
-  getPoseVec(r_vec, t_vec);
-  cv::Mat pose = RVecT2Proj(r_vec, t_vec);
-  return pose;
-}
+cv::Mat Object3DObs::getPoseMat() { return getPose().toMat(); }
+
+/**
+ * @brief Get the pose of the object w.r.t. the camera
+ *
+ * @return object pose
+ */
+Pose Object3DObs::getPose() { return Pose::fromBlock(pose_); }
 
 /**
  * @brief Get rotation vector of the object w.r.t. the camera
@@ -114,16 +126,14 @@ cv::Mat Object3DObs::getTransVec() {
  *
  * @param pose 4x4 pose matrix
  */
-void Object3DObs::setPoseMat(cv::Mat pose) {
-  cv::Mat r_vec, t_vec;
-  Proj2RT(pose, r_vec, t_vec);
-  pose_[0] = r_vec.at<double>(0);
-  pose_[1] = r_vec.at<double>(1);
-  pose_[2] = r_vec.at<double>(2);
-  pose_[3] = t_vec.at<double>(0);
-  pose_[4] = t_vec.at<double>(1);
-  pose_[5] = t_vec.at<double>(2);
-}
+void Object3DObs::setPoseMat(cv::Mat pose) { setPose(Pose::fromMat(pose)); }
+
+/**
+ * @brief Set pose of the object w.r.t. the camera
+ *
+ * @param pose object pose
+ */
+void Object3DObs::setPose(const Pose &pose) { pose.toBlock(pose_); }
 
 /**
  * @brief Set pose of the object w.r.t. the cam from rotation and translation
@@ -148,14 +158,17 @@ void Object3DObs::setPoseVec(cv::Mat r_vec, cv::Mat t_vec) {
  * @param pose 4x4 pose matrix
  */
 void Object3DObs::setPoseInGroupMat(cv::Mat pose) {
-  cv::Mat r_vec, t_vec;
-  Proj2RT(pose, r_vec, t_vec);
-  group_pose_[0] = r_vec.at<double>(0);
-  group_pose_[1] = r_vec.at<double>(1);
-  group_pose_[2] = r_vec.at<double>(2);
-  group_pose_[3] = t_vec.at<double>(0);
-  group_pose_[4] = t_vec.at<double>(1);
-  group_pose_[5] = t_vec.at<double>(2);
+  setPoseInGroup(Pose::fromMat(pose));
+}
+
+/**
+ * @brief Set the pose of the object in the referential of the group observing
+ * the object
+ *
+ * @param pose object pose in the group
+ */
+void Object3DObs::setPoseInGroup(const Pose &pose) {
+  pose.toBlock(group_pose_);
 }
 
 /**
@@ -198,13 +211,14 @@ void Object3DObs::getPoseInGroupVec(cv::Mat &r_vec, cv::Mat &t_vec) {
  *
  * @return 4x4 pose matrix
  */
-cv::Mat Object3DObs::getPoseInGroupMat() {
-  cv::Mat r_vec;
-  cv::Mat t_vec;
-  getPoseInGroupVec(r_vec, t_vec);
-  cv::Mat pose = RVecT2Proj(r_vec, t_vec);
-  return pose;
-}
+cv::Mat Object3DObs::getPoseInGroupMat() { return getPoseInGroup().toMat(); }
+
+/**
+ * @brief Get the pose of the object w.r.t. the group of camera
+ *
+ * @return object pose in the group
+ */
+Pose Object3DObs::getPoseInGroup() { return Pose::fromBlock(group_pose_); }
 
 /**
  * @brief Get rotation vector of the object w.r.t. the camera group
@@ -245,6 +259,10 @@ void Object3DObs::estimatePose(double ransac_thresh) {
   // Estimate the pose using a RANSAC
   cv::Mat r_vec, t_vec;
   std::shared_ptr<Camera> cam_ptr = cam_.lock();
+  TraceScope trace("object_pose_ransac", "ransac");
+  trace.addArg("camera", camera_id_);
+  trace.addArg("frame", frame_id_);
+  trace.addArg("object", object_3d_id_);
   cv::Mat inliers = ransacP3PDistortion(
       object_pts_temp, pts_2d_, cam_ptr->getCameraMat(),
       cam_ptr->getDistortionVectorVector(), r_vec, t_vec, ransac_thresh, 0.99,
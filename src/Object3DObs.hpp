@@ -2,6 +2,8 @@
 
 #include "Board.hpp"
 #include "Object3D.hpp"
+#include "ParameterArena.hpp"
+#include "Pose.hpp"
 #include "opencv2/core/core.hpp"
 #include <iostream>
 #include <opencv2/aruco/charuco.hpp>
@@ -36,11 +38,12 @@ public:
   int object_3d_id_;
 
   // Pose
-  double *pose_ = new double[6];
+  double *pose_; // block in the parameter arena
 
   // Pose in camera group
-  double *group_pose_ =
-      new double[6]; // pose of the object expressed in camera group referential
+  double *group_pose_; // pose of the object expressed in camera group
+                       // referential
+  std::shared_ptr<ParameterArena> parameter_arena_;
   // int cam_group_id_;
 
   // points
@@ -64,22 +67,26 @@ public:
   bool valid_ = true;
 
   // Functions
-  Object3DObs();
+  Object3DObs(std::shared_ptr<ParameterArena> parameter_arena);
   ~Object3DObs();
   void initializeObject(std::shared_ptr<Object3D> obj_obs, int object_idx);
   void insertNewBoardObs(std::shared_ptr<BoardObs> new_board_obs);
   void getPoseVec(cv::Mat &R, cv::Mat &T);
   cv::Mat getPoseMat();
-  void setPoseMat(cv::Mat Pose);
+  Pose getPose();
+  void setPoseMat(cv::Mat pose);
+  void setPose(const Pose &pose);
   void setPoseVec(cv::Mat Rvec, cv::Mat T);
   cv::Mat getRotVec();
   cv::Mat getTransVec();
   void estimatePose(double ransac_thresh);
   float computeReprojectionError();
   void setPoseInGroupMat(cv::Mat pose);
+  void setPoseInGroup(const Pose &pose);
   void setPoseInGroupVec(cv::Mat r_vec, cv::Mat t_vec);
   void getPoseInGroupVec(cv::Mat &r_vec, cv::Mat &t_vec);
   cv::Mat getPoseInGroupMat();
+  Pose getPoseInGroup();
   cv::Mat getRotInGroupVec();
   cv::Mat getTransInGroupVec();
 };
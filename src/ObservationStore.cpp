@@ -0,0 +1,187 @@
+#include "opencv2/core/core.hpp"
+#include <iostream>
+#include <stdio.h>
+
+#include "ObservationStore.hpp"
+#include "logger.h"
+
+ObservationStore::ObservationStore() {}
+
+/**
+ * @brief Build the board observations and the cameras table
+ *
+ * The previous board observations and their links to the objects are erased.
+ *
+ * @param board_observations board observations of the calibration
+ * @param cams cameras of the calibration
+ */
+void ObservationStore::initBoardObservations(
+    const std::map<int, std::shared_ptr<BoardObs>> &board_observations,
+    const std::map<int, std::shared_ptr<Camera>> &cams) {
+  // Cameras
+  camera_intrinsics_.clear();
+  camera_distortion_model_.clear();
+  for (const auto &item : cams) {
+    if (item.first >= camera_intrinsics_.size()) {
+      camera_intrinsics_.resize(item.first + 1, nullptr);
+      camera_distortion_model_.resize(item.first + 1, 0);
+    }
+    camera_intrinsics_[item.first] = item.second->intrinsics_;
+    camera_distortion_model_[item.first] = item.second->distortion_model_;
+  }
+
+  // Board observations
+  board_obs_camera_id_.clear();
+  board_obs_frame_id_.clear();
+  board_obs_board_id_.clear();
+  board_obs_valid_.clear();
+  board_obs_pose_.clear();
+  board_obs_pts_begin_.clear();
+  board_pts_2d_.clear();
+  board_pts_3d_.clear();
+  camera_board_obs_.clear();
+  object_board_obs_.clear();
+  board_obs_index_.clear();
+  for (const auto &item : board_observations) {
+    const BoardObs &board_obs = *item.second;
+    std::shared_ptr<Board> board_3d_ptr = board_obs.board_3d_.lock();
+    int board_obs_idx = board_obs_camera_id_.size();
+    board_obs_camera_id_.push_back(board_obs.camera_id_);
+    board_obs_frame_id_.push_back(board_obs.frame_id_);
+    board_obs_board_id_.push_back(board_obs.board_id_);
+    board_obs_valid_.push_back(board_obs.valid_);
+    board_obs_pose_.push_back(board_obs.pose_);
+    board_obs_pts_begin_.push_back(board_pts_2d_.size());
+    for (int i = 0; i < board_obs.charuco_id_.size(); i++) {
+      board_pts_2d_.push_back(board_obs.pts_2d_[i]);
+      board_pts_3d_.push_back(board_3d_ptr->pts_3d_[board_obs.charuco_id_[i]]);
+    }
+    camera_board_obs_[board_obs.camera_id_].push_back(board_obs_idx);
+    board_obs_index_[&board_obs] = board_obs_idx;
+  }
+  board_obs_pts_begin_.push_back(board_pts_2d_.size());
+  LOG_DEBUG << "Observation store :: " << board_obs_camera_id_.size()
+            << " board observations, " << board_pts_2d_.size() << " points";
+}
+
+/**
+ * @brief Link the board observations to the objects observations
+ *
+ * @param object_3d objects of the calibration
+ * @param object_observations object observations of the calibration
+ */
+void ObservationStore::updateObjectObservations(
+    const std::map<int, std::shared_ptr<Object3D>> &object_3d,
+    const std::map<int, std::shared_ptr<Object3DObs>> &object_observations) {
+  object_3d_.clear();
+  for (const auto &item : object_3d)
+    object_3d_[item.first] = item.second;
+
+  object_board_obs_.clear();
+  for (const auto &item : object_observations) {
+    const Object3DObs &object_obs = *item.second;
+    for (const auto &item_board_obs : object_obs.board_observations_) {
+      std::map<const BoardObs *, int>::iterator it_board_obs =
+          board_obs_index_.find(item_board_obs.second.lock().get());
+      if (it_board_obs == board_obs_index_.end())
+        continue;
+      object_board_obs_[object_obs.object_3d_id_].push_back(
+          std::make_pair(it_board_obs->second, object_obs.pose_));
+    }
+  }
+}
+
+/**
+ * @brief Build the object observations of the camera groups
+ *
+ * The observations of each camera group are contiguous and sorted by frame.
+ *
+ * @param cams_group_obs camera groups observations of the calibration
+ */
+void ObservationStore::updateCameraGroupObservations(
+    const std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>
+        &cams_group_obs) {
+  object_obs_camera_id_.clear();
+  object_obs_frame_id_.clear();
+  object_obs_object_id_.clear();
+  object_obs_cam_group_id_.clear();
+  object_obs_group_pose_.clear();
+  object_obs_pts_begin_.clear();
+  object_pts_2d_.clear();
+  object_pts_id_.clear();
+  cam_group_object_obs_.clear();
+  for (const auto &item : cams_group_obs) {
+    CameraGroupObs &cam_group_obs = *item.second;
+    int cam_group_idx = cam_group_obs.cam_group_idx_;
+    if (cam_group_object_obs_.find(cam_group_idx) ==
+        cam_group_object_obs_.end())
+      cam_group_object_obs_[cam_group_idx] = std::make_pair(
+          int(object_obs_camera_id_.size()), int(object_obs_camera_id_.size()));
+    for (const auto &item_obj_obs : cam_group_obs.object_observations_) {
+      std::shared_ptr<Object3DObs> object_obs = item_obj_obs.second.lock();
+      object_obs_camera_id_.push_back(object_obs->camera_id_);
+      object_obs_frame_id_.push_back(object_obs->frame_id_);
+      object_obs_object_id_.push_back(object_obs->object_3d_id_);
+      object_obs_cam_group_id_.push_back(cam_group_idx);
+      object_obs_group_pose_.push_back(
+          cam_group_obs.getObjectPoseBlock(object_obs->object_3d_id_));
+      object_obs_pts_begin_.push_back(object_pts_2d_.size());
+      object_pts_2d_.insert(object_pts_2d_.end(), object_obs->pts_2d_.begin(),
+                            object_obs->pts_2d_.end());
+      object_pts_id_.insert(object_pts_id_.end(), object_obs->pts_id_.begin(),
+                            object_obs->pts_id_.end());
+    }
+    cam_group_object_obs_[cam_group_idx].second = object_obs_camera_id_.size();
+  }
+  object_obs_pts_begin_.push_back(object_pts_2d_.size());
+  LOG_DEBUG << "Observation store :: " << object_obs_camera_id_.size()
+            << " object observations, " << object_pts_2d_.size() << " points";
+}
+
+/**
+ * @brief Get the board observations of a camera
+ *
+ * @param cam_idx camera index
+ *
+ * @return indexes of the board observations
+ */
+const std::vector<int> &ObservationStore::getCameraBoardObs(int cam_idx) const {
+  std::map<int, std::vector<int>>::const_iterator it =
+      camera_board_obs_.find(cam_idx);
+  if (it == camera_board_obs_.end())
+    return no_board_obs_;
+  return it->second;
+}
+
+/**
+ * @brief Get the board observations of an object and the pose of the object
+ * observation containing them
+ *
+ * @param object_id object index
+ *
+ * @return pairs (index of the board observation, pose of the object obs)
+ */
+const std::vector<std::pair<int, double *>> &
+ObservationStore::getObjectBoardObs(int object_id) const {
+  std::map<int, std::vector<std::pair<int, double *>>>::const_iterator it =
+      object_board_obs_.find(object_id);
+  if (it == object_board_obs_.end())
+    return no_object_board_obs_;
+  return it->second;
+}
+
+/**
+ * @brief Get the range of object observations of a camera group
+ *
+ * @param cam_group_idx camera group index
+ *
+ * @return range [begin, end) of the object observations
+ */
+std::pair<int, int>
+ObservationStore::getCameraGroupObjectObs(int cam_group_idx) const {
+  std::map<int, std::pair<int, int>>::const_iterator it =
+      cam_group_object_obs_.find(cam_group_idx);
+  if (it == cam_group_object_obs_.end())
+    return std::make_pair(0, 0);
+  return it->second;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+#include <iostream>
+#include <map>
+#include <stdio.h>
+
+#include "BoardObs.hpp"
+#include "Camera.hpp"
+#include "CameraGroupObs.hpp"
+#include "Object3D.hpp"
+#include "Object3DObs.hpp"
+
+/**
+ * @class ObservationStore
+ *
+ * @brief Flat (struct-of-arrays) copy of the observations used by the
+ * refinements and the reprojection errors
+ *
+ * The observations are stored in contiguous arrays indexed by the observation
+ * index; the points of the observation "i" are in the range
+ * [pts_begin[i], pts_begin[i + 1]) of the points arrays. The parameter blocks
+ * are the pointers of the parameter arena, so the store remains valid when the
+ * poses are updated. It must be updated when the structure of the calibration
+ * changes (new objects or camera groups observations).
+ *
+ * - board observations: built after the detection and the pose estimation of
+ * the boards (which removes the outliers), then linked to the object
+ * observations
+ * - object observations in the camera groups: rebuilt with the camera groups
+ * observations
+ */
+class ObservationStore {
+public:
+  // Cameras (indexed by camera index)
+  std::vector<double *> camera_intrinsics_; // intrinsic parameters blocks
+  std::vector<int> camera_distortion_model_;
+
+  // Objects
+  std::map<int, std::weak_ptr<Object3D>> object_3d_;
+
+  // Board observations
+  std::vector<int> board_obs_camera_id_;
+  std::vector<int> board_obs_frame_id_;
+  std::vector<int> board_obs_board_id_;
+  std::vector<char> board_obs_valid_;
+  std::vector<double *> board_obs_pose_;  // pose of the board
+  std::vector<int> board_obs_pts_begin_;  // first point of each obs
+  std::vector<cv::Point2f> board_pts_2d_; // 2D points
+  std::vector<cv::Point3f> board_pts_3d_; // 3D points in the board
+  std::map<int, std::vector<int>> camera_board_obs_; // key: camera index
+  std::map<int, std::vector<std::pair<int, double *>>>
+      object_board_obs_; // key: object index, value: (board obs, object pose)
+
+  // Object observations in the camera groups
+  std::vector<int> object_obs_camera_id_;
+  std::vector<int> object_obs_frame_id_;
+  std::vector<int> object_obs_object_id_;
+  std::vector<int> object_obs_cam_group_id_;
+  std::vector<double *> object_obs_group_pose_; // pose of object in the group
+  std::vector<int> object_obs_pts_begin_;       // first point of each obs
+  std::vector<cv::Point2f> object_pts_2d_;      // 2D points
+  std::vector<int> object_pts_id_;              // index in the object
+  std::map<int, std::pair<int, int>>
+      cam_group_object_obs_; // key: camera group index, value: [begin, end)
+
+  // Functions
+  ObservationStore();
+  ~ObservationStore(){};
+  void initBoardObservations(
+      const std::map<int, std::shared_ptr<BoardObs>> &board_observations,
+      const std::map<int, std::shared_ptr<Camera>> &cams);
+  void updateObjectObservations(
+      const std::map<int, std::shared_ptr<Object3D>> &object_3d,
+      const std::map<int, std::shared_ptr<Object3DObs>> &object_observations);
+  void updateCameraGroupObservations(
+      const std::map<std::pair<int, int>, std::shared_ptr<CameraGroupObs>>
+          &cams_group_obs);
+  const std::vector<int> &getCameraBoardObs(int cam_idx) const;
+  const std::vector<std::pair<int, double *>> &
+  getObjectBoardObs(int object_id) const;
+  std::pair<int, int> getCameraGroupObjectObs(int cam_group_idx) const;
+
+private:
+  std::map<const BoardObs *, int> board_obs_index_; // index of the board obs
+  std::vector<int> no_board_obs_; // returned when a camera has no obs
+  std::vector<std::pair<int, double *>>
+      no_object_board_obs_; // returned when an object has no obs
+};
@@ -1,8 +1,6 @@
 #ifndef OPTIMIZATIONCERES_H
 #define OPTIMIZATIONCERES_H
 
-#endif // OPTIMIZATIONCERES_H
-
 #include "ceres/ceres.h"
 #include "ceres/rotation.h"
 #include <eigen3/Eigen/Dense>
@@ -117,15 +115,15 @@ struct ReprojectionError {
 };
 
 // 3D object refinement (board pose + object pose)
+// The pose of the reference board is kept constant in the problem
 struct ReprojectionError_3DObjRef {
   ReprojectionError_3DObjRef(double u, double v, double x, double y, double z,
                              double focal_x, double focal_y, double u0,
                              double v0, double k1, double k2, double k3,
-                             double p1, double p2, bool refine_board,
-                             int distortion_type)
+                             double p1, double p2, int distortion_type)
       : u(u), v(v), x(x), y(y), z(z), focal_x(focal_x), focal_y(focal_y),
         u0(u0), v0(v0), k1(k1), k2(k2), k3(k3), p1(p1), p2(p2),
-        refine_board(refine_board), distortion_type(distortion_type) {}
+        distortion_type(distortion_type) {}
 
   template <typename T>
   bool operator()(const T *const camera, const T *const boardtrans,
@@ -134,18 +132,10 @@ struct ReprojectionError_3DObjRef {
     // apply transformation to the board
     T pboard[3];
     const T point[3] = {T(x), T(y), T(z)};
-    // refine_board == 0 then the board is the reference and should not be
-    // refined
-    if (refine_board != 0) {
-      ceres::AngleAxisRotatePoint(boardtrans, point, pboard);
-      pboard[0] += boardtrans[3];
-      pboard[1] += boardtrans[4];
-      pboard[2] += boardtrans[5];
-    } else {
-      pboard[0] = point[0];
-      pboard[1] = point[1];
-      pboard[2] = point[2];
-    }
+    ceres::AngleAxisRotatePoint(boardtrans, point, pboard);
+    pboard[0] += boardtrans[3];
+    pboard[1] += boardtrans[4];
+    pboard[2] += boardtrans[5];
 
     // camera[0,1,2] are the angle-axis rotation for the camera.
     T p[3];
@@ -225,11 +215,11 @@ struct ReprojectionError_3DObjRef {
          const double z, const double focal_x, const double focal_y,
          const double u0, const double v0, const double k1, const double k2,
          const double k3, const double p1, const double p2,
-         const bool refine_board, const int distortion_type) {
+         const int distortion_type) {
     return (
         new ceres::AutoDiffCostFunction<ReprojectionError_3DObjRef, 2, 6, 6>(
             new ReprojectionError_3DObjRef(u, v, x, y, z, focal_x, focal_y, u0,
-                                           v0, k1, k2, k3, p1, p2, refine_board,
+                                           v0, k1, k2, k3, p1, p2,
                                            distortion_type)));
   }
 
@@ -246,21 +236,20 @@ struct ReprojectionError_3DObjRef {
   double k3;
   double p1;
   double p2;
-  bool refine_board;
   int distortion_type;
 };
 
 // Refine camera group (3D object pose and relative camera pose)
-// 3D object refinement (board pose + object pose)
+// The pose of the reference camera is kept constant in the problem
 struct ReprojectionError_CameraGroupRef {
   ReprojectionError_CameraGroupRef(double u, double v, double x, double y,
                                    double z, double focal_x, double focal_y,
                                    double u0, double v0, double k1, double k2,
                                    double k3, double p1, double p2,
-                                   bool refine_camera, int distortion_type)
+                                   int distortion_type)
       : u(u), v(v), x(x), y(y), z(z), focal_x(focal_x), focal_y(focal_y),
         u0(u0), v0(v0), k1(k1), k2(k2), k3(k3), p1(p1), p2(p2),
-        refine_camera(refine_camera), distortion_type(distortion_type) {}
+        distortion_type(distortion_type) {}
 
   template <typename T>
   bool operator()(const T *const camera, const T *const object_pose,
@@ -275,13 +264,11 @@ struct ReprojectionError_CameraGroupRef {
     pobj[1] += object_pose[4];
     pobj[2] += object_pose[5];
 
-    // 2. Refine the camera if it is not the referential
-    if (refine_camera != 0) {
-      ceres::AngleAxisRotatePoint(camera, pobj, pobj);
-      pobj[0] += camera[3];
-      pobj[1] += camera[4];
-      pobj[2] += camera[5];
-    }
+    // 2. apply the camera pose in the group
+    ceres::AngleAxisRotatePoint(camera, pobj, pobj);
+    pobj[0] += camera[3];
+    pobj[1] += camera[4];
+    pobj[2] += camera[5];
 
     // Normalization on the camera plane
     pobj[0] /= pobj[2];
@@ -354,12 +341,12 @@ struct ReprojectionError_CameraGroupRef {
          const double z, const double focal_x, const double focal_y,
          const double u0, const double v0, const double k1, const double k2,
          const double k3, const double p1, const double p2,
-         const bool refine_camera, const int distortion_type) {
+         const int distortion_type) {
     return (new ceres::AutoDiffCostFunction<ReprojectionError_CameraGroupRef, 2,
                                             6, 6>(
         new ReprojectionError_CameraGroupRef(u, v, x, y, z, focal_x, focal_y,
                                              u0, v0, k1, k2, k3, p1, p2,
-                                             refine_camera, distortion_type)));
+                                             distortion_type)));
   }
 
   double u, v;
@@ -375,20 +362,19 @@ struct ReprojectionError_CameraGroupRef {
   double k3;
   double p1;
   double p2;
-  bool refine_camera;
   int distortion_type;
 };
 
 // Refine camera group (3D object pose + relative camera pose + Board pose)
+// The poses of the reference camera and reference boards are kept constant in
+// the problem
 struct ReprojectionError_CameraGroupAndObjectRef {
   ReprojectionError_CameraGroupAndObjectRef(
       double u, double v, double x, double y, double z, double focal_x,
       double focal_y, double u0, double v0, double k1, double k2, double k3,
-      double p1, double p2, bool refine_camera, bool refine_board,
-      int distortion_type)
+      double p1, double p2, int distortion_type)
       : u(u), v(v), x(x), y(y), z(z), focal_x(focal_x), focal_y(focal_y),
         u0(u0), v0(v0), k1(k1), k2(k2), k3(k3), p1(p1), p2(p2),
-        refine_camera(refine_camera), refine_board(refine_board),
         distortion_type(distortion_type) {}
 
   template <typename T>
@@ -397,12 +383,10 @@ struct ReprojectionError_CameraGroupAndObjectRef {
 
     // 1. Apply the board transformation in teh object
     T point[3] = {T(x), T(y), T(z)};
-    if (refine_board != 0) {
-      ceres::AngleAxisRotatePoint(board_pose, point, point);
-      point[0] += board_pose[3];
-      point[1] += board_pose[4];
-      point[2] += board_pose[5];
-    }
+    ceres::AngleAxisRotatePoint(board_pose, point, point);
+    point[0] += board_pose[3];
+    point[1] += board_pose[4];
+    point[2] += board_pose[5];
 
     // 2. apply transformation to the object (to expressed in the current
     // camera)
@@ -412,13 +396,11 @@ struct ReprojectionError_CameraGroupAndObjectRef {
     pobj[1] += object_pose[4];
     pobj[2] += object_pose[5];
 
-    // 3. Refine the camera if it is not the referential
-    if (refine_camera != 0) {
-      ceres::AngleAxisRotatePoint(camera, pobj, pobj);
-      pobj[0] += camera[3];
-      pobj[1] += camera[4];
-      pobj[2] += camera[5];
-    }
+    // 3. apply the camera pose in the group
+    ceres::AngleAxisRotatePoint(camera, pobj, pobj);
+    pobj[0] += camera[3];
+    pobj[1] += camera[4];
+    pobj[2] += camera[5];
 
     // Normalization on the camera plane
     pobj[0] /= pobj[2];
@@ -491,13 +473,12 @@ struct ReprojectionError_CameraGroupAndObjectRef {
          const double z, const double focal_x, const double focal_y,
          const double u0, const double v0, const double k1, const double k2,
          const double k3, const double p1, const double p2,
-         const bool refine_camera, const bool refine_board,
          const int distortion_type) {
     return (new ceres::AutoDiffCostFunction<
             ReprojectionError_CameraGroupAndObjectRef, 2, 6, 6, 6>(
         new ReprojectionError_CameraGroupAndObjectRef(
             u, v, x, y, z, focal_x, focal_y, u0, v0, k1, k2, k3, p1, p2,
-            refine_camera, refine_board, distortion_type)));
+            distortion_type)));
   }
 
   double u, v;
@@ -513,18 +494,18 @@ struct ReprojectionError_CameraGroupAndObjectRef {
   double k3;
   double p1;
   double p2;
-  bool refine_camera;
-  bool refine_board;
   int distortion_type;
 };
 
-// Refine camera group (3D object pose + relative camera pose + Board pose)
+// Refine camera group (3D object pose + relative camera pose + Board pose +
+// intrinsics). The poses of the reference camera and reference boards (and the
+// intrinsics if they are fixed) are kept constant in the problem
 struct ReprojectionError_CameraGroupAndObjectRefAndIntrinsics {
-  ReprojectionError_CameraGroupAndObjectRefAndIntrinsics(
-      double u, double v, double x, double y, double z, bool refine_camera,
-      bool refine_board, int distortion_type)
-      : u(u), v(v), x(x), y(y), z(z), refine_camera(refine_camera),
-        refine_board(refine_board), distortion_type(distortion_type) {}
+  ReprojectionError_CameraGroupAndObjectRefAndIntrinsics(double u, double v,
+                                                         double x, double y,
+                                                         double z,
+                                                         int distortion_type)
+      : u(u), v(v), x(x), y(y), z(z), distortion_type(distortion_type) {}
 
   template <typename T>
   bool operator()(const T *const camera, const T *const object_pose,
@@ -544,12 +525,10 @@ struct ReprojectionError_CameraGroupAndObjectRefAndIntrinsics {
 
     // 1. Apply the board transformation in teh object
     T point[3] = {T(x), T(y), T(z)};
-    if (refine_board != 0) {
-      ceres::AngleAxisRotatePoint(board_pose, point, point);
-      point[0] += board_pose[3];
-      point[1] += board_pose[4];
-      point[2] += board_pose[5];
-    }
+    ceres::AngleAxisRotatePoint(board_pose, point, point);
+    point[0] += board_pose[3];
+    point[1] += board_pose[4];
+    point[2] += board_pose[5];
 
     // 2. apply transformation to the object (to expressed in the current
     // camera)
@@ -559,13 +538,11 @@ struct ReprojectionError_CameraGroupAndObjectRefAndIntrinsics {
     pobj[1] += object_pose[4];
     pobj[2] += object_pose[5];
 
-    // 3. Refine the camera if it is not the referential
-    if (refine_camera != 0) {
-      ceres::AngleAxisRotatePoint(camera, pobj, pobj);
-      pobj[0] += camera[3];
-      pobj[1] += camera[4];
-      pobj[2] += camera[5];
-    }
+    // 3. apply the camera pose in the group
+    ceres::AngleAxisRotatePoint(camera, pobj, pobj);
+    pobj[0] += camera[3];
+    pobj[1] += camera[4];
+    pobj[2] += camera[5];
 
     // Normalization on the camera plane
     pobj[0] /= pobj[2];
@@ -636,120 +613,71 @@ struct ReprojectionError_CameraGroupAndObjectRefAndIntrinsics {
   // the client code.
   static ceres::CostFunction *Create(const double u, const double v,
                                      const double x, const double y,
-                                     const double z, const bool refine_camera,
-                                     const bool refine_board,
+                                     const double z,
                                      const int distortion_type) {
     return (new ceres::AutoDiffCostFunction<
             ReprojectionError_CameraGroupAndObjectRefAndIntrinsics, 2, 6, 6, 6,
             9>(new ReprojectionError_CameraGroupAndObjectRefAndIntrinsics(
-        u, v, x, y, z, refine_camera, refine_board, distortion_type)));
+        u, v, x, y, z, distortion_type)));
   }
 
   double u, v;
   double x;
   double y;
   double z;
-  bool refine_camera;
-  bool refine_board;
   int distortion_type;
 };
 
-/*
-template <typename T>
-Eigen::Matrix<T, 3, 3>
-AngleAxisToRotationMatrix(const Eigen::Matrix<T, 3, 1>& rvec) {
-    T angle = rvec.norm();
-    if (angle == T(0)) {
-        return Eigen::Matrix<T, 3, 3>::Identity();
-    }
-
-    Eigen::Matrix<T, 3, 1> axis;
-    axis = rvec.normalized();
-
-    Eigen::Matrix<T, 3, 3> rmat;
-    rmat = Eigen::AngleAxis<T>(angle, axis);
-
-    return rmat;
-}
-
-
-
-// Refine handeye calibration
+// Pose graph edge: relative transformation measured between two poses. The
+// rotation residuals are in radians, the translation residuals in the unit of
+// the scene scaled by translation_weight.
 struct TransformationError {
-  TransformationError(double r1_x, double r1_y, double r1_z, double t1_x, double
-t1_y, double t1_z, double r2_x, double r2_y, double r2_z, double t2_x, double
-t2_y, double t2_z) : r1_x(r1_x), r1_y(r1_y), r1_z(r1_z), t1_x(t1_x), t1_y(t1_y),
-t1_z(t1_z), r2_x(r2_x), r2_y(r2_y), r2_z(r2_z), t2_x(t2_x), t2_y(t2_y),
-t2_z(t2_z)  {}
+  TransformationError(const double *relative_pose, double translation_weight)
+      : translation_weight(translation_weight) {
+    for (int i = 0; i < 6; i++)
+      this->relative_pose[i] = relative_pose[i];
+  }
 
   template <typename T>
-  bool operator()(const T *const transform,
+  bool operator()(const T *const pose_1, const T *const pose_2,
                   T *residuals) const {
-
-    // 1. convert to rotation matrix for relative 1 and 2
-    Eigen::Matrix<double, 3, 1> r1, r2;
-    r1(0,0) = r1_x; r1(1,0) = r1_y; r1(2,0) = r1_z;
-    r2(0,0) = r2_x; r2(1,0) = r2_y; r2(2,0) = r2_z;
-    Eigen::Matrix<double, 3, 3> R1 = AngleAxisToRotationMatrix(r1);
-    Eigen::Matrix<double, 3, 3> R2 = AngleAxisToRotationMatrix(r2);
-    Eigen::Matrix<double, 3,1> t1, t2;
-    t1(0,0) = t1_x; t1(1,0) = t1_y; t1(2,0) = t1_z;
-    t2(0,0) = t2_x; t2(1,0) = t2_y; t2(2,0) = t2_z;
-
-    Eigen::Matrix4d Trans1; // Your Transformation Matrix
-    Trans1.setIdentity();   // Set to Identity to make bottom row of Matrix
-0,0,0,1 Trans1.block<3,3>(0,0) = R1; Trans1.block<3,1>(0,3) = t1;
-    Eigen::Matrix4d Trans2; // Your Transformation Matrix
-    Trans2.setIdentity();   // Set to Identity to make bottom row of Matrix
-0,0,0,1 Trans2.block<3,3>(0,0) = R2; Trans2.block<3,1>(0,3) = t2;
-
-    //2. convert the transform
-    Eigen::Matrix<T, 3, 1> rt;
-    Eigen::Matrix<T, 3,1> tt;
-    rt(0,0) = (transform[0]); rt(1,0) = (transform[1]); rt(2,0) =
-(transform[2]); Eigen::Matrix<T, 3, 3> Rt = AngleAxisToRotationMatrix(rt);
-    tt(0,0) = (transform[3]); tt(1,0) = (transform[4]); tt(2,0) =
-(transform[5]); Eigen::Matrix<T, 4,4> Trans; // Your Transformation Matrix
-    Trans(0,0) = Rt(0,0); Trans(0,1) = Rt(0,1); Trans(0,2) = Rt(0,2); Trans(0,3)
-= tt(0,0); Trans(1,0) = Rt(1,0); Trans(1,1) = Rt(1,1); Trans(1,2) = Rt(1,2);
-Trans(1,3) = tt(1,0); Trans(2,0) = Rt(2,0); Trans(2,1) = Rt(2,1); Trans(2,2) =
-Rt(2,2); Trans(2,3) = tt(2,0);
-
-    Eigen::Matrix4d Error = (Trans - Trans2*Trans*Trans1.inverse());
-    //r1.row(0) << r1_x, r1_y, r1_z;
-    //Map<Vector3f> r1; //(r11);
-
-
-    //AngleAxisToRotationMatrix(axis_angle, matrix);
-    // 2. convert the "transform" ro rotation matrix
-
-    // 2. Compute errors matrix
-    residuals[0] = T(Error(0,0));
-    residuals[1] = T(Error(1,0));
-    residuals[2] = T(Error(2,0));
-    residuals[3] = T(Error(3,0));
-    residuals[4] = T(Error(0,1));
-    residuals[5] = T(Error(1,1));
-    residuals[6] = T(Error(2,1));
-    residuals[7] = T(Error(3,1));
-    residuals[8] = T(Error(0,2));
-    residuals[9] = T(Error(1,2));
-    residuals[10] = T(Error(2,2));
-    residuals[11] = T(Error(3,2));
-
+    // pose_1 composed with the relative pose predicts pose_2
+    const T relative_rot[3] = {T(relative_pose[0]), T(relative_pose[1]),
+                               T(relative_pose[2])};
+    const T relative_trans[3] = {T(relative_pose[3]), T(relative_pose[4]),
+                                 T(relative_pose[5])};
+    T q_1[4], q_relative[4], q_2[4], q_predicted[4];
+    ceres::AngleAxisToQuaternion(pose_1, q_1);
+    ceres::AngleAxisToQuaternion(relative_rot, q_relative);
+    ceres::AngleAxisToQuaternion(pose_2, q_2);
+    ceres::QuaternionProduct(q_1, q_relative, q_predicted);
+
+    // rotation error: predicted rotation^-1 * rotation of pose_2
+    const T q_predicted_inv[4] = {q_predicted[0], -q_predicted[1],
+                                  -q_predicted[2], -q_predicted[3]};
+    T q_error[4];
+    ceres::QuaternionProduct(q_predicted_inv, q_2, q_error);
+    ceres::QuaternionToAngleAxis(q_error, residuals);
+
+    // translation error
+    T t_predicted[3];
+    ceres::AngleAxisRotatePoint(pose_1, relative_trans, t_predicted);
+    for (int i = 0; i < 3; i++)
+      residuals[3 + i] = T(translation_weight) *
+                         (pose_2[3 + i] - (t_predicted[i] + pose_1[3 + i]));
     return true;
   }
 
-  static ceres::CostFunction *Create(const double r1_x, const double r1_y, const
-double r1_z, const double t1_x, const double t1_y, const double t1_z, const
-double r2_x, const double r2_y, const double r2_z, const double t2_x, const
-double t2_y, const double t2_z) { return (new
-ceres::AutoDiffCostFunction<TransformationError, 12, 6>( new
-TransformationError(r1_x, r1_y, r1_z, t1_x, t1_y, t1_z, r2_x, r2_y, r2_z, t2_x,
-t2_y, t2_z)));
+  // Factory to hide the construction of the CostFunction object from
+  // the client code.
+  static ceres::CostFunction *Create(const double *relative_pose,
+                                     const double translation_weight) {
+    return (new ceres::AutoDiffCostFunction<TransformationError, 6, 6, 6>(
+        new TransformationError(relative_pose, translation_weight)));
   }
-  double r1_x, r1_y, r1_z;
-  double t1_x, t1_y, t1_z;
-  double r2_x, r2_y, r2_z;
-  double t2_x, t2_y, t2_z;
-};*/
\ No newline at end of file
+
+  double relative_pose[6]; // Rodrigues rotation vector and translation
+  double translation_weight;
+};
+
+#endif // OPTIMIZATIONCERES_H
@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "ParameterArena.hpp"
+#include "logger.h"
+
+/**
+ * @brief Create an empty arena
+ *
+ * @param chunk_size number of doubles allocated at once for a block type
+ */
+ParameterArena::ParameterArena(int chunk_size)
+    : chunk_size_(std::max(chunk_size, 1)) {}
+
+/**
+ * @brief Allocate a new parameter block (initialized to zero)
+ *
+ * @param type type of the block, the blocks of the same type are contiguous
+ * @param block_size number of doubles in the block
+ *
+ * @return pointer to the block, valid as long as the arena exists
+ */
+double *ParameterArena::allocate(BlockType type, int block_size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Pool &pool = pools_[type];
+  if (pool.chunks.empty() ||
+      pool.chunk_used + block_size > pool.chunk_sizes.back()) {
+    int new_chunk_size = std::max(chunk_size_, block_size);
+    pool.chunks.emplace_back(new double[new_chunk_size]());
+    pool.chunk_sizes.push_back(new_chunk_size);
+    pool.chunk_used = 0;
+  }
+  double *block = pool.chunks.back().get() + pool.chunk_used;
+  pool.chunk_used += block_size;
+  pool.nb_blocks++;
+  pool.nb_used += block_size;
+  return block;
+}
+
+/**
+ * @brief Get the number of blocks allocated for a type
+ *
+ * @param type type of the blocks
+ *
+ * @return number of blocks
+ */
+int ParameterArena::getNbBlocks(BlockType type) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return pools_[type].nb_blocks;
+}
+
+/**
+ * @brief Get the memory used by the blocks of a type
+ *
+ * @param type type of the blocks
+ *
+ * @return used memory in bytes
+ */
+size_t ParameterArena::getUsedBytes(BlockType type) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return pools_[type].nb_used * sizeof(double);
+}
+
+/**
+ * @brief Get the memory reserved (allocated chunks) for a type
+ *
+ * @param type type of the blocks
+ *
+ * @return reserved memory in bytes
+ */
+size_t ParameterArena::getReservedBytes(BlockType type) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  size_t nb_reserved = 0;
+  for (int chunk_size : pools_[type].chunk_sizes)
+    nb_reserved += chunk_size;
+  return nb_reserved * sizeof(double);
+}
+
+/**
+ * @brief Log the number of blocks and the memory used per block type
+ *
+ */
+void ParameterArena::logMemoryReport() {
+  size_t total_used = 0, total_reserved = 0;
+  for (int i = 0; i < NbBlockTypes; i++) {
+    BlockType type = static_cast<BlockType>(i);
+    size_t used = getUsedBytes(type);
+    size_t reserved = getReservedBytes(type);
+    total_used += used;
+    total_reserved += reserved;
+    LOG_INFO << "Parameter blocks " << getBlockTypeName(type) << " :: "
+             << getNbBlocks(type) << " blocks, " << used << " bytes used, "
+             << reserved << " bytes reserved";
+  }
+  LOG_INFO << "Parameter blocks total :: " << total_used << " bytes used, "
+           << total_reserved << " bytes reserved";
+}
+
+/**
+ * @brief Get the name of a block type for the report
+ *
+ * @param type type of the blocks
+ *
+ * @return name of the type
+ */
+std::string ParameterArena::getBlockTypeName(BlockType type) {
+  switch (type) {
+  case CameraIntrinsics:
+    return "camera_intrinsics";
+  case BoardPose:
+    return "board_pose";
+  case ObjectPose:
+    return "object_pose";
+  case ObjectGroupPose:
+    return "object_group_pose";
+  case RelativeCameraPose:
+    return "relative_camera_pose";
+  case RelativeBoardPose:
+    return "relative_board_pose";
+  case GroupObjectPose:
+    return "group_object_pose";
+  default:
+    return "unknown";
+  }
+}
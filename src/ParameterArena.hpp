@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class ParameterArena
+ *
+ * @brief Storage of the parameter blocks (poses and intrinsics) refined by
+ * Ceres
+ *
+ * The blocks of each type are allocated contiguously in large chunks which are
+ * never reallocated, therefore the pointers handed to Ceres stay valid until
+ * the arena is destroyed. All the blocks are freed at once with the arena.
+ */
+class ParameterArena {
+public:
+  // Type of the parameter blocks
+  enum BlockType {
+    CameraIntrinsics = 0, // Camera::intrinsics_
+    BoardPose,            // BoardObs::pose_
+    ObjectPose,           // Object3DObs::pose_
+    ObjectGroupPose,      // Object3DObs::group_pose_
+    RelativeCameraPose,   // CameraGroup::relative_camera_pose_
+    RelativeBoardPose,    // Object3D::relative_board_pose_
+    GroupObjectPose,      // CameraGroupObs::object_pose_
+    NbBlockTypes
+  };
+
+  // Functions
+  ParameterArena(int chunk_size = 4096);
+  double *allocate(BlockType type, int block_size);
+  int getNbBlocks(BlockType type);
+  size_t getUsedBytes(BlockType type);
+  size_t getReservedBytes(BlockType type);
+  void logMemoryReport();
+
+private:
+  // Chunks of one block type
+  struct Pool {
+    std::vector<std::unique_ptr<double[]>> chunks; // allocated chunks
+    std::vector<int> chunk_sizes;                  // doubles per chunk
+    int chunk_used = 0;                            // used in the last chunk
+    int nb_blocks = 0;                             // blocks handed out
+    size_t nb_used = 0;                            // doubles handed out
+  };
+
+  int chunk_size_;                       // default size of a chunk (doubles)
+  std::array<Pool, NbBlockTypes> pools_; // one pool per block type
+  std::mutex mutex_;                     // blocks can be allocated in parallel
+
+  static std::string getBlockTypeName(BlockType type);
+};
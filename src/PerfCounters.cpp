@@ -0,0 +1,178 @@
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "PerfCounters.hpp"
+#include "StageProfiler.hpp"
+#include "logger.h"
+
+namespace {
+/**
+ * @brief Counters opened by one thread, closed when the thread exits
+ */
+struct ThreadCounters {
+  bool opened = false; // true once the thread tried to open its counters
+  int error = 0;        // errno of the cycles counter opening
+  std::array<int, PerfCounters::NbCounters> fd{{-1, -1, -1, -1}};
+
+  ~ThreadCounters() {
+#ifdef __linux__
+    for (const int &counter_fd : fd)
+      if (counter_fd >= 0)
+        close(counter_fd);
+#endif
+  }
+
+  /**
+   * @brief Open the counters of the thread (only once)
+   *
+   * @return true if the cycles can be counted
+   */
+  bool open() {
+    if (opened)
+      return fd[PerfCounters::Cycles] >= 0;
+    opened = true;
+#ifdef __linux__
+    const unsigned long long configs[PerfCounters::NbCounters] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int counter = 0; counter < PerfCounters::NbCounters; counter++) {
+      struct perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[counter];
+      attr.exclude_kernel = 1; // allowed with perf_event_paranoid <= 2
+      attr.exclude_hv = 1;
+      // pid = 0, cpu = -1: the calling thread on any CPU
+      fd[counter] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+      if (fd[counter] < 0 && counter == PerfCounters::Cycles)
+        error = errno;
+    }
+#else
+    error = ENOSYS;
+#endif
+    return fd[PerfCounters::Cycles] >= 0;
+  }
+};
+
+thread_local ThreadCounters thread_counters;
+} // namespace
+
+/**
+ * @brief Get the global counter collector
+ *
+ * @return collector shared by all the threads
+ */
+PerfCounters &PerfCounters::get() {
+  static PerfCounters counters;
+  return counters;
+}
+
+/**
+ * @brief Enable the counters if the platform provides them
+ *
+ * @return true if the counters are enabled
+ */
+bool PerfCounters::enable() {
+  if (!thread_counters.open()) {
+    LOG_WARNING << "Hardware performance counters are not available ("
+                << std::strerror(thread_counters.error)
+                << "), they are not recorded";
+    enabled_.store(false);
+    return false;
+  }
+  enabled_.store(true);
+  return true;
+}
+
+/**
+ * @brief Disable the counters, the scopes do not read them anymore
+ *
+ */
+void PerfCounters::disable() { enabled_.store(false); }
+
+/**
+ * @brief Read the counters of the calling thread
+ *
+ * @param values counters since the opening (-1 if a counter is missing)
+ *
+ * @return false if the counters are disabled or cannot be opened
+ */
+bool PerfCounters::read(Values &values) {
+  values.fill(-1);
+  if (!isEnabled() || !thread_counters.open())
+    return false;
+#ifdef __linux__
+  for (int counter = 0; counter < NbCounters; counter++) {
+    long long count;
+    if (thread_counters.fd[counter] >= 0 &&
+        ::read(thread_counters.fd[counter], &count, sizeof(count)) ==
+            sizeof(count))
+      values[counter] = count;
+  }
+#endif
+  return values[Cycles] >= 0;
+}
+
+/**
+ * @brief Get the counts between two readings
+ *
+ * @param end last reading
+ * @param start first reading
+ *
+ * @return difference of the counters (-1 if missing in one of the readings)
+ */
+PerfCounters::Values PerfCounters::difference(const Values &end,
+                                              const Values &start) {
+  Values values;
+  for (int counter = 0; counter < NbCounters; counter++)
+    values[counter] = (end[counter] >= 0 && start[counter] >= 0)
+                          ? end[counter] - start[counter]
+                          : -1;
+  return values;
+}
+
+/**
+ * @brief Get the name of a counter used in the reports
+ *
+ * @param counter type of the counter
+ *
+ * @return name of the counter
+ */
+const char *PerfCounters::getCounterName(int counter) {
+  static const char *names[NbCounters] = {"cycles", "instructions",
+                                          "cache_misses", "branch_misses"};
+  return names[counter];
+}
+
+/**
+ * @brief Read the time and the counters at the beginning of the kernel
+ *
+ * @param kernel name of the kernel
+ */
+PerfScope::PerfScope(const char *kernel)
+    : kernel_(kernel), active_(PerfCounters::get().isEnabled()),
+      wall_start_(std::chrono::steady_clock::now()) {
+  if (active_)
+    active_ = PerfCounters::get().read(start_);
+}
+
+/**
+ * @brief Add the time and the counts of the kernel to the current stage
+ *
+ */
+PerfScope::~PerfScope() {
+  PerfCounters::Values counts{{-1, -1, -1, -1}};
+  PerfCounters::Values end;
+  if (active_ && PerfCounters::get().read(end))
+    counts = PerfCounters::difference(end, start_);
+  std::chrono::duration<double> wall_time =
+      std::chrono::steady_clock::now() - wall_start_;
+  StageReport::get().addKernel(kernel_, counts, wall_time.count());
+}
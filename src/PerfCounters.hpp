@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+/**
+ * @class PerfCounters
+ *
+ * @brief Hardware performance counters (cycles, instructions, cache misses and
+ * branch misses) of the calling thread
+ *
+ * The counters are read with the Linux perf_event_open interface. Each thread
+ * opens its own counters the first time it reads them. When the counters are
+ * not available (other platforms, virtual machines, restrictive
+ * perf_event_paranoid), the collector stays disabled and costs nothing.
+ */
+class PerfCounters {
+public:
+  // Type of the counters
+  enum Counter {
+    Cycles = 0,   // CPU cycles
+    Instructions, // retired instructions
+    CacheMisses,  // last level cache misses
+    BranchMisses, // mispredicted branches
+    NbCounters
+  };
+  typedef std::array<long, NbCounters> Values; // -1 if the counter is missing
+
+  // Functions
+  static PerfCounters &get();
+  bool enable();
+  void disable();
+  bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+  bool read(Values &values);
+  static Values difference(const Values &end, const Values &start);
+  static const char *getCounterName(int counter);
+
+private:
+  PerfCounters(){};
+  std::atomic<bool> enabled_{false}; // checked by every PerfScope
+};
+
+/**
+ * @class PerfScope
+ *
+ * @brief Count the events of a kernel (detection, RANSAC, solve...) until the
+ * scope is destroyed
+ *
+ *   {
+ *     PerfScope perf("ransac_p3p");
+ *     ...
+ *   }
+ *
+ * The duration of the call and, when the hardware counters are enabled, the
+ * counters of the calling thread are added to the kernel in the current stage
+ * of the StageReport.
+ */
+class PerfScope {
+public:
+  // Functions
+  PerfScope(const char *kernel);
+  ~PerfScope();
+
+private:
+  const char *kernel_;         // name of the kernel
+  bool active_;                // true if the counters were read at creation
+  PerfCounters::Values start_; // counters at the creation
+  std::chrono::steady_clock::time_point wall_start_; // time at the creation
+};
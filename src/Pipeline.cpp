@@ -0,0 +1,194 @@
+#include "Pipeline.hpp"
+#include "StageProfiler.hpp"
+#include "logger.h"
+
+/**
+ * @brief Create an empty pipeline
+ *
+ * @param thread_pool threads running the concurrent stages
+ */
+Pipeline::Pipeline(std::shared_ptr<ThreadPool> thread_pool)
+    : thread_pool_(thread_pool) {}
+
+/**
+ * @brief Add a stage to the pipeline
+ *
+ * @param name name of the stage
+ * @param job work of the stage
+ * @param dependencies index of the stages to be done before this one (they
+ * must have been added before)
+ *
+ * @return index of the stage (-1 if a dependency is unknown)
+ */
+int Pipeline::addStage(std::string name, std::function<void()> job,
+                       std::vector<int> dependencies) {
+  const int stage_idx = stages_.size();
+  for (const int &dependency : dependencies) {
+    if (dependency < 0 || dependency >= stage_idx) {
+      LOG_ERROR << "Stage " << name << " depends on an unknown stage "
+                << dependency;
+      return -1;
+    }
+  }
+
+  Stage stage;
+  stage.name = name;
+  stage.job = job;
+  stage.dependencies = dependencies;
+  stages_.push_back(stage);
+  for (const int &dependency : dependencies)
+    stages_[dependency].dependents.push_back(stage_idx);
+  return stage_idx;
+}
+
+/**
+ * @brief Set the function counting the objects recorded in the profile of
+ * each stage
+ *
+ * @param counts function returning the object counts
+ */
+void Pipeline::setStageCounts(
+    std::function<std::map<std::string, long>()> counts) {
+  counts_ = counts;
+}
+
+/**
+ * @brief Set the function called with the thread budget of each stage when
+ * it starts
+ *
+ * The concurrent stages share the value set by the last one started, which
+ * is a budget of an overlapping stage.
+ *
+ * @param set_threads function setting a global number of threads
+ */
+void Pipeline::setStageThreads(std::function<void(int)> set_threads) {
+  set_threads_ = set_threads;
+}
+
+/**
+ * @brief Get the number of stages of the pipeline
+ *
+ * @return number of stages
+ */
+int Pipeline::getNbStages() const { return stages_.size(); }
+
+/**
+ * @brief Find the stages which must be done before each stage
+ *
+ * @return ancestors[i][j] is true if the stage j is a direct or indirect
+ * dependency of the stage i
+ */
+std::vector<std::vector<char>> Pipeline::findAncestors() const {
+  const int nb_stages = stages_.size();
+  std::vector<std::vector<char>> ancestors(nb_stages,
+                                           std::vector<char>(nb_stages, 0));
+  // the dependencies are added before their dependents
+  for (int stage_idx = 0; stage_idx < nb_stages; stage_idx++) {
+    for (const int &dependency : stages_[stage_idx].dependencies) {
+      ancestors[stage_idx][dependency] = 1;
+      for (int i = 0; i < dependency; i++)
+        if (ancestors[dependency][i])
+          ancestors[stage_idx][i] = 1;
+    }
+  }
+  return ancestors;
+}
+
+/**
+ * @brief Run and profile one stage
+ *
+ * @param stage_idx index of the stage
+ */
+void Pipeline::runStage(int stage_idx) {
+  const int nb_overlaps = nb_overlaps_[stage_idx];
+  ThreadBudget budget(thread_pool_->getNbThreads() / (1 + nb_overlaps));
+  if (set_threads_)
+    set_threads_(ThreadPool::getThreadBudget());
+  StageProfiler profiler(stages_[stage_idx].name,
+                         nb_overlaps == 0
+                             ? counts_
+                             : std::function<std::map<std::string, long>()>(),
+                         thread_pool_.get());
+  stages_[stage_idx].job();
+}
+
+/**
+ * @brief Run all the stages of the pipeline and wait for their completion
+ *
+ * In serial mode, the stages run one after the other on the calling thread in
+ * their insertion order. Otherwise the thread finishing a stage continues with
+ * one of the stages it made ready and submits the others to the pool.
+ *
+ * @param serial true to run the stages in their insertion order
+ */
+void Pipeline::run(bool serial) {
+  const int nb_stages = stages_.size();
+  nb_overlaps_.assign(nb_stages, 0);
+  if (serial || thread_pool_->getNbThreads() == 1) {
+    for (int stage_idx = 0; stage_idx < nb_stages; stage_idx++)
+      runStage(stage_idx);
+    return;
+  }
+
+  // The stages neither before nor after a stage can run at the same time
+  std::vector<std::vector<char>> ancestors = findAncestors();
+  for (int stage_idx = 0; stage_idx < nb_stages; stage_idx++)
+    for (int other_idx = 0; other_idx < nb_stages; other_idx++)
+      if (other_idx != stage_idx && !ancestors[stage_idx][other_idx] &&
+          !ancestors[other_idx][stage_idx])
+        nb_overlaps_[stage_idx]++;
+
+  std::shared_ptr<RunState> state = std::make_shared<RunState>();
+  state->nb_missing.resize(nb_stages);
+  std::vector<int> ready;
+  for (int stage_idx = 0; stage_idx < nb_stages; stage_idx++) {
+    state->nb_missing[stage_idx] = stages_[stage_idx].dependencies.size();
+    if (state->nb_missing[stage_idx] == 0)
+      ready.push_back(stage_idx);
+  }
+
+  for (size_t i = 1; i < ready.size(); i++) {
+    const int next_stage = ready[i];
+    thread_pool_->submit(
+        [this, state, next_stage]() { runFrom(state, next_stage); });
+  }
+  if (!ready.empty())
+    runFrom(state, ready[0]);
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->all_done.wait(lock, [&] { return state->nb_done == nb_stages; });
+}
+
+/**
+ * @brief Run a stage, then one of the stages it made ready (the others are
+ * submitted to the pool), until no stage is made ready
+ *
+ * The pipeline is not accessed anymore once the last stage is counted as
+ * done, since run can then return.
+ *
+ * @param state progress of the run
+ * @param stage_idx index of the first stage to run
+ */
+void Pipeline::runFrom(std::shared_ptr<RunState> state, int stage_idx) {
+  const int nb_stages = stages_.size();
+  while (stage_idx >= 0) {
+    runStage(stage_idx);
+    std::vector<int> new_ready;
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      for (const int &dependent : stages_[stage_idx].dependents)
+        if (--state->nb_missing[dependent] == 0)
+          new_ready.push_back(dependent);
+      if (++state->nb_done == nb_stages) {
+        state->all_done.notify_all();
+        return;
+      }
+    }
+    for (size_t i = 1; i < new_ready.size(); i++) {
+      const int next_stage = new_ready[i];
+      thread_pool_->submit(
+          [this, state, next_stage]() { runFrom(state, next_stage); });
+    }
+    stage_idx = new_ready.empty() ? -1 : new_ready[0];
+  }
+}
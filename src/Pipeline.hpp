@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+/**
+ * @class Pipeline
+ *
+ * @brief Stages of the calibration and their dependencies
+ *
+ * The stages form a directed acyclic graph: a stage can only depend on the
+ * stages added before it, so the insertion order is a valid serial order. In
+ * concurrent mode, a stage starts as soon as all its dependencies are done and
+ * the independent stages run on the threads of the pool. Every stage is
+ * profiled with a StageProfiler. The object counts are only recorded for the
+ * stages which cannot overlap another one (all the other stages are either
+ * dependencies or dependents of the stage), since the stages running
+ * concurrently modify the counted data structures. The threads of the pool
+ * are shared between the stages which can overlap: a stage has a thread
+ * budget (ThreadBudget) of nb_threads / (1 + number of stages it can
+ * overlap), at least 1. The libraries with a global number of threads
+ * (OpenCV) are given the budget of each stage when it starts
+ * (setStageThreads).
+ */
+class Pipeline {
+public:
+  // Functions
+  Pipeline(std::shared_ptr<ThreadPool> thread_pool);
+  int addStage(std::string name, std::function<void()> job,
+               std::vector<int> dependencies = std::vector<int>());
+  void setStageCounts(std::function<std::map<std::string, long>()> counts);
+  void setStageThreads(std::function<void(int)> set_threads);
+  int getNbStages() const;
+  void run(bool serial);
+
+private:
+  // One stage of the pipeline
+  struct Stage {
+    std::string name;              // name of the stage (used in the profile)
+    std::function<void()> job;     // work of the stage
+    std::vector<int> dependencies; // stages to be done before this one
+    std::vector<int> dependents;   // stages waiting for this one
+  };
+
+  std::shared_ptr<ThreadPool> thread_pool_; // threads running the stages
+  std::vector<Stage> stages_;               // stages in insertion order
+  std::function<std::map<std::string, long>()> counts_; // object counts
+  std::function<void(int)> set_threads_; // called with the budget of a stage
+  std::vector<int> nb_overlaps_; // stages which can run with each stage
+
+  // Progress of a concurrent run, owned by the tasks running the stages (a
+  // task can still be unwinding when run returns)
+  struct RunState {
+    std::mutex mutex;                 // protect the progress
+    std::condition_variable all_done; // notified when all the stages are done
+    int nb_done = 0;                  // stages done
+    std::vector<int> nb_missing;      // dependencies not done yet per stage
+  };
+
+  std::vector<std::vector<char>> findAncestors() const;
+  void runStage(int stage_idx);
+  void runFrom(std::shared_ptr<RunState> state, int stage_idx);
+};
@@ -0,0 +1,199 @@
+#include <cmath>
+#include <limits>
+
+#include "Pose.hpp"
+
+/**
+ * @brief Create the identity pose
+ *
+ */
+Pose::Pose()
+    : rotation_(Eigen::Matrix3d::Identity()),
+      translation_(Eigen::Vector3d::Zero()) {}
+
+/**
+ * @brief Create a pose from a rotation matrix and a translation vector
+ *
+ * @param rotation 3x3 rotation matrix
+ * @param translation translation vector
+ */
+Pose::Pose(const Eigen::Matrix3d &rotation, const Eigen::Vector3d &translation)
+    : rotation_(rotation), translation_(translation) {}
+
+/**
+ * @brief Create a pose from a parameter block
+ *
+ * @param block 6 doubles (Rodrigues rotation vector, translation vector)
+ *
+ * @return pose of the block
+ */
+Pose Pose::fromBlock(const double *block) {
+  return fromRotVec(Eigen::Vector3d(block[0], block[1], block[2]),
+                    Eigen::Vector3d(block[3], block[4], block[5]));
+}
+
+/**
+ * @brief Create a pose from Rodrigues rotation and translation vectors
+ *
+ * @param r_vec Rodrigues rotation vector
+ * @param t_vec translation vector
+ *
+ * @return pose of the vectors
+ */
+Pose Pose::fromRotVec(const Eigen::Vector3d &r_vec,
+                      const Eigen::Vector3d &t_vec) {
+  double angle = r_vec.norm();
+  Eigen::Matrix3d rotation;
+  if (angle > std::numeric_limits<double>::epsilon()) {
+    rotation = Eigen::AngleAxisd(angle, r_vec / angle).toRotationMatrix();
+  } else {
+    // first order approximation for small rotations
+    rotation << 1, -r_vec(2), r_vec(1), r_vec(2), 1, -r_vec(0), -r_vec(1),
+        r_vec(0), 1;
+  }
+  return Pose(rotation, t_vec);
+}
+
+/**
+ * @brief Create a pose from a 4x4 pose matrix
+ *
+ * @param pose 4x4 pose matrix
+ *
+ * @return pose of the matrix
+ */
+Pose Pose::fromMat(cv::Mat pose) {
+  cv::Mat pose_d;
+  pose.convertTo(pose_d, CV_64F);
+  Pose out;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++)
+      out.rotation_(i, j) = pose_d.at<double>(i, j);
+    out.translation_(i) = pose_d.at<double>(i, 3);
+  }
+  return out;
+}
+
+/**
+ * @brief Create a pose from OpenCV rotation and translation vectors
+ *
+ * @param r_vec Rodrigues rotation vector (1x3 or 3x1)
+ * @param t_vec translation vector (1x3 or 3x1)
+ *
+ * @return pose of the vectors
+ */
+Pose Pose::fromRVecT(cv::Mat r_vec, cv::Mat t_vec) {
+  cv::Mat r_vec_d, t_vec_d;
+  r_vec.convertTo(r_vec_d, CV_64F);
+  t_vec.convertTo(t_vec_d, CV_64F);
+  return fromRotVec(Eigen::Vector3d(r_vec_d.at<double>(0),
+                                    r_vec_d.at<double>(1),
+                                    r_vec_d.at<double>(2)),
+                    Eigen::Vector3d(t_vec_d.at<double>(0),
+                                    t_vec_d.at<double>(1),
+                                    t_vec_d.at<double>(2)));
+}
+
+/**
+ * @brief Write the pose in a parameter block
+ *
+ * @param block 6 doubles (Rodrigues rotation vector, translation vector)
+ */
+void Pose::toBlock(double *block) const {
+  Eigen::Vector3d r_vec = getRotVec();
+  block[0] = r_vec(0);
+  block[1] = r_vec(1);
+  block[2] = r_vec(2);
+  block[3] = translation_(0);
+  block[4] = translation_(1);
+  block[5] = translation_(2);
+}
+
+/**
+ * @brief Get the Rodrigues rotation vector of the pose
+ *
+ * @return Rodrigues rotation vector
+ */
+Eigen::Vector3d Pose::getRotVec() const {
+  Eigen::AngleAxisd angle_axis(rotation_);
+  return angle_axis.angle() * angle_axis.axis();
+}
+
+/**
+ * @brief Convert the pose to a 4x4 pose matrix
+ *
+ * @return 4x4 pose matrix
+ */
+cv::Mat Pose::toMat() const {
+  cv::Mat pose = cv::Mat::eye(4, 4, CV_64F);
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++)
+      pose.at<double>(i, j) = rotation_(i, j);
+    pose.at<double>(i, 3) = translation_(i);
+  }
+  return pose;
+}
+
+/**
+ * @brief Get the Rodrigues rotation vector as an OpenCV vector
+ *
+ * @return 3x1 Rodrigues rotation vector
+ */
+cv::Mat Pose::getRotVecMat() const {
+  Eigen::Vector3d r_vec = getRotVec();
+  return (cv::Mat_<double>(3, 1) << r_vec(0), r_vec(1), r_vec(2));
+}
+
+/**
+ * @brief Get the translation vector as an OpenCV vector
+ *
+ * @return 3x1 translation vector
+ */
+cv::Mat Pose::getTransVecMat() const {
+  return (cv::Mat_<double>(3, 1) << translation_(0), translation_(1),
+          translation_(2));
+}
+
+/**
+ * @brief Invert the transformation
+ *
+ * @return inverse pose
+ */
+Pose Pose::inverse() const {
+  Eigen::Matrix3d rotation_inv = rotation_.transpose();
+  return Pose(rotation_inv, -rotation_inv * translation_);
+}
+
+/**
+ * @brief Compose two transformations (same order as the 4x4 matrix product)
+ *
+ * @param other pose applied first
+ *
+ * @return composed pose
+ */
+Pose Pose::operator*(const Pose &other) const {
+  return Pose(rotation_ * other.rotation_,
+              rotation_ * other.translation_ + translation_);
+}
+
+/**
+ * @brief Transform a 3D point
+ *
+ * @param pt 3D point
+ *
+ * @return transformed point
+ */
+Eigen::Vector3d Pose::operator*(const Eigen::Vector3d &pt) const {
+  return rotation_ * pt + translation_;
+}
+
+/**
+ * @brief Transform an OpenCV 3D point
+ *
+ * @param pt 3D point
+ *
+ * @return transformed point
+ */
+cv::Point3f Pose::operator*(const cv::Point3f &pt) const {
+  Eigen::Vector3d pt_trans = *this * Eigen::Vector3d(pt.x, pt.y, pt.z);
+  return cv::Point3f(pt_trans(0), pt_trans(1), pt_trans(2));
+}
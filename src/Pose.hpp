@@ -0,0 +1,41 @@
+#pragma once
+
+#include "opencv2/core/core.hpp"
+#include <eigen3/Eigen/Dense>
+#include <iostream>
+#include <stdio.h>
+
+/**
+ * @class Pose
+ *
+ * @brief Rigid transformation (SE3) stored on the stack
+ *
+ * The pose maps a point "p" to "rotation_ * p + translation_" and follows the
+ * convention of the 4x4 pose matrices of the toolbox. The parameter blocks
+ * refined by Ceres store the same transformation as 6 doubles (Rodrigues
+ * rotation vector, translation vector). The cv::Mat conversions are only meant
+ * for the I/O boundaries (OpenCV functions, saving the results).
+ */
+class Pose {
+public:
+  Eigen::Matrix3d rotation_;    // rotation matrix
+  Eigen::Vector3d translation_; // translation vector
+
+  // Functions
+  Pose();
+  Pose(const Eigen::Matrix3d &rotation, const Eigen::Vector3d &translation);
+  static Pose fromBlock(const double *block);
+  static Pose fromRotVec(const Eigen::Vector3d &r_vec,
+                         const Eigen::Vector3d &t_vec);
+  static Pose fromMat(cv::Mat pose);
+  static Pose fromRVecT(cv::Mat r_vec, cv::Mat t_vec);
+  void toBlock(double *block) const;
+  Eigen::Vector3d getRotVec() const;
+  cv::Mat toMat() const;
+  cv::Mat getRotVecMat() const;
+  cv::Mat getTransVecMat() const;
+  Pose inverse() const;
+  Pose operator*(const Pose &other) const;
+  Eigen::Vector3d operator*(const Eigen::Vector3d &pt) const;
+  cv::Point3f operator*(const cv::Point3f &pt) const;
+};
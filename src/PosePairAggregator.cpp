@@ -0,0 +1,200 @@
+#include <algorithm>
+
+#include "PosePairAggregator.hpp"
+
+/**
+ * @brief Create an empty aggregator
+ *
+ * @param capacity maximum number of poses kept to compute the average
+ */
+PosePairAggregator::PosePairAggregator(int capacity)
+    : capacity_(capacity), nb_poses_(0), generator_(1) {}
+
+/**
+ * @brief Add a measurement of the relative pose
+ *
+ * Reservoir sampling: the first "capacity" poses are kept, then the new pose
+ * replaces a random kept pose with probability capacity / nb_poses.
+ *
+ * @param pose measured relative pose
+ */
+void PosePairAggregator::addPose(const Pose &pose) {
+  nb_poses_++;
+  int slot = nb_poses_ - 1;
+  if (slot >= capacity_) {
+    slot = std::uniform_int_distribution<int>(0, nb_poses_ - 1)(generator_);
+    if (slot >= capacity_)
+      return;
+  }
+
+  Eigen::Quaterniond rotation(pose.rotation_);
+  if (slot == rotations_.size()) {
+    rotations_.push_back(rotation);
+    translations_.push_back(pose.translation_);
+  } else {
+    rotations_[slot] = rotation;
+    translations_[slot] = pose.translation_;
+  }
+}
+
+/**
+ * @brief Add the measurements of another aggregator
+ *
+ * The merged reservoir is a sample of the union of the two streams: each slot
+ * is drawn from one of the two reservoirs with a probability proportional to
+ * the number of poses it represents. The result only depends on the order of
+ * the merges, not on the threads which filled the aggregators.
+ *
+ * @param other aggregator of the same pair
+ */
+void PosePairAggregator::merge(const PosePairAggregator &other) {
+  if (other.nb_poses_ == 0)
+    return;
+
+  // Every pose of both streams is kept
+  if (nb_poses_ + other.nb_poses_ <= capacity_) {
+    rotations_.insert(rotations_.end(), other.rotations_.begin(),
+                      other.rotations_.end());
+    translations_.insert(translations_.end(), other.translations_.begin(),
+                         other.translations_.end());
+    nb_poses_ += other.nb_poses_;
+    return;
+  }
+
+  // Draw the slots from the two reservoirs in a random order
+  std::vector<int> order_1(rotations_.size()), order_2(other.rotations_.size());
+  for (int i = 0; i < order_1.size(); i++)
+    order_1[i] = i;
+  for (int i = 0; i < order_2.size(); i++)
+    order_2[i] = i;
+  std::shuffle(order_1.begin(), order_1.end(), generator_);
+  std::shuffle(order_2.begin(), order_2.end(), generator_);
+
+  std::vector<Eigen::Quaterniond, Eigen::aligned_allocator<Eigen::Quaterniond>>
+      rotations;
+  std::vector<Eigen::Vector3d> translations;
+  const int nb_slots =
+      std::min<int>(capacity_, order_1.size() + order_2.size());
+  rotations.reserve(nb_slots);
+  translations.reserve(nb_slots);
+  int next_1 = 0, next_2 = 0;
+  std::uniform_int_distribution<int> stream(0,
+                                            nb_poses_ + other.nb_poses_ - 1);
+  for (int slot = 0; slot < nb_slots; slot++) {
+    bool from_first = stream(generator_) < nb_poses_;
+    if (next_1 == order_1.size())
+      from_first = false;
+    if (next_2 == order_2.size())
+      from_first = true;
+    if (from_first) {
+      rotations.push_back(rotations_[order_1[next_1]]);
+      translations.push_back(translations_[order_1[next_1++]]);
+    } else {
+      rotations.push_back(other.rotations_[order_2[next_2]]);
+      translations.push_back(other.translations_[order_2[next_2++]]);
+    }
+  }
+  rotations_.swap(rotations);
+  translations_.swap(translations);
+  nb_poses_ += other.nb_poses_;
+}
+
+/**
+ * @brief Number of measurements added to the aggregator
+ */
+int PosePairAggregator::getNbPoses() const { return nb_poses_; }
+
+/**
+ * @brief Robust average of the measured poses
+ *
+ * @return average pose (identity if no pose has been added)
+ */
+Pose PosePairAggregator::getAveragePose() const {
+  if (rotations_.empty())
+    return Pose();
+  return Pose(averageRotation().toRotationMatrix(), medianTranslation());
+}
+
+/**
+ * @brief L1 rotation average of the reservoir
+ *
+ * Initialized with the chordal quaternion mean (eigenvector of the largest
+ * eigenvalue of sum(q q^T)), then refined with the Weiszfeld algorithm on
+ * SO(3) which minimizes the sum of the geodesic distances to the rotations and
+ * is therefore robust to outliers.
+ *
+ * @return average rotation
+ */
+Eigen::Quaterniond PosePairAggregator::averageRotation() const {
+  Eigen::Matrix4d accumulator = Eigen::Matrix4d::Zero();
+  for (const Eigen::Quaterniond &q : rotations_)
+    accumulator += q.coeffs() * q.coeffs().transpose();
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix4d> solver(accumulator);
+  Eigen::Vector4d mean_coeffs = solver.eigenvectors().col(3);
+  Eigen::Quaterniond mean(mean_coeffs(3), mean_coeffs(0), mean_coeffs(1),
+                          mean_coeffs(2));
+  mean.normalize();
+
+  const int max_iterations = 20;
+  for (int iter = 0; iter < max_iterations; iter++) {
+    Eigen::Vector3d step = Eigen::Vector3d::Zero();
+    double sum_weights = 0.0;
+    for (const Eigen::Quaterniond &q : rotations_) {
+      Eigen::AngleAxisd error(mean.conjugate() * q);
+      if (error.angle() < 1e-12) // the rotation is on the current average
+        continue;
+      step += error.axis(); // error / |error|
+      sum_weights += 1.0 / error.angle();
+    }
+    if (sum_weights == 0.0)
+      break;
+    step /= sum_weights;
+    if (step.norm() < 1e-12)
+      break;
+    mean = mean * Eigen::Quaterniond(
+                      Eigen::AngleAxisd(step.norm(), step.normalized()));
+    mean.normalize();
+  }
+  return mean;
+}
+
+/**
+ * @brief Per-component median of the translations of the reservoir
+ *
+ * @return median translation
+ */
+Eigen::Vector3d PosePairAggregator::medianTranslation() const {
+  Eigen::Vector3d median_translation;
+  std::vector<double> values(translations_.size());
+  const size_t n = values.size() / 2;
+  for (int k = 0; k < 3; k++) {
+    for (size_t i = 0; i < translations_.size(); i++)
+      values[i] = translations_[i](k);
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    median_translation(k) = values[n];
+  }
+  return median_translation;
+}
+
+/**
+ * @brief Merge the pair poses accumulated separately (e.g. per chunk of
+ * frames)
+ *
+ * The partial results are merged in their order in the vector, so the merged
+ * aggregators do not depend on the threads which computed them.
+ *
+ * @param partial_pose_pairs pair poses of each chunk
+ * @param pose_pairs merged pair poses
+ */
+void mergePosePairs(
+    const std::vector<std::map<std::pair<int, int>, PosePairAggregator>>
+        &partial_pose_pairs,
+    std::map<std::pair<int, int>, PosePairAggregator> &pose_pairs) {
+  for (const std::map<std::pair<int, int>, PosePairAggregator> &partial :
+       partial_pose_pairs) {
+    for (std::map<std::pair<int, int>, PosePairAggregator>::const_iterator it =
+             partial.begin();
+         it != partial.end(); ++it)
+      pose_pairs[it->first].merge(it->second);
+  }
+}
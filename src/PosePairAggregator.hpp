@@ -0,0 +1,47 @@
+#pragma once
+
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/StdVector>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Pose.hpp"
+
+/**
+ * @class PosePairAggregator
+ *
+ * @brief Streaming robust average of the relative poses measured between two
+ * entities (boards, cameras or objects)
+ *
+ * The measurements are accumulated one at a time in a fixed-size reservoir
+ * (uniform sample of all the measurements), so the memory per pair is bounded
+ * whatever the length of the sequence. The average rotation is the L1 rotation
+ * average (geodesic median) of the reservoir and the average translation its
+ * per-component median.
+ */
+class PosePairAggregator {
+public:
+  // Functions
+  PosePairAggregator(int capacity = 256);
+  void addPose(const Pose &pose);
+  void merge(const PosePairAggregator &other);
+  int getNbPoses() const;
+  Pose getAveragePose() const;
+
+private:
+  int capacity_; // maximum number of poses kept in the reservoir
+  int nb_poses_; // number of poses added (kept or not)
+  std::vector<Eigen::Quaterniond, Eigen::aligned_allocator<Eigen::Quaterniond>>
+      rotations_;                             // reservoir rotations
+  std::vector<Eigen::Vector3d> translations_; // reservoir translations
+  std::minstd_rand generator_; // fixed seed: the sample is reproducible
+
+  Eigen::Quaterniond averageRotation() const;
+  Eigen::Vector3d medianTranslation() const;
+};
+
+void mergePosePairs(
+    const std::vector<std::map<std::pair<int, int>, PosePairAggregator>>
+        &partial_pose_pairs,
+    std::map<std::pair<int, int>, PosePairAggregator> &pose_pairs);
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#include "PerfCounters.hpp"
+#include "SolverTelemetry.hpp"
+#include "StageProfiler.hpp"
+#include "ThreadPool.hpp"
+#include "TraceSink.hpp"
+
+/**
+ * @brief Get the global telemetry instance
+ *
+ * @return telemetry shared by all the refinements
+ */
+SolverTelemetry &SolverTelemetry::get() {
+  static SolverTelemetry telemetry;
+  return telemetry;
+}
+
+/**
+ * @brief Open (and truncate) the JSON-lines file receiving the records
+ *
+ * @param file_path path of the output file
+ */
+void SolverTelemetry::open(std::string file_path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (file_.is_open())
+    file_.close();
+  file_.open(file_path, std::ofstream::out | std::ofstream::trunc);
+}
+
+/**
+ * @brief Close the output file, the next solves are not recorded
+ *
+ */
+void SolverTelemetry::close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (file_.is_open())
+    file_.close();
+}
+
+/**
+ * @brief Check if the records are written to a file
+ *
+ * @return true if a file is open
+ */
+bool SolverTelemetry::isOpen() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return file_.is_open();
+}
+
+/**
+ * @brief Append one record (a single line) to the output file
+ *
+ * @param record JSON object without line break
+ */
+void SolverTelemetry::writeRecord(const std::string &record) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (file_.is_open())
+    file_ << record << "\n";
+}
+
+/**
+ * @brief Enable or disable the progress of the solver on the standard output
+ *
+ * @param progress_to_stdout true to print the progress
+ */
+void SolverTelemetry::setProgressToStdout(bool progress_to_stdout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  progress_to_stdout_ = progress_to_stdout;
+}
+
+/**
+ * @brief Check if the progress of the solver is printed on the standard output
+ *
+ * @return true if the progress is printed
+ */
+bool SolverTelemetry::getProgressToStdout() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return progress_to_stdout_;
+}
+
+/**
+ * @brief Write a double as a JSON value (non-finite values are not valid JSON)
+ *
+ * @param stream output stream
+ * @param value value to write
+ */
+static void writeJsonNumber(std::ostringstream &stream, double value) {
+  if (std::isfinite(value))
+    stream << value;
+  else
+    stream << "null";
+}
+
+TelemetryCallback::TelemetryCallback(std::string stage) : stage_(stage) {}
+
+/**
+ * @brief Record the current iteration of the solve
+ *
+ * @param summary summary of the iteration provided by Ceres
+ *
+ * @return always continue the solve
+ */
+ceres::CallbackReturnType TelemetryCallback::
+operator()(const ceres::IterationSummary &summary) {
+  std::ostringstream record;
+  record << std::setprecision(12);
+  record << "{\"stage\":\"" << stage_ << "\""
+         << ",\"iteration\":" << summary.iteration << ",\"cost\":";
+  writeJsonNumber(record, summary.cost);
+  record << ",\"cost_change\":";
+  writeJsonNumber(record, summary.cost_change);
+  record << ",\"gradient_norm\":";
+  writeJsonNumber(record, summary.gradient_norm);
+  record << ",\"step_norm\":";
+  writeJsonNumber(record, summary.step_norm);
+  record << ",\"step_is_successful\":"
+         << (summary.step_is_successful ? "true" : "false")
+         << ",\"step_time\":";
+  writeJsonNumber(record, summary.iteration_time_in_seconds);
+  record << ",\"linear_solver_time\":";
+  writeJsonNumber(record, summary.step_solver_time_in_seconds);
+  record << ",\"cumulative_time\":";
+  writeJsonNumber(record, summary.cumulative_time_in_seconds);
+  record << "}";
+  SolverTelemetry::get().writeRecord(record.str());
+  return ceres::SOLVER_CONTINUE;
+}
+
+/**
+ * @brief Solve a refinement problem with the common solver options
+ *
+ * The iterations are recorded under the name "stage" when the telemetry file
+ * is open, and the size of the problem is added to the stage report and to
+ * the trace.
+ *
+ * @param stage name of the refinement stage
+ * @param nb_iterations maximum number of iterations
+ * @param problem problem to solve
+ * @param summary summary of the solve
+ */
+void solveProblem(std::string stage, int nb_iterations,
+                  ceres::Problem *problem, ceres::Solver::Summary *summary) {
+  SolverTelemetry &telemetry = SolverTelemetry::get();
+  ceres::Solver::Options options;
+  options.linear_solver_type = ceres::SPARSE_SCHUR;
+  options.max_num_iterations = nb_iterations;
+  options.minimizer_progress_to_stdout = telemetry.getProgressToStdout();
+  // the solves run concurrently in the thread pool are single-threaded,
+  // the others use the share of the pool given to their stage
+  options.num_threads = ThreadPool::getThreadBudget();
+  TelemetryCallback callback(stage);
+  if (telemetry.isOpen())
+    options.callbacks.push_back(&callback);
+  TraceScope trace(stage.c_str(), "solve");
+  {
+    PerfScope perf("ceres_solve");
+    ceres::Solve(options, problem, summary);
+  }
+  trace.addArg("iterations", summary->iterations.size());
+  trace.addArg("residual_blocks", summary->num_residual_blocks);
+  StageReport::get().addSolve(summary->iterations.size(),
+                              summary->num_residual_blocks,
+                              summary->num_parameter_blocks);
+}
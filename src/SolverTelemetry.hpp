@@ -0,0 +1,53 @@
+#pragma once
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include "ceres/ceres.h"
+
+/**
+ * @class SolverTelemetry
+ *
+ * @brief Global record of the iterations of the non-linear refinements
+ *
+ * When a file is opened, every solve run with solveProblem writes one JSON
+ * record per iteration (JSON-lines format). The progress of the solver on the
+ * standard output can also be silenced.
+ */
+class SolverTelemetry {
+public:
+  // Functions
+  static SolverTelemetry &get();
+  void open(std::string file_path);
+  void close();
+  bool isOpen();
+  void writeRecord(const std::string &record);
+  void setProgressToStdout(bool progress_to_stdout);
+  bool getProgressToStdout();
+
+private:
+  SolverTelemetry(){};
+  std::mutex mutex_;               // the solves can run concurrently
+  std::ofstream file_;             // JSON-lines output file
+  bool progress_to_stdout_ = true; // print the solver progress on stdout
+};
+
+/**
+ * @class TelemetryCallback
+ *
+ * @brief Ceres iteration callback writing the iterations of a solve in the
+ * SolverTelemetry file
+ */
+class TelemetryCallback : public ceres::IterationCallback {
+public:
+  TelemetryCallback(std::string stage);
+  ceres::CallbackReturnType
+  operator()(const ceres::IterationSummary &summary) override;
+
+private:
+  std::string stage_; // name of the refinement stage
+};
+
+void solveProblem(std::string stage, int nb_iterations,
+                  ceres::Problem *problem, ceres::Solver::Summary *summary);
@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sys/resource.h>
+
+#include "AllocationCounter.hpp"
+#include "StageProfiler.hpp"
+#include "logger.h"
+
+/**
+ * @brief Get the CPU time used by the process (all the threads)
+ *
+ * @return user and system time in seconds
+ */
+static double getProcessCpuTime() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/**
+ * @brief Get the peak resident memory of the process
+ *
+ * @return peak resident set size in kilobytes
+ */
+static long getPeakRss() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/**
+ * @brief Get the fraction of the threads of the pool busy during a stage
+ *
+ * @param stage profiled stage
+ *
+ * @return utilization in [0, 1] (0 if the pool was not profiled)
+ */
+static double getPoolUtilization(const StageReport::Stage &stage) {
+  if (stage.nb_threads == 0 || stage.wall_time <= 0.0)
+    return 0.0;
+  return stage.pool_busy_time / (stage.wall_time * stage.nb_threads);
+}
+
+/**
+ * @brief Get the global report
+ *
+ * @return report shared by all the stages
+ */
+StageReport &StageReport::get() {
+  static StageReport report;
+  return report;
+}
+
+/**
+ * @brief Open a stage receiving the solves and the kernels of the threads
+ * tagged with its id (ThreadPool::setTaskTag)
+ *
+ * @return id of the stage
+ */
+int StageReport::openStage() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const int stage_id = next_stage_id_++;
+  open_stages_[stage_id] = Stage();
+  return stage_id;
+}
+
+/**
+ * @brief Add a finished stage to the report
+ *
+ * The solves and the kernels recorded for the stage since its opening are
+ * added to it.
+ *
+ * @param stage resources used by the stage
+ * @param stage_id id returned by openStage
+ */
+void StageReport::addStage(const Stage &stage, int stage_id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stages_.push_back(stage);
+  std::map<int, Stage>::iterator it = open_stages_.find(stage_id);
+  if (it == open_stages_.end())
+    return;
+  Stage &added_stage = stages_.back();
+  added_stage.nb_solves = it->second.nb_solves;
+  added_stage.nb_iterations = it->second.nb_iterations;
+  added_stage.nb_residual_blocks = it->second.nb_residual_blocks;
+  added_stage.nb_parameter_blocks = it->second.nb_parameter_blocks;
+  added_stage.kernels.swap(it->second.kernels);
+  open_stages_.erase(it);
+}
+
+/**
+ * @brief Record a refinement solved by the calling thread
+ *
+ * The solve is attributed to the stage whose id is the task tag of the
+ * thread, it is ignored outside the profiled stages.
+ *
+ * @param nb_iterations number of iterations of the solver
+ * @param nb_residual_blocks number of residual blocks of the problem
+ * @param nb_parameter_blocks number of parameter blocks of the problem
+ */
+void StageReport::addSolve(int nb_iterations, long nb_residual_blocks,
+                           long nb_parameter_blocks) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::map<int, Stage>::iterator it =
+      open_stages_.find(ThreadPool::getTaskTag());
+  if (it == open_stages_.end())
+    return;
+  it->second.nb_solves++;
+  it->second.nb_iterations += nb_iterations;
+  it->second.nb_residual_blocks += nb_residual_blocks;
+  it->second.nb_parameter_blocks += nb_parameter_blocks;
+}
+
+/**
+ * @brief Add the time and the hardware counters of a kernel run by the calling
+ * thread
+ *
+ * As the solves, the kernel is attributed to the stage of the thread.
+ *
+ * @param kernel name of the kernel
+ * @param values counters of the call (-1 if the counters are disabled)
+ * @param wall_time duration of the call in seconds
+ */
+void StageReport::addKernel(std::string kernel,
+                            const PerfCounters::Values &values,
+                            double wall_time) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::map<int, Stage>::iterator it =
+      open_stages_.find(ThreadPool::getTaskTag());
+  if (it == open_stages_.end())
+    return;
+  Kernel &stage_kernel = it->second.kernels[kernel];
+  if (stage_kernel.nb_calls == 0)
+    stage_kernel.values.fill(0);
+  stage_kernel.nb_calls++;
+  stage_kernel.wall_time += wall_time;
+  for (int counter = 0; counter < PerfCounters::NbCounters; counter++)
+    stage_kernel.values[counter] =
+        (stage_kernel.values[counter] >= 0 && values[counter] >= 0)
+            ? stage_kernel.values[counter] + values[counter]
+            : -1;
+}
+
+/**
+ * @brief Write hardware counters as the members of a JSON object
+ *
+ * @param file output stream
+ * @param values counters (the missing ones are not written)
+ */
+static void writePerfCounters(std::ofstream &file,
+                              const PerfCounters::Values &values) {
+  bool first = true;
+  for (int counter = 0; counter < PerfCounters::NbCounters; counter++) {
+    if (values[counter] < 0)
+      continue;
+    file << (first ? "" : ", ") << "\"" << PerfCounters::getCounterName(counter)
+         << "\": " << values[counter];
+    first = false;
+  }
+  if (values[PerfCounters::Cycles] > 0 &&
+      values[PerfCounters::Instructions] >= 0)
+    file << ", \"ipc\": "
+         << double(values[PerfCounters::Instructions]) /
+                values[PerfCounters::Cycles];
+}
+
+/**
+ * @brief Remove all the recorded stages
+ *
+ */
+void StageReport::clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stages_.clear();
+  for (std::map<int, Stage>::iterator it = open_stages_.begin();
+       it != open_stages_.end(); ++it)
+    it->second = Stage();
+}
+
+/**
+ * @brief Get the totals of the run and mark the stages which overlapped
+ * another stage
+ *
+ * The stages of a concurrent pipeline overlap, so the totals are measured
+ * from the start of the first stage to the end of the last one instead of
+ * being summed over the stages.
+ *
+ * @param wall_time wall time of the run (seconds)
+ * @param cpu_time CPU time of the process during the run (seconds)
+ */
+void StageReport::getRunTotals(double &wall_time, double &cpu_time) {
+  wall_time = 0.0;
+  cpu_time = 0.0;
+  if (stages_.empty())
+    return;
+  int first_idx = 0, last_idx = 0;
+  for (int i = 0; i < stages_.size(); i++) {
+    if (stages_[i].start < stages_[first_idx].start)
+      first_idx = i;
+    if (stages_[i].end > stages_[last_idx].end)
+      last_idx = i;
+    stages_[i].overlapped = false;
+    for (int j = 0; j < i; j++)
+      if (stages_[i].start < stages_[j].end &&
+          stages_[j].start < stages_[i].end) {
+        stages_[i].overlapped = true;
+        stages_[j].overlapped = true;
+      }
+  }
+  const Stage &first = stages_[first_idx], &last = stages_[last_idx];
+  wall_time = std::chrono::duration<double>(last.end - first.start).count();
+  cpu_time = last.cpu_start + last.cpu_time - first.cpu_start;
+}
+
+/**
+ * @brief Write the report in a JSON file
+ *
+ * @param file_path path of the output file
+ */
+void StageReport::write(std::string file_path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::ofstream file(file_path, std::ofstream::out | std::ofstream::trunc);
+  if (!file.is_open()) {
+    LOG_ERROR << "Cannot write the stage report " << file_path;
+    return;
+  }
+
+  double total_wall_time, total_cpu_time;
+  getRunTotals(total_wall_time, total_cpu_time);
+  std::chrono::steady_clock::time_point run_start;
+  if (!stages_.empty())
+    run_start = std::min_element(stages_.begin(), stages_.end(),
+                                 [](const Stage &a, const Stage &b) {
+                                   return a.start < b.start;
+                                 })
+                    ->start;
+  file << std::setprecision(9) << "{\n  \"stages\": [";
+  for (int i = 0; i < stages_.size(); i++) {
+    const Stage &stage = stages_[i];
+    file << (i > 0 ? "," : "") << "\n    {\"name\": \"" << stage.name << "\""
+         << ", \"start\": "
+         << std::chrono::duration<double>(stage.start - run_start).count()
+         << ", \"wall_time\": " << stage.wall_time
+         << ", \"cpu_time\": " << stage.cpu_time
+         << ", \"overlapped\": " << (stage.overlapped ? "true" : "false")
+         << ", \"peak_rss_kb\": " << stage.peak_rss_kb;
+    if (stage.nb_allocations >= 0)
+      file << ", \"allocations\": " << stage.nb_allocations
+           << ", \"allocated_bytes\": " << stage.allocated_bytes;
+    file << ", \"solves\": " << stage.nb_solves
+         << ", \"solver_iterations\": " << stage.nb_iterations
+         << ", \"residual_blocks\": " << stage.nb_residual_blocks
+         << ", \"solved_parameter_blocks\": " << stage.nb_parameter_blocks;
+    if (stage.nb_threads > 0)
+      file << ", \"threads\": " << stage.nb_threads
+           << ", \"pool_busy_time\": " << stage.pool_busy_time
+           << ", \"pool_jobs\": " << stage.nb_pool_jobs
+           << ", \"pool_steals\": " << stage.nb_pool_steals
+           << ", \"pool_utilization\": " << getPoolUtilization(stage);
+    file << ", \"counts\": {";
+    for (std::map<std::string, long>::const_iterator it = stage.counts.begin();
+         it != stage.counts.end(); ++it)
+      file << (it != stage.counts.begin() ? ", " : "") << "\"" << it->first
+           << "\": " << it->second;
+    file << "}";
+    if (stage.perf[PerfCounters::Cycles] >= 0) {
+      file << ", \"perf\": {";
+      writePerfCounters(file, stage.perf);
+      file << "}";
+    }
+    if (!stage.kernels.empty()) {
+      file << ", \"kernels\": {";
+      for (std::map<std::string, Kernel>::const_iterator it =
+               stage.kernels.begin();
+           it != stage.kernels.end(); ++it) {
+        file << (it != stage.kernels.begin() ? ", " : "") << "\"" << it->first
+             << "\": {\"calls\": " << it->second.nb_calls
+             << ", \"wall_time\": " << it->second.wall_time;
+        if (it->second.values[PerfCounters::Cycles] >= 0) {
+          file << ", ";
+          writePerfCounters(file, it->second.values);
+        }
+        file << "}";
+      }
+      file << "}";
+    }
+    file << "}";
+  }
+  file << "\n  ],\n  \"total_wall_time\": " << total_wall_time
+       << ",\n  \"total_cpu_time\": " << total_cpu_time
+       << ",\n  \"peak_rss_kb\": " << getPeakRss() << "\n}\n";
+}
+
+/**
+ * @brief Log the time and memory used by each stage
+ *
+ */
+void StageReport::logSummary() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  double total_wall_time, total_cpu_time;
+  getRunTotals(total_wall_time, total_cpu_time);
+  LOG_INFO << "Stage profile (wall time, CPU time, peak RSS, solves) :: ";
+  for (const Stage &stage : stages_) {
+    double share =
+        total_wall_time > 0.0 ? 100.0 * stage.wall_time / total_wall_time : 0;
+    LOG_INFO << "  " << stage.name << " :: " << stage.wall_time << " s ("
+             << std::fixed << std::setprecision(1) << share << "%), "
+             << std::defaultfloat << stage.cpu_time << " s CPU, "
+             << stage.peak_rss_kb << " kB, " << stage.nb_solves
+             << " solves / " << stage.nb_iterations << " iterations"
+             << (stage.overlapped ? " (overlapped)" : "");
+    if (stage.nb_threads > 0)
+      LOG_INFO << "  " << stage.name << " :: " << stage.nb_pool_jobs
+               << " jobs on " << stage.nb_threads << " threads, "
+               << std::fixed << std::setprecision(1)
+               << 100.0 * getPoolUtilization(stage) << "% utilization, "
+               << std::defaultfloat << stage.nb_pool_steals << " steals";
+    if (stage.nb_allocations >= 0)
+      LOG_INFO << "  " << stage.name << " :: " << stage.nb_allocations
+               << " allocations, " << stage.allocated_bytes << " bytes";
+    for (std::map<std::string, Kernel>::const_iterator it =
+             stage.kernels.begin();
+         it != stage.kernels.end(); ++it) {
+      const PerfCounters::Values &values = it->second.values;
+      if (values[PerfCounters::Cycles] < 0) {
+        LOG_INFO << "  " << stage.name << " / " << it->first
+                 << " :: " << it->second.nb_calls << " calls, "
+                 << it->second.wall_time << " s";
+        continue;
+      }
+      LOG_INFO << "  " << stage.name << " / " << it->first
+               << " :: " << it->second.nb_calls << " calls, "
+               << it->second.wall_time << " s, "
+               << values[PerfCounters::Cycles] << " cycles, IPC "
+               << (values[PerfCounters::Cycles] > 0
+                       ? double(values[PerfCounters::Instructions]) /
+                             values[PerfCounters::Cycles]
+                       : 0.0)
+               << ", " << values[PerfCounters::CacheMisses]
+               << " cache misses, " << values[PerfCounters::BranchMisses]
+               << " branch misses";
+    }
+  }
+  LOG_INFO << "Total wall time :: " << total_wall_time << " s, CPU time :: "
+           << total_cpu_time << " s";
+}
+
+/**
+ * @brief Start profiling a stage
+ *
+ * @param stage name of the stage
+ * @param counts function returning the object counts at the end of the stage
+ * @param pool thread pool whose utilization is recorded (can be null)
+ */
+StageProfiler::StageProfiler(
+    std::string stage, std::function<std::map<std::string, long>()> counts,
+    const ThreadPool *pool)
+    : stage_(stage), counts_(counts),
+      wall_start_(std::chrono::steady_clock::now()),
+      cpu_start_(getProcessCpuTime()), pool_(pool),
+      pool_start_(pool ? pool->getStats() : ThreadPool::Stats()),
+      nb_allocations_start_(AllocationCounter::getNbAllocations()),
+      nb_bytes_start_(AllocationCounter::getNbBytes()),
+      perf_active_(PerfCounters::get().read(perf_start_)),
+      trace_(stage_.c_str(), "stage"),
+      stage_id_(StageReport::get().openStage()),
+      previous_tag_(ThreadPool::getTaskTag()) {
+  ThreadPool::setTaskTag(stage_id_);
+}
+
+/**
+ * @brief Add the resources used since the creation of the profiler to the
+ * report
+ *
+ */
+StageProfiler::~StageProfiler() {
+  ThreadPool::setTaskTag(previous_tag_);
+  StageReport::Stage stage;
+  stage.name = stage_;
+  stage.start = wall_start_;
+  stage.end = std::chrono::steady_clock::now();
+  stage.wall_time =
+      std::chrono::duration<double>(stage.end - wall_start_).count();
+  stage.cpu_start = cpu_start_;
+  stage.cpu_time = getProcessCpuTime() - cpu_start_;
+  stage.peak_rss_kb = getPeakRss();
+  if (AllocationCounter::isEnabled()) {
+    stage.nb_allocations =
+        AllocationCounter::getNbAllocations() - nb_allocations_start_;
+    stage.allocated_bytes = AllocationCounter::getNbBytes() - nb_bytes_start_;
+  }
+  if (pool_) {
+    ThreadPool::Stats pool_end = pool_->getStats();
+    stage.nb_threads = pool_->getNbThreads();
+    stage.pool_busy_time = pool_end.busy_time - pool_start_.busy_time;
+    stage.nb_pool_jobs = pool_end.nb_jobs - pool_start_.nb_jobs;
+    stage.nb_pool_steals = pool_end.nb_steals - pool_start_.nb_steals;
+  }
+  PerfCounters::Values perf_end;
+  if (perf_active_ && PerfCounters::get().read(perf_end))
+    stage.perf = PerfCounters::difference(perf_end, perf_start_);
+  if (counts_)
+    stage.counts = counts_();
+  StageReport::get().addStage(stage, stage_id_);
+  LOG_INFO << "Stage " << stage_ << " done in " << stage.wall_time << " s";
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PerfCounters.hpp"
+#include "ThreadPool.hpp"
+#include "TraceSink.hpp"
+
+/**
+ * @class StageReport
+ *
+ * @brief Global record of the resources used by each stage of the calibration
+ *
+ * Every stage profiled with a StageProfiler adds an entry (wall time, CPU
+ * time, peak resident memory, allocations, solver statistics, object counts
+ * and hardware counters when they are enabled). The entries are written as a
+ * JSON report and summarized in the log at the end of the calibration.
+ *
+ * The CPU time, the allocations and the usage of the pool are measured for
+ * the whole process, so the ones of a stage which overlapped another stage
+ * (concurrent pipeline) include the work of the other stage: such stages are
+ * marked as overlapped. The totals are measured from the start of the first
+ * stage to the end of the last one, not summed over the stages.
+ */
+class StageReport {
+public:
+  // Time and hardware counters of a kernel
+  struct Kernel {
+    long nb_calls = 0;           // number of profiled calls
+    double wall_time = 0.0;      // seconds spent in the calls (all threads)
+    PerfCounters::Values values; // sum of the counters of the calls
+  };
+
+  // Resources used by one stage
+  struct Stage {
+    std::string name;
+    std::chrono::steady_clock::time_point start; // wall clock start
+    std::chrono::steady_clock::time_point end;   // wall clock end
+    double wall_time = 0.0;    // seconds
+    double cpu_start = 0.0;    // CPU time of the process at the start
+    double cpu_time = 0.0;     // seconds (user + system, all threads)
+    bool overlapped = false;   // another stage ran during the stage
+    long peak_rss_kb = 0;      // peak resident memory of the process
+    long nb_allocations = -1;  // heap allocations (-1 if not counted)
+    long allocated_bytes = -1; // allocated bytes (-1 if not counted)
+    int nb_solves = 0;         // number of refinements solved
+    int nb_iterations = 0;     // solver iterations of all the refinements
+    long nb_residual_blocks = 0;  // residual blocks of all the refinements
+    long nb_parameter_blocks = 0; // parameter blocks of all the refinements
+    std::map<std::string, long> counts; // objects at the end of the stage
+    int nb_threads = 0;         // threads of the pool (0 if not profiled)
+    double pool_busy_time = 0;  // time spent in the jobs of the pool
+    long nb_pool_jobs = 0;      // jobs run by the pool
+    long nb_pool_steals = 0;    // tasks stolen between the workers
+    PerfCounters::Values perf{{-1, -1, -1, -1}}; // thread running the stage
+    std::map<std::string, Kernel> kernels;       // kernels of all the threads
+  };
+
+  // Functions
+  static StageReport &get();
+  int openStage();
+  void addStage(const Stage &stage, int stage_id);
+  void addSolve(int nb_iterations, long nb_residual_blocks,
+                long nb_parameter_blocks);
+  void addKernel(std::string kernel, const PerfCounters::Values &values,
+                 double wall_time);
+  void clear();
+  void write(std::string file_path);
+  void logSummary();
+
+private:
+  StageReport(){};
+  std::mutex mutex_;          // the solves can run concurrently
+  std::vector<Stage> stages_; // finished stages
+  std::map<int, Stage> open_stages_; // solves and kernels of the running
+                                     // stages (key: stage id)
+  int next_stage_id_ = 1;            // id of the next opened stage
+
+  void getRunTotals(double &wall_time, double &cpu_time);
+};
+
+/**
+ * @class StageProfiler
+ *
+ * @brief Profile a stage of the calibration until the profiler is destroyed
+ *
+ *   {
+ *     StageProfiler profiler("calibrate_3d_objects", counts);
+ *     Calib.calibrate3DObjects();
+ *   }
+ *
+ * The solves run during the scope by the calling thread and by the jobs it
+ * submits to the pool are attributed to the stage, even when other stages run
+ * concurrently. "counts" returns the number of objects (observations,
+ * parameter blocks...) recorded at the end of the stage, it must not read
+ * data modified by a concurrent stage. The stage is also added to the trace
+ * when the TraceSink is open. The hardware counters of the stage are the ones
+ * of the thread running it, the work done by the other threads is reported by
+ * the kernels (PerfScope). When a pool is given, its utilization during the
+ * stage is recorded as well.
+ */
+class StageProfiler {
+public:
+  // Functions
+  StageProfiler(std::string stage,
+                std::function<std::map<std::string, long>()> counts,
+                const ThreadPool *pool = nullptr);
+  ~StageProfiler();
+
+private:
+  std::string stage_; // name of the profiled stage
+  std::function<std::map<std::string, long>()> counts_; // object counts
+  std::chrono::steady_clock::time_point wall_start_;    // wall clock start
+  double cpu_start_;                                    // CPU time start
+  const ThreadPool *pool_;           // pool used by the stage (can be null)
+  ThreadPool::Stats pool_start_;     // usage of the pool at the beginning
+  size_t nb_allocations_start_;      // allocations at the beginning
+  size_t nb_bytes_start_;            // allocated bytes at the beginning
+  bool perf_active_;                 // true if the hardware counters were read
+  PerfCounters::Values perf_start_;  // hardware counters at the beginning
+  TraceScope trace_;                 // event of the stage in the trace
+  int stage_id_;                     // id of the stage in the StageReport
+  int previous_tag_;                 // task tag of the thread before the stage
+};
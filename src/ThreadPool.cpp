@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+#include "ThreadPool.hpp"
+
+namespace {
+thread_local const ThreadPool *current_pool = nullptr; // pool of the worker
+thread_local int current_worker = -1; // index of the worker in its pool
+thread_local bool in_parallel_job = false; // running a job of parallelFor
+thread_local int task_tag = 0; // tag inherited by the submitted tasks
+thread_local int thread_budget = 1; // threads usable by the libraries
+} // namespace
+
+/**
+ * @brief Start the worker threads
+ *
+ * The calling thread participates in parallelFor, therefore only
+ * nb_threads - 1 workers are spawned.
+ *
+ * @param nb_threads total number of threads used by the pool (>= 1)
+ */
+ThreadPool::ThreadPool(int nb_threads) {
+  nb_threads = std::max(nb_threads, 1);
+  for (int i = 0; i < nb_threads - 1; i++)
+    queues_.emplace_back(new WorkQueue());
+  for (int i = 0; i < nb_threads - 1; i++)
+    workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+/**
+ * @brief Stop and join the worker threads
+ *
+ */
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  for (std::thread &worker : workers_)
+    worker.join();
+}
+
+/**
+ * @brief Get the number of threads used by the pool (including the caller)
+ *
+ * @return number of threads
+ */
+int ThreadPool::getNbThreads() const { return workers_.size() + 1; }
+
+/**
+ * @brief Get the usage of the pool since its creation
+ *
+ * @return busy time, number of jobs and number of stolen tasks
+ */
+ThreadPool::Stats ThreadPool::getStats() const {
+  Stats stats;
+  stats.busy_time = 1e-9 * busy_ns_.load();
+  stats.nb_jobs = nb_jobs_.load();
+  stats.nb_steals = nb_steals_.load();
+  return stats;
+}
+
+/**
+ * @brief Check if the calling thread is running a job of a parallelFor
+ * distributed over several threads
+ *
+ * The libraries used in the jobs (e.g. Ceres) should then run serially to
+ * avoid oversubscribing the machine.
+ *
+ * @return true inside a concurrent job
+ */
+bool ThreadPool::isInParallelJob() { return in_parallel_job; }
+
+/**
+ * @brief Get the tag of the calling thread
+ *
+ * @return tag set with setTaskTag, or inherited from the thread which
+ * submitted the running task (0 by default)
+ */
+int ThreadPool::getTaskTag() { return task_tag; }
+
+/**
+ * @brief Tag the work of the calling thread (e.g. with the profiled stage)
+ *
+ * The tasks and the jobs submitted afterwards by this thread run with the
+ * same tag, so the work they do can be attributed to the caller.
+ *
+ * @param tag new tag of the thread
+ */
+void ThreadPool::setTaskTag(int tag) { task_tag = tag; }
+
+/**
+ * @brief Get the number of threads the libraries called by this thread can
+ * use (e.g. the threads of a Ceres solve)
+ *
+ * @return 1 in a job of a parallelFor, the budget of the thread otherwise (1
+ * unless set with setThreadBudget)
+ */
+int ThreadPool::getThreadBudget() {
+  return in_parallel_job ? 1 : thread_budget;
+}
+
+/**
+ * @brief Set the number of threads the libraries called by this thread can
+ * use
+ *
+ * @param nb_threads new budget (>= 1)
+ *
+ * @return previous budget
+ */
+int ThreadPool::setThreadBudget(int nb_threads) {
+  const int previous_budget = thread_budget;
+  thread_budget = std::max(nb_threads, 1);
+  return previous_budget;
+}
+
+/**
+ * @brief Add a task to the queue of the calling worker, or to the queues of
+ * the workers in turn when called from another thread
+ *
+ * The task runs with the tag of the calling thread.
+ *
+ * @param task task to be run by a worker
+ */
+void ThreadPool::push(std::function<void()> task) {
+  int queue_idx = (current_pool == this)
+                      ? current_worker
+                      : next_queue_++ % static_cast<int>(queues_.size());
+  const int tag = task_tag;
+  std::function<void()> tagged_task = [tag, task]() {
+    const int previous_tag = task_tag;
+    task_tag = tag;
+    task();
+    task_tag = previous_tag;
+  };
+  {
+    std::unique_lock<std::mutex> lock(queues_[queue_idx]->mutex);
+    queues_[queue_idx]->tasks.push_back(std::move(tagged_task));
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    nb_pending_++;
+  }
+  condition_.notify_one();
+}
+
+/**
+ * @brief Run a task asynchronously on a worker
+ *
+ * The caller is responsible for waiting for the completion of the task. The
+ * task is run immediately on the caller if the pool has no worker.
+ *
+ * @param task task to be run
+ */
+void ThreadPool::submit(std::function<void()> task) {
+  if (workers_.empty()) {
+    task();
+    return;
+  }
+  push(std::move(task));
+}
+
+/**
+ * @brief Take the newest task of the worker, or steal the oldest task of
+ * another worker
+ *
+ * @param worker_idx index of the worker
+ * @param task task to run
+ *
+ * @return true if a task was found
+ */
+bool ThreadPool::pop(int worker_idx, std::function<void()> &task) {
+  const int nb_queues = queues_.size();
+  for (int i = 0; i < nb_queues; i++) {
+    WorkQueue &queue = *queues_[(worker_idx + i) % nb_queues];
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      continue;
+    if (i == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      nb_steals_++;
+    }
+    nb_pending_--;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Process the queued tasks until the pool is stopped
+ *
+ * @param worker_idx index of the worker
+ */
+void ThreadPool::workerLoop(int worker_idx) {
+  current_pool = this;
+  current_worker = worker_idx;
+  while (true) {
+    std::function<void()> task;
+    if (pop(worker_idx, task)) {
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return stop_ || nb_pending_ > 0; });
+    if (stop_ && nb_pending_ <= 0)
+      return;
+  }
+}
+
+/**
+ * @brief Add the time spent running jobs to the statistics
+ *
+ * @param start beginning of the jobs
+ * @param nb_jobs number of jobs run
+ */
+void ThreadPool::addBusyTime(std::chrono::steady_clock::time_point start,
+                             int nb_jobs) {
+  busy_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  nb_jobs_ += nb_jobs;
+}
+
+/**
+ * @brief Run job(0) ... job(nb_jobs - 1) concurrently and wait for completion
+ *
+ * The jobs are dispatched dynamically (first come, first served) to the
+ * workers and to the calling thread. The jobs must write to disjoint data. If
+ * jobs throw, all the jobs are still run and the first exception is rethrown
+ * on the calling thread.
+ *
+ * @param nb_jobs number of jobs to run
+ * @param job function called with the index of the job
+ */
+void ThreadPool::parallelFor(int nb_jobs,
+                             const std::function<void(int)> &job) {
+  if (nb_jobs <= 0)
+    return;
+  if (nb_jobs == 1 || workers_.empty()) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (int i = 0; i < nb_jobs; i++)
+      job(i);
+    addBusyTime(start, nb_jobs);
+    return;
+  }
+
+  // State shared between the caller and the helpers, the helpers might be
+  // scheduled after the caller returns so it cannot live on the stack
+  struct SharedState {
+    std::atomic<int> next_job{0};
+    int nb_done = 0;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error; // first exception thrown by a job
+  };
+  std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+  std::function<void(int)> job_copy = job;
+  std::function<void()> run_jobs = [this, state, job_copy, nb_jobs]() {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    bool was_in_parallel_job = in_parallel_job;
+    in_parallel_job = true;
+    int nb_processed = 0;
+    for (int i = state->next_job++; i < nb_jobs; i = state->next_job++) {
+      // a failed job is done as well, otherwise the caller would wait forever
+      try {
+        job_copy(i);
+      } catch (...) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (!state->error)
+          state->error = std::current_exception();
+      }
+      nb_processed++;
+    }
+    in_parallel_job = was_in_parallel_job;
+    if (nb_processed > 0) {
+      addBusyTime(start, nb_processed);
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->nb_done += nb_processed;
+      if (state->nb_done == nb_jobs)
+        state->done.notify_all();
+    }
+  };
+
+  // Submit one helper per worker (at most nb_jobs - 1)
+  int nb_helpers = std::min<int>(workers_.size(), nb_jobs - 1);
+  for (int i = 0; i < nb_helpers; i++)
+    push(run_jobs);
+
+  // The caller processes jobs as well, then waits for the helpers
+  run_jobs();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done.wait(lock,
+                   [&state, nb_jobs] { return state->nb_done == nb_jobs; });
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
+
+/**
+ * @brief Set the thread budget of the calling thread
+ *
+ * @param nb_threads budget until the end of the scope
+ */
+ThreadBudget::ThreadBudget(int nb_threads)
+    : previous_budget_(ThreadPool::setThreadBudget(nb_threads)) {}
+
+/**
+ * @brief Restore the previous thread budget
+ *
+ */
+ThreadBudget::~ThreadBudget() { ThreadPool::setThreadBudget(previous_budget_); }
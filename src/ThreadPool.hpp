@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ *
+ * @brief Fixed-size work-stealing pool of worker threads shared by the
+ * calibration stages
+ *
+ * Independent jobs (e.g. the refinement of each camera) are distributed over
+ * the workers with parallelFor. The calling thread also processes jobs, so
+ * nested calls cannot dead-lock and a pool of size 1 runs everything serially
+ * on the caller.
+ *
+ * Every worker owns a queue: the tasks submitted by a worker (nested
+ * parallelFor) are pushed to its own queue and processed last-in first-out,
+ * the idle workers steal the oldest tasks of the other queues.
+ *
+ * A task inherits the tag of the thread submitting it (setTaskTag), which
+ * lets the profiler attribute the work of the jobs to the stage running them.
+ *
+ * The libraries parallelized internally (Ceres) use the thread budget of the
+ * calling thread: 1 in the jobs of a parallelFor, the share of the pool given
+ * to the running stage otherwise (ThreadBudget).
+ */
+class ThreadPool {
+public:
+  // Usage of the pool since its creation
+  struct Stats {
+    double busy_time = 0.0; // time spent running jobs, summed over threads
+    long nb_jobs = 0;       // number of jobs run
+    long nb_steals = 0;     // number of tasks taken from another worker
+  };
+
+  // Functions
+  ThreadPool(int nb_threads);
+  ~ThreadPool();
+  int getNbThreads() const;
+  void parallelFor(int nb_jobs, const std::function<void(int)> &job);
+  void submit(std::function<void()> task);
+  Stats getStats() const;
+  static bool isInParallelJob();
+  static int getTaskTag();
+  static void setTaskTag(int tag);
+  static int getThreadBudget();
+  static int setThreadBudget(int nb_threads);
+
+private:
+  // Tasks of one worker
+  struct WorkQueue {
+    std::mutex mutex;                        // protect the tasks
+    std::deque<std::function<void()>> tasks; // pending tasks
+  };
+
+  std::vector<std::thread> workers_;               // worker threads
+  std::vector<std::unique_ptr<WorkQueue>> queues_; // one queue per worker
+  std::mutex mutex_;                  // protect the sleep of the workers
+  std::condition_variable condition_; // wake up the workers
+  std::atomic<int> nb_pending_{0};    // tasks waiting in the queues
+  std::atomic<int> next_queue_{0};    // queue of the next external task
+  bool stop_ = false;                 // stop flag for the workers
+
+  // Statistics
+  std::atomic<long long> busy_ns_{0}; // time spent in the jobs (ns)
+  std::atomic<long> nb_jobs_{0};      // jobs run
+  std::atomic<long> nb_steals_{0};    // stolen tasks
+
+  void workerLoop(int worker_idx);
+  void push(std::function<void()> task);
+  bool pop(int worker_idx, std::function<void()> &task);
+  void addBusyTime(std::chrono::steady_clock::time_point start, int nb_jobs);
+};
+
+/**
+ * @class ThreadBudget
+ *
+ * @brief Set the thread budget of the calling thread until the scope ends
+ *
+ *   {
+ *     ThreadBudget budget(thread_pool->getNbThreads());
+ *     solveProblem(...); // the solver can use all the threads of the pool
+ *   }
+ */
+class ThreadBudget {
+public:
+  // Functions
+  ThreadBudget(int nb_threads);
+  ~ThreadBudget();
+
+private:
+  int previous_budget_; // budget of the thread before the scope
+};
@@ -0,0 +1,155 @@
+#include <algorithm>
+
+#include "TraceSink.hpp"
+#include "logger.h"
+
+/**
+ * @brief Get the global trace sink
+ *
+ * @return sink shared by all the threads
+ */
+TraceSink &TraceSink::get() {
+  static TraceSink sink;
+  return sink;
+}
+
+/**
+ * @brief Start recording the events, they are written in file_path when the
+ * sink is closed
+ *
+ * The calling thread (the one running the workflow) gets the thread index 0.
+ *
+ * @param file_path path of the output file
+ */
+void TraceSink::open(std::string file_path) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  file_path_ = file_path;
+  start_ = std::chrono::steady_clock::now();
+  events_.clear();
+  nb_threads_.store(0);
+  generation_.fetch_add(1);
+  getThreadIndex();
+  enabled_.store(true);
+}
+
+/**
+ * @brief Stop recording and write the events in the Chrome trace event format
+ *
+ */
+void TraceSink::close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!enabled_.exchange(false))
+    return;
+
+  std::ofstream file(file_path_, std::ofstream::out | std::ofstream::trunc);
+  if (!file.is_open()) {
+    LOG_ERROR << "Cannot write the trace " << file_path_;
+    return;
+  }
+
+  int nb_threads = 0;
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t i = 0; i < events_.size(); i++) {
+    const Event &event = events_[i];
+    nb_threads = std::max(nb_threads, event.thread + 1);
+    file << (i > 0 ? ",\n" : "\n") << "{\"name\":\"" << event.name
+         << "\",\"cat\":\"" << event.category
+         << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+         << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+    if (!event.args.empty())
+      file << ",\"args\":{" << event.args << "}";
+    file << "}";
+  }
+  // name the threads (the thread 0 is the one running the workflow)
+  for (int thread = 0; thread < nb_threads; thread++)
+    file << (events_.empty() ? "\n" : ",\n")
+         << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":"
+         << thread << ",\"args\":{\"name\":\"thread " << thread << "\"}}";
+  file << "\n]}\n";
+  LOG_INFO << "Trace of " << events_.size() << " events saved in "
+           << file_path_;
+  events_.clear();
+}
+
+/**
+ * @brief Get the time elapsed since the opening of the sink
+ *
+ * @return time in microseconds
+ */
+long TraceSink::getTime() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start_)
+      .count();
+}
+
+/**
+ * @brief Add a finished event to the trace
+ *
+ * @param event event to be added
+ */
+void TraceSink::addEvent(Event &&event) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (enabled_.load(std::memory_order_relaxed))
+    events_.push_back(std::move(event));
+}
+
+/**
+ * @brief Get a small index identifying the calling thread in the trace
+ *
+ * The indices restart at each opening of the sink: 0 for the thread opening
+ * the sink, then in the order of the first event of each thread.
+ *
+ * @return index of the thread
+ */
+int TraceSink::getThreadIndex() {
+  TraceSink &sink = get();
+  thread_local int thread_generation = -1;
+  thread_local int thread_index = 0;
+  const int generation = sink.generation_.load();
+  if (thread_generation != generation) {
+    thread_generation = generation;
+    thread_index = sink.nb_threads_.fetch_add(1);
+  }
+  return thread_index;
+}
+
+/**
+ * @brief Start an event if the sink is open
+ *
+ * @param name name of the event
+ * @param category category of the event (stage, detection, ransac, solve)
+ */
+TraceScope::TraceScope(const char *name, const char *category)
+    : active_(TraceSink::get().isEnabled()) {
+  if (!active_)
+    return;
+  event_.name = name;
+  event_.category = category;
+  event_.thread = TraceSink::getThreadIndex();
+  event_.start = TraceSink::get().getTime();
+}
+
+/**
+ * @brief Add the event to the sink
+ *
+ */
+TraceScope::~TraceScope() {
+  if (!active_)
+    return;
+  event_.duration = TraceSink::get().getTime() - event_.start;
+  TraceSink::get().addEvent(std::move(event_));
+}
+
+/**
+ * @brief Add an argument (camera, frame, ...) displayed with the event
+ *
+ * @param key name of the argument
+ * @param value value of the argument
+ */
+void TraceScope::addArg(const char *key, long value) {
+  if (!active_)
+    return;
+  if (!event_.args.empty())
+    event_.args += ",";
+  event_.args += "\"" + std::string(key) + "\":" + std::to_string(value);
+}
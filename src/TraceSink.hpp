@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class TraceSink
+ *
+ * @brief Global record of the timeline of the calibration
+ *
+ * When the sink is open, every TraceScope adds an event (name, category,
+ * start, duration and thread) to the sink. The events are written in the
+ * Chrome trace event format when the sink is closed, the file can be opened
+ * in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ */
+class TraceSink {
+public:
+  // One complete event of the trace
+  struct Event {
+    std::string name;     // name of the event
+    const char *category; // category of the event (stage, solve, ...)
+    long start;           // start in microseconds since the opening
+    long duration;        // duration in microseconds
+    int thread;           // index of the thread running the event
+    std::string args;     // JSON members of the arguments (can be empty)
+  };
+
+  // Functions
+  static TraceSink &get();
+  void open(std::string file_path);
+  void close();
+  bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+  long getTime() const;
+  void addEvent(Event &&event);
+  static int getThreadIndex();
+
+private:
+  TraceSink(){};
+  std::atomic<bool> enabled_{false}; // checked by every TraceScope
+  std::mutex mutex_;                 // the events can be added concurrently
+  std::string file_path_;            // output file written when closing
+  std::chrono::steady_clock::time_point start_; // origin of the timestamps
+  std::vector<Event> events_;                   // recorded events
+  std::atomic<int> generation_{0}; // incremented at each opening
+  std::atomic<int> nb_threads_{0}; // threads indexed since the opening
+};
+
+/**
+ * @class TraceScope
+ *
+ * @brief Record an event of the trace lasting until the scope is destroyed
+ *
+ *   {
+ *     TraceScope trace("detect_boards", "detection");
+ *     trace.addArg("camera", cam_idx);
+ *     detectBoards(...);
+ *   }
+ *
+ * When the sink is closed, the scope only checks a flag and records nothing.
+ */
+class TraceScope {
+public:
+  // Functions
+  TraceScope(const char *name, const char *category);
+  ~TraceScope();
+  void addArg(const char *key, long value);
+
+private:
+  bool active_;              // true if the sink was open at the creation
+  TraceSink::Event event_;   // event filled while the scope is active
+};
@@ -1,8 +1,10 @@
 #include "opencv2/core/core.hpp"
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include <random>
 #include <stdio.h>
 
+#include "PerfCounters.hpp"
 #include "geometrytools.hpp"
 #include "logger.h"
 
@@ -81,15 +83,15 @@ std::vector<float> ProjToVec(cv::Mat Proj) // Projection matrix to float vector
 
 // Invert vector representation
 void invertRvecT(cv::Mat Rvec, cv::Mat T, cv::Mat &iR, cv::Mat &iT) {
-  cv::Mat Proj = RVecT2Proj(Rvec, T);
-  Proj = Proj.inv();
-  Proj2RT(Proj, iR, iT);
+  Pose inv_pose = Pose::fromRVecT(Rvec, T).inverse();
+  iR = inv_pose.getRotVecMat();
+  iT = inv_pose.getTransVecMat();
 }
 
 void invertRvecT(cv::Mat &Rvec, cv::Mat &T) {
-  cv::Mat Proj = RVecT2Proj(Rvec, T);
-  Proj = Proj.inv();
-  Proj2RT(Proj, Rvec, T);
+  Pose inv_pose = Pose::fromRVecT(Rvec, T).inverse();
+  Rvec = inv_pose.getRotVecMat();
+  T = inv_pose.getTransVecMat();
 }
 
 // My SVD triangulation
@@ -160,8 +162,8 @@ void ransacTriangulation(std::vector<cv::Point2f> point2d,
   int BestInNb = 0;
   double myepsilon = 0.00001; // small value for numerical problem
 
-  // Vector of index to shuffle
-  std::srand(unsigned(std::time(0)));
+  // Vector of index to shuffle (local engine: this runs on several threads)
+  std::mt19937 rng(0);
   std::vector<int> myvector;
   for (unsigned int i = 0; i < point2d.size(); ++i)
     myvector.push_back(i); // 1 2 3 4 5 6 7 8 9
@@ -169,7 +171,7 @@ void ransacTriangulation(std::vector<cv::Point2f> point2d,
   // Ransac iterations
   while (N > trialcount && countit < it) {
     // pick 2 points
-    std::random_shuffle(myvector.begin(), myvector.end());
+    std::shuffle(myvector.begin(), myvector.end(), rng);
     std::vector<int> idx;
     idx.push_back(myvector[0]);
     idx.push_back(myvector[1]);
@@ -238,6 +240,7 @@ cv::Mat ransacP3P(std::vector<cv::Point3f> scenePoints,
                   std::vector<cv::Point2f> imagePoints, cv::Mat Intrinsic,
                   cv::Mat Disto, cv::Mat &BestR, cv::Mat &BestT, double thresh,
                   double p, int it, bool refine) {
+  PerfScope perf("ransac_p3p");
 
   // Init parameters
   int N = it;
@@ -249,8 +252,8 @@ cv::Mat ransacP3P(std::vector<cv::Point3f> scenePoints,
   cv::Mat Rot(1, 3, CV_64F);
   cv::Mat Trans(1, 3, CV_64F);
 
-  // Vector of index to shuffle
-  std::srand(unsigned(std::time(0)));
+  // Vector of index to shuffle (local engine: this runs on several threads)
+  std::mt19937 rng(0);
   std::vector<int> myvector;
   for (unsigned int i = 0; i < imagePoints.size(); ++i)
     myvector.push_back(i); // 1 2 3 4 5 6 7 8 9
@@ -259,7 +262,7 @@ cv::Mat ransacP3P(std::vector<cv::Point3f> scenePoints,
   while (N > trialcount && countit < it) {
 
     // pick 4 points
-    std::random_shuffle(myvector.begin(), myvector.end());
+    std::shuffle(myvector.begin(), myvector.end(), rng);
     std::vector<int> idx;
     idx.push_back(myvector[0]);
     idx.push_back(myvector[1]);
@@ -336,31 +339,16 @@ cv::Mat ransacP3P(std::vector<cv::Point3f> scenePoints,
 
 std::vector<cv::Point3f> transform3DPts(std::vector<cv::Point3f> pts3D,
                                         cv::Mat Rot, cv::Mat Trans) {
-  cv::Mat RotM;
-  cv::Rodrigues(Rot, RotM);
-  double r11 = RotM.at<double>(0, 0);
-  double r12 = RotM.at<double>(0, 1);
-  double r13 = RotM.at<double>(0, 2);
-  double r21 = RotM.at<double>(1, 0);
-  double r22 = RotM.at<double>(1, 1);
-  double r23 = RotM.at<double>(1, 2);
-  double r31 = RotM.at<double>(2, 0);
-  double r32 = RotM.at<double>(2, 1);
-  double r33 = RotM.at<double>(2, 2);
-  double tx = Trans.at<double>(0);
-  double ty = Trans.at<double>(1);
-  double tz = Trans.at<double>(2);
-
-  for (int i = 0; i < pts3D.size(); i++) {
-    float x = tx + r11 * pts3D[i].x + r12 * pts3D[i].y + r13 * pts3D[i].z;
-    float y = ty + r21 * pts3D[i].x + r22 * pts3D[i].y + r23 * pts3D[i].z;
-    float z = tz + r31 * pts3D[i].x + r32 * pts3D[i].y + r33 * pts3D[i].z;
-    pts3D[i].x = x;
-    pts3D[i].y = y;
-    pts3D[i].z = z;
-  }
+  return transform3DPts(pts3D, Pose::fromRVecT(Rot, Trans));
+}
 
-  return pts3D;
+std::vector<cv::Point3f> transform3DPts(const std::vector<cv::Point3f> &pts3D,
+                                        const Pose &pose) {
+  std::vector<cv::Point3f> pts3D_trans;
+  pts3D_trans.reserve(pts3D.size());
+  for (const cv::Point3f &pt : pts3D)
+    pts3D_trans.push_back(pose * pt);
+  return pts3D_trans;
 }
 
 /**
@@ -473,7 +461,6 @@ cv::Mat handeyeBootstratpTranslationCalibration(
         }
       }
       // randomly select an index in the occurrences of the cluster
-      srand(time(NULL));
       std::random_device rd;
       std::mt19937 gen(rd());
       std::uniform_int_distribution<> dis(0, idx.size() - 1);
@@ -6,6 +6,8 @@
 #include <random>
 #include <stdio.h>
 
+#include "Pose.hpp"
+
 cv::Mat RT2Proj(cv::Mat R, cv::Mat T);
 cv::Mat RVecT2Proj(cv::Mat RVec, cv::Mat T);
 cv::Mat RVecT2ProjInt(cv::Mat RVec, cv::Mat T, cv::Mat K);
@@ -31,6 +33,8 @@ cv::Mat ransacP3P(std::vector<cv::Point3f> scene_points,
                   double thresh, double p, int it, bool refine);
 std::vector<cv::Point3f> transform3DPts(std::vector<cv::Point3f> pts3D,
                                         cv::Mat rot, cv::Mat trans);
+std::vector<cv::Point3f> transform3DPts(const std::vector<cv::Point3f> &pts3D,
+                                        const Pose &pose);
 cv::Mat handeyeCalibration(std::vector<cv::Mat> pose_abs_1,
                            std::vector<cv::Mat> pose_abs_2);
 cv::Mat handeyeBootstratpTranslationCalibration(
@@ -4,6 +4,9 @@
 #include <boost/log/core/core.hpp>
 #include <boost/log/expressions.hpp>
 #include <boost/log/expressions/formatters/date_time.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
+#include <boost/log/sinks/block_on_overflow.hpp>
 #include <boost/log/sinks/sync_frontend.hpp>
 #include <boost/log/sinks/text_ostream_backend.hpp>
 #include <boost/log/sources/severity_logger.hpp>
@@ -12,6 +15,7 @@
 #include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/shared_ptr.hpp>
+#include <atomic>
 #include <fstream>
 #include <ostream>
 
@@ -26,6 +30,42 @@ BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
 BOOST_LOG_ATTRIBUTE_KEYWORD(severity, "Severity",
                             logging::trivial::severity_level)
 
+// messages dropped because the queue of the logfile was full
+static std::atomic<unsigned long> nb_dropped_records(0);
+
+// Overflow strategy of the logfile queue: the warnings and the errors wait for
+// space in the queue, the other messages are dropped (and counted) so the
+// logging threads do not wait for the file
+class block_warnings_on_overflow : public sinks::block_on_overflow {
+public:
+  template <typename LockT>
+  bool on_overflow(const logging::record_view &rec, LockT &lock) {
+    logging::value_ref<logging::trivial::severity_level, tag::severity> level =
+        rec[severity];
+    if (level && level.get() >= logging::trivial::warning)
+      return sinks::block_on_overflow::on_overflow(rec, lock);
+    nb_dropped_records.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+};
+
+// bounded queue, written by a dedicated thread
+typedef sinks::asynchronous_sink<
+    sinks::text_ostream_backend,
+    sinks::bounded_fifo_queue<LOGFILE_QUEUE_SIZE, block_warnings_on_overflow>>
+    file_sink;
+
+/**
+ * @brief Get the asynchronous sink writing the logfile
+ *
+ * @return sink shared by the logger and flushLogger
+ */
+static boost::shared_ptr<file_sink> getLogfileSink() {
+  static boost::shared_ptr<file_sink> logfile_sink =
+      boost::make_shared<file_sink>();
+  return logfile_sink;
+}
+
 BOOST_LOG_GLOBAL_LOGGER_INIT(logger, src::severity_logger_mt) {
   src::severity_logger_mt<boost::log::trivial::severity_level> logger;
 
@@ -35,18 +75,20 @@ BOOST_LOG_GLOBAL_LOGGER_INIT(logger, src::severity_logger_mt) {
   logger.add_attribute("TimeStamp",
                        attrs::local_clock()); // each log line gets a timestamp
 
-  // add a text sink
+  // the console is written synchronously (few messages, kept in order with
+  // the other outputs)
   typedef sinks::synchronous_sink<sinks::text_ostream_backend> text_sink;
   boost::shared_ptr<text_sink> sink = boost::make_shared<text_sink>();
 
-  // add a logfile stream to our sink
-  sink->locked_backend()->add_stream(
-      boost::make_shared<std::ofstream>(LOGFILE));
-
   // add "console" output stream to our sink
   sink->locked_backend()->add_stream(
       boost::shared_ptr<std::ostream>(&std::clog, boost::null_deleter()));
 
+  // the logfile is written by a dedicated thread
+  boost::shared_ptr<file_sink> logfile_sink = getLogfileSink();
+  logfile_sink->locked_backend()->add_stream(
+      boost::make_shared<std::ofstream>(LOGFILE));
+
   // specify the format of the log message
   logging::formatter formatter =
       expr::stream << std::setw(7) << std::setfill('0') << line_id
@@ -56,12 +98,32 @@ BOOST_LOG_GLOBAL_LOGGER_INIT(logger, src::severity_logger_mt) {
                    << "[" << logging::trivial::severity << "]"
                    << " - " << expr::smessage;
   sink->set_formatter(formatter);
+  logfile_sink->set_formatter(formatter);
 
-  // only messages with severity >= SEVERITY_THRESHOLD are written
-  sink->set_filter(severity >= SEVERITY_THRESHOLD);
+  // only messages with severity >= SEVERITY_THRESHOLD are written, the core
+  // rejects the others before their message is formatted
+  logging::core::get()->set_filter(severity >= SEVERITY_THRESHOLD);
 
-  // "register" our sink
+  // "register" our sinks
   logging::core::get()->add_sink(sink);
+  logging::core::get()->add_sink(logfile_sink);
 
   return logger;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Write the messages waiting in the queue of the logfile and stop its
+ * thread
+ *
+ * The number of messages dropped because the queue was full is logged first.
+ */
+void flushLogger() {
+  const unsigned long nb_dropped = nb_dropped_records.load();
+  if (nb_dropped > 0)
+    LOG_WARNING << nb_dropped << " messages below the warnings were dropped "
+                << "from " << LOGFILE << " (full queue)";
+  boost::shared_ptr<file_sink> logfile_sink = getLogfileSink();
+  logging::core::get()->remove_sink(logfile_sink);
+  logfile_sink->stop();
+  logfile_sink->flush();
+}
@@ -15,20 +15,55 @@
 // just log messages with severity >= SEVERITY_THRESHOLD are written
 #define SEVERITY_THRESHOLD logging::trivial::info
 
+// the messages with a lower severity are removed at compile time
+// (0: trace, 1: debug, 2: info, 3: warning, 4: error, 5: fatal)
+#ifndef LOG_MIN_SEVERITY
+#ifdef NDEBUG
+#define LOG_MIN_SEVERITY 2
+#else
+#define LOG_MIN_SEVERITY 0
+#endif
+#endif
+
+// maximum number of messages waiting to be written in LOGFILE, the messages
+// are dropped when the queue is full so the logging threads never wait
+#define LOGFILE_QUEUE_SIZE 4096
+
 // register a global logger
 BOOST_LOG_GLOBAL_LOGGER(logger, boost::log::sources::severity_logger_mt<
                                     boost::log::trivial::severity_level>)
 
+// write the messages waiting in the queue of LOGFILE (call before exiting)
+void flushLogger();
+
 // just a helper macro used by the macros below - don't use it in your code
+// (the message is only formatted if its severity passes the filter)
 #define LOG(severity)                                                          \
   BOOST_LOG_SEV(logger::get(), boost::log::trivial::severity)
 
+// the message is still type-checked but never evaluated
+#define LOG_DISABLED(severity)                                                 \
+  while (false)                                                                \
+  LOG(severity)
+
 // ===== log macros =====
+#if LOG_MIN_SEVERITY > 0
+#define LOG_TRACE LOG_DISABLED(trace)
+#else
 #define LOG_TRACE LOG(trace)
+#endif
+#if LOG_MIN_SEVERITY > 1
+#define LOG_DEBUG LOG_DISABLED(debug)
+#else
 #define LOG_DEBUG LOG(debug)
+#endif
+#if LOG_MIN_SEVERITY > 2
+#define LOG_INFO LOG_DISABLED(info)
+#else
 #define LOG_INFO LOG(info)
+#endif
 #define LOG_WARNING LOG(warning)
 #define LOG_ERROR LOG(error)
 #define LOG_FATAL LOG(fatal)
 
-#endif
\ No newline at end of file
+#endif
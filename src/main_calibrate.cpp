@@ -6,94 +6,179 @@
 #include "Board.hpp"
 #include "BoardObs.hpp"
 #include "Calibration.hpp"
+#include "CalibrationSession.hpp"
 #include "Camera.hpp"
 #include "CameraObs.hpp"
 #include "Frame.hpp"
+#include "Pipeline.hpp"
+#include "StageProfiler.hpp"
+#include "TraceSink.hpp"
 
 #include "logger.h"
 
-void runCalibrationWorkflow(std::string config_path) {
+bool runCalibrationWorkflow(std::string config_path, std::string resume_from,
+                            bool incremental) {
   // Instantiate the calibration and initialize the parameters
   Calibration Calib;
   Calib.initialization(config_path);
-  Calib.boardExtraction();
-  LOG_INFO << "Board extraction done!";
-
-  // Intrinsic calibration of the cameras
-  LOG_INFO << "Intrinsic calibration initiated";
-  Calib.initIntrinsic();
-  LOG_INFO << "Intrinsic Calibration done!";
-
-  // Calibrate 3D Objects
-  LOG_INFO << "3D Object calibration initiated";
-  Calib.calibrate3DObjects();
-  LOG_INFO << "3D Object calibration done!";
-
-  // Calibrate camera groups
-  LOG_INFO << "Camera group calibration initiated";
-  Calib.calibrateCameraGroup();
-  LOG_INFO << "Camera group calibration done!";
-
-  // Merge objects again to deal with boards visible simultaneously from camera
-  // groups
-  Calib.merge3DObjects();
-
-  // Calibrate Non-Overlapping cameras
-  LOG_INFO << "Non-overlapping calibration initiated";
-  Calib.findPairObjectForNonOverlap();
-  Calib.findPoseNoOverlapAllCamGroup();
-  LOG_INFO << "Non-overlapping calibration done!";
-
-  // merge camera groups 1
-  LOG_INFO << "Merge cameras and objets initiated";
-  Calib.initInterCamGroupGraph();
-  Calib.mergeCameraGroup();
-  Calib.mergeAllCameraGroupObs();
-  // Merge objects
-  Calib.merge3DObjects();
-  // merge camera groups 2
-  Calib.initInterCamGroupGraph();
-  Calib.mergeCameraGroup();
-  Calib.mergeAllCameraGroupObs();
-  Calib.estimatePoseAllObjects();
-  Calib.computeAllObjPoseInCameraGroup();
-  LOG_INFO << "Merge cameras and objets done!";
-
-  // Final Optimization
-  LOG_INFO << "Final refinement initiated";
-  // Calib.reproErrorAllCamGroup(); // this is just to check the reprojection
-  // error before optimization Calib.refineAllCameraGroup(); // Refine Camera
-  // only
-  Calib.refineAllCameraGroupAndObjects();
-  // Optimize everything including intrinsics
-  if (Calib.fix_intrinsic_==0)
-  {
-    Calib.refineAllCameraGroupAndObjectsAndIntrinsic();
+  std::function<std::map<std::string, long>()> counts = [&Calib]() {
+    return Calib.getStageCounts();
+  };
+
+  // Reload the state saved before the first stage to run, or the previous
+  // calibration to update
+  if (!resume_from.empty() || incremental) {
+    bool resumed;
+    {
+      StageProfiler profiler("load_checkpoint", counts);
+      resumed = incremental ? Calib.loadPreviousCalibration()
+                            : Calib.resumeCalibration(resume_from);
+    }
+    if (!resumed) {
+      TraceSink::get().close();
+      return false;
+    }
   }
 
-  Calib.reproErrorAllCamGroup();
-  LOG_INFO << "Final refinement done";
+  // Stages of the calibration and their dependencies
+  Pipeline pipeline(Calib.thread_pool_);
+  pipeline.setStageCounts(counts);
+  int calibration_done = Calib.addCalibrationStages(pipeline, resume_from);
+
+  // The results are saved concurrently once the calibration is done
+  pipeline.addStage(
+      "save_images",
+      [&Calib]() {
+        if (Calib.save_detect_ == 1)
+          Calib.saveDetectionAllCam();
+        if (Calib.save_repro_ == 1)
+          Calib.saveReprojectionAllCam();
+      },
+      {calibration_done});
+  pipeline.addStage(
+      "save_parameters",
+      [&Calib]() {
+        LOG_INFO << "Save parameters";
+        Calib.saveCamerasParams();
+        Calib.save3DObj();
+        Calib.save3DObjPose();
+        Calib.saveReprojectionErrorToFile();
+      },
+      {calibration_done});
+  pipeline.addStage(
+      "average_reprojection_error",
+      [&Calib]() {
+        double avg_reprojection_error = Calib.computeAvgReprojectionError();
+        LOG_INFO << "mean reprojection error :: " << avg_reprojection_error
+                 << std::endl;
+      },
+      {calibration_done});
+
+  pipeline.run(Calib.serial_pipeline_ == 1);
+  Calib.parameter_arena_->logMemoryReport();
+
+  // Time and resources used by each stage
+  StageReport::get().write(Calib.save_path_ + "profile_report.json");
+  StageReport::get().logSummary();
+  TraceSink::get().close();
+  return true;
+}
 
-  // Save images reprojection
-  if (Calib.save_detect_ == 1)
-    Calib.saveDetectionAllCam();
-  if (Calib.save_repro_ == 1)
-    Calib.saveReprojectionAllCam();
+bool runSessionWorkflow(std::string config_path) {
+  // Instantiate the calibration and initialize the parameters
+  std::shared_ptr<Calibration> Calib = std::make_shared<Calibration>();
+  Calib->initialization(config_path);
+  std::function<std::map<std::string, long>()> counts = [Calib]() {
+    return Calib->getStageCounts();
+  };
+
+  CalibrationSession session(Calib);
+  bool started;
+  {
+    StageProfiler profiler("load_checkpoint", counts);
+    started = session.start(true);
+  }
+  if (!started) {
+    TraceSink::get().close();
+    return false;
+  }
+
+  // Replay the images added since the previous calibration as a capture: the
+  // images of the cameras are synchronized by their position in the folders
+  std::map<int, std::vector<cv::String>> fn;
+  size_t first_frame = 0, count_frame = 0;
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it =
+           Calib->cams_.begin();
+       it != Calib->cams_.end(); ++it) {
+    fn[it->first] = Calib->getCameraImages(it->first);
+    count_frame = std::max(count_frame, fn[it->first].size());
+    if (Calib->calibrated_cameras_.count(it->first) > 0)
+      first_frame = std::max(first_frame, size_t(it->second->nb_images_));
+  }
+  {
+    StageProfiler profiler("session", counts, Calib->thread_pool_.get());
+    for (size_t frameind = first_frame; frameind < count_frame; frameind++) {
+      std::vector<cv::Mat> images(Calib->cams_.size());
+      std::vector<std::string> frame_paths(Calib->cams_.size());
+      for (std::map<int, std::vector<cv::String>>::iterator it = fn.begin();
+           it != fn.end(); ++it) {
+        if (frameind >= it->second.size())
+          continue;
+        images[it->first] = cv::imread(it->second[frameind]);
+        frame_paths[it->first] = it->second[frameind];
+      }
+      CalibrationSession::FrameReport report =
+          session.pushFrameSet(images, frame_paths);
+      LOG_INFO << "Frame " << report.frame_idx << ": " << report.nb_boards
+               << " boards, keyframe " << report.keyframe << ", latency "
+               << report.latency << " s";
+    }
+  }
+  {
+    StageProfiler profiler("final_refinement", counts,
+                           Calib->thread_pool_.get());
+    session.finish();
+  }
 
-  // Save camera parameters
   LOG_INFO << "Save parameters";
-  Calib.saveCamerasParams();
-  Calib.save3DObj();
-  Calib.save3DObjPose();
-  Calib.saveReprojectionErrorToFile();
+  Calib->saveCamerasParams();
+  Calib->save3DObj();
+  Calib->save3DObjPose();
+  Calib->saveReprojectionErrorToFile();
   LOG_INFO << "mean reprojection error :: "
-           << Calib.computeAvgReprojectionError() << std::endl;
+           << Calib->computeAvgReprojectionError() << std::endl;
+  Calib->parameter_arena_->logMemoryReport();
+
+  // Time and resources used by each stage
+  StageReport::get().write(Calib->save_path_ + "profile_report.json");
+  StageReport::get().logSummary();
+  TraceSink::get().close();
+  return true;
 }
 
 int main(int argc, char *argv[]) {
+  std::string resume_from;
+  bool incremental = false;
+  bool session = false;
+  if (argc == 4 && std::string(argv[2]) == "--resume-from") {
+    resume_from = argv[3];
+  } else if (argc == 3 && std::string(argv[2]) == "--incremental") {
+    incremental = true;
+  } else if (argc == 3 && std::string(argv[2]) == "--session") {
+    session = true;
+  } else if (argc != 2) {
+    LOG_ERROR << "Usage: " << argv[0]
+              << " <config_path> [--resume-from <stage> | --incremental | "
+              << "--session]";
+    flushLogger();
+    return 1;
+  }
   std::string config_path = argv[1];
 
-  runCalibrationWorkflow(config_path);
+  bool done = session ? runSessionWorkflow(config_path)
+                      : runCalibrationWorkflow(config_path, resume_from,
+                                               incremental);
+  flushLogger();
 
-  return 0;
+  return done ? 0 : 1;
 }
\ No newline at end of file
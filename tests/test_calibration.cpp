@@ -1,6 +1,10 @@
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <cstdio>
 #include <iomanip>
+#include <sstream>
 #include <opencv2/aruco/charuco.hpp>
 #include <opencv2/opencv.hpp>
 #include <stdio.h>
@@ -8,9 +12,12 @@
 #include <../src/Board.hpp>
 #include <../src/BoardObs.hpp>
 #include <../src/Calibration.hpp>
+#include <../src/CalibrationSession.hpp>
 #include <../src/Camera.hpp>
 #include <../src/CameraObs.hpp>
 #include <../src/Frame.hpp>
+#include <../src/Object3D.hpp>
+#include <../src/Pipeline.hpp>
 
 // Reference: https://stackoverflow.com/a/17503436
 #define CHECK_CLOSE_COLLECTION(aa, bb, tolerance)                              \
@@ -26,6 +33,17 @@
     }                                                                          \
   }
 
+// Run all the stages of the calibration as the calibrate application does
+std::shared_ptr<Calibration> runCalibration(std::string config_path,
+                                            bool serial) {
+  std::shared_ptr<Calibration> Calib = std::make_shared<Calibration>();
+  Calib->initialization(config_path);
+  Pipeline pipeline(Calib->thread_pool_);
+  BOOST_REQUIRE(Calib->addCalibrationStages(pipeline, "") >= 0);
+  pipeline.run(serial);
+  return Calib;
+}
+
 void calibrateAndCheckGt(std::string config_path, std::string gt_path) {
   Calibration Calib;
   Calib.initialization(config_path);
@@ -125,6 +143,100 @@ void calibrateAndCheckGt(std::string config_path, std::string gt_path) {
   }
 }
 
+// Check that two calibrations of the same scenario agree: same camera
+// groups and objects, intrinsics and poses within the relative tolerance
+void checkSameCalibration(Calibration &ref, Calibration &calib,
+                          double tolerance) {
+  BOOST_REQUIRE_EQUAL(ref.cams_.size(), calib.cams_.size());
+  BOOST_REQUIRE_EQUAL(ref.cam_group_.size(), calib.cam_group_.size());
+  for (std::map<int, std::shared_ptr<Camera>>::iterator it = ref.cams_.begin();
+       it != ref.cams_.end(); ++it) {
+    const int cam_idx = it->first;
+    const int cam_group_idx = ref.getCameraGroupIdx(cam_idx);
+    BOOST_REQUIRE_EQUAL(cam_group_idx, calib.getCameraGroupIdx(cam_idx));
+
+    cv::Mat camera_matrix_ref, distortion_ref;
+    cv::Mat camera_matrix, distortion;
+    it->second->getIntrinsics(camera_matrix_ref, distortion_ref);
+    calib.cams_[cam_idx]->getIntrinsics(camera_matrix, distortion);
+    BOOST_CHECK_SMALL(cv::norm(camera_matrix_ref - camera_matrix),
+                      tolerance * cv::norm(camera_matrix_ref));
+
+    cv::Mat pose_ref = ref.cam_group_[cam_group_idx]->getCameraPoseMat(cam_idx);
+    cv::Mat pose = calib.cam_group_[cam_group_idx]->getCameraPoseMat(cam_idx);
+    BOOST_CHECK_SMALL(cv::norm(pose_ref - pose),
+                      tolerance * (1.0 + cv::norm(pose_ref)));
+  }
+
+  BOOST_REQUIRE_EQUAL(ref.object_3d_.size(), calib.object_3d_.size());
+  for (std::map<int, std::shared_ptr<Object3D>>::iterator it =
+           ref.object_3d_.begin();
+       it != ref.object_3d_.end(); ++it) {
+    BOOST_REQUIRE(calib.object_3d_.find(it->first) != calib.object_3d_.end());
+    std::shared_ptr<Object3D> object = calib.object_3d_[it->first];
+    BOOST_REQUIRE_EQUAL(it->second->boards_.size(), object->boards_.size());
+    for (std::map<int, std::weak_ptr<Board>>::iterator it_board =
+             it->second->boards_.begin();
+         it_board != it->second->boards_.end(); ++it_board) {
+      cv::Mat pose_ref = it->second->getBoardPoseMat(it_board->first);
+      cv::Mat pose = object->getBoardPoseMat(it_board->first);
+      BOOST_CHECK_SMALL(cv::norm(pose_ref - pose),
+                        tolerance * (1.0 + cv::norm(pose_ref)));
+    }
+  }
+
+  // the mean error is less sensitive than the parameters
+  const double error_ref = ref.computeAvgReprojectionError();
+  BOOST_CHECK_SMALL(std::abs(error_ref - calib.computeAvgReprojectionError()),
+                    10.0 * tolerance * error_ref);
+}
+
+// Compare the serial and the concurrent runs of the calibration stages
+void checkConcurrentPipeline(std::string config_path) {
+  std::shared_ptr<Calibration> serial = runCalibration(config_path, true);
+  std::shared_ptr<Calibration> concurrent = runCalibration(config_path, false);
+
+  // The boards are inserted in the same order in both modes, the results
+  // only differ by the scheduling of the concurrent solves
+  BOOST_REQUIRE_EQUAL(serial->board_observations_.size(),
+                      concurrent->board_observations_.size());
+  checkSameCalibration(*serial, *concurrent, 1e-3);
+}
+
+// Link the images [first, last) of each camera of a configuration in the
+// camera folders of root_dir (calib is initialized, root_dir_ not changed yet)
+void linkCameraImages(Calibration &calib, std::string root_dir, size_t first,
+                      size_t last) {
+  for (int cam_idx = 0; cam_idx < calib.nb_camera_; cam_idx++) {
+    std::vector<cv::String> fn = calib.getCameraImages(cam_idx);
+    std::stringstream ss;
+    ss << std::setw(3) << std::setfill('0') << cam_idx + 1;
+    boost::filesystem::path cam_dir(root_dir + calib.cam_prefix_ + ss.str());
+    boost::filesystem::create_directories(cam_dir);
+    for (size_t i = first; i < std::min(last, fn.size()); i++) {
+      boost::filesystem::path image(fn[i]);
+      boost::filesystem::create_symlink(boost::filesystem::absolute(image),
+                                        cam_dir / image.filename());
+    }
+  }
+}
+
+// Calibrate the first nb_frames images of a scenario and save the state after
+// the final refinement in root_dir, as a previous calibration
+void calibratePreviousImages(std::string config_path, std::string root_dir,
+                             size_t nb_frames) {
+  Calibration Calib;
+  Calib.initialization(config_path);
+  boost::filesystem::remove_all(root_dir);
+  linkCameraImages(Calib, root_dir, 0, nb_frames);
+  Calib.root_dir_ = root_dir;
+  Calib.save_path_ = root_dir;
+  Calib.checkpoint_stages_ = {"final_refinement"};
+  Pipeline pipeline(Calib.thread_pool_);
+  BOOST_REQUIRE(Calib.addCalibrationStages(pipeline, "") >= 0);
+  pipeline.run(true);
+}
+
 BOOST_AUTO_TEST_SUITE(CheckCalibration)
 
 BOOST_AUTO_TEST_CASE(CheckCalibrationSyntheticScenario1) {
@@ -134,6 +246,121 @@ BOOST_AUTO_TEST_CASE(CheckCalibrationSyntheticScenario1) {
   calibrateAndCheckGt(config_path, gt_path);
 }
 
+BOOST_AUTO_TEST_CASE(CheckCalibrationConcurrentPipelineScenario1) {
+  checkConcurrentPipeline("../configs/calib_param_synth_Scenario1.yml");
+}
+
+BOOST_AUTO_TEST_CASE(CheckCalibrationConcurrentPipelineScenario3) {
+  checkConcurrentPipeline("../configs/calib_param_synth_Scenario3.yml");
+}
+
+BOOST_AUTO_TEST_CASE(CheckCalibrationResumeFromCheckpoint) {
+  std::string config_path = "../configs/calib_param_synth_Scenario1.yml";
+  const std::string checkpoint_stage = "camera_group_calibration";
+  const std::string resume_stage = "merge_3d_objects";
+
+  // Uninterrupted run saving a checkpoint
+  std::shared_ptr<Calibration> full = std::make_shared<Calibration>();
+  full->initialization(config_path);
+  full->checkpoint_stages_ = {checkpoint_stage};
+  {
+    Pipeline pipeline(full->thread_pool_);
+    BOOST_REQUIRE(full->addCalibrationStages(pipeline, "") >= 0);
+    pipeline.run(true);
+  }
+
+  // Run resumed from the checkpoint
+  std::shared_ptr<Calibration> resumed = std::make_shared<Calibration>();
+  resumed->initialization(config_path);
+  resumed->checkpoint_stages_.clear();
+  BOOST_REQUIRE(resumed->resumeCalibration(resume_stage));
+  {
+    Pipeline pipeline(resumed->thread_pool_);
+    BOOST_REQUIRE(resumed->addCalibrationStages(pipeline, resume_stage) >= 0);
+    pipeline.run(true);
+  }
+
+  BOOST_REQUIRE_EQUAL(full->board_observations_.size(),
+                      resumed->board_observations_.size());
+  checkSameCalibration(*full, *resumed, 1e-6);
+  std::remove(full->getCheckpointPath(checkpoint_stage).c_str());
+}
+
+BOOST_AUTO_TEST_CASE(CheckCalibrationIncremental) {
+  std::string config_path = "../configs/calib_param_synth_Scenario1.yml";
+  const std::string root_dir = "test_incremental/";
+  std::shared_ptr<Calibration> batch = runCalibration(config_path, true);
+  const size_t nb_frames = batch->cams_.begin()->second->nb_images_;
+
+  // The second half of the images is added after the previous calibration
+  calibratePreviousImages(config_path, root_dir, nb_frames / 2);
+  std::shared_ptr<Calibration> updated = std::make_shared<Calibration>();
+  updated->initialization(config_path);
+  linkCameraImages(*updated, root_dir, nb_frames / 2, nb_frames);
+  updated->root_dir_ = root_dir;
+  updated->save_path_ = root_dir;
+  updated->checkpoint_stages_.clear();
+  BOOST_REQUIRE(updated->loadPreviousCalibration());
+  BOOST_REQUIRE(updated->incremental_);
+  BOOST_REQUIRE(updated->nb_calibrated_board_obs_ > 0);
+  {
+    Pipeline pipeline(updated->thread_pool_);
+    BOOST_REQUIRE(updated->addCalibrationStages(pipeline, "") >= 0);
+    pipeline.run(true);
+  }
+
+  // The new observations are in the data structures and in the store
+  BOOST_REQUIRE_EQUAL(batch->board_observations_.size(),
+                      updated->board_observations_.size());
+  for (int cam_idx = 0; cam_idx < batch->nb_camera_; cam_idx++)
+    BOOST_REQUIRE_EQUAL(
+        batch->observation_store_.getCameraBoardObs(cam_idx).size(),
+        updated->observation_store_.getCameraBoardObs(cam_idx).size());
+  checkSameCalibration(*batch, *updated, 1e-2);
+  boost::filesystem::remove_all(root_dir);
+}
+
+BOOST_AUTO_TEST_CASE(CheckCalibrationSession) {
+  std::string config_path = "../configs/calib_param_synth_Scenario1.yml";
+  const std::string root_dir = "test_session/";
+  std::shared_ptr<Calibration> batch = runCalibration(config_path, true);
+  const size_t nb_frames = batch->cams_.begin()->second->nb_images_;
+
+  // The second half of the images is pushed to the session as a capture
+  calibratePreviousImages(config_path, root_dir, nb_frames / 2);
+  std::shared_ptr<Calibration> Calib = std::make_shared<Calibration>();
+  Calib->initialization(config_path);
+  std::vector<std::vector<cv::String>> fn(Calib->nb_camera_);
+  for (int cam_idx = 0; cam_idx < Calib->nb_camera_; cam_idx++)
+    fn[cam_idx] = Calib->getCameraImages(cam_idx);
+  Calib->root_dir_ = root_dir;
+  Calib->save_path_ = root_dir;
+  Calib->checkpoint_stages_.clear();
+
+  CalibrationSession session(Calib);
+  BOOST_REQUIRE(session.start(true));
+  for (size_t frame_idx = nb_frames / 2; frame_idx < nb_frames; frame_idx++) {
+    std::vector<cv::Mat> images(Calib->nb_camera_);
+    std::vector<std::string> frame_paths(Calib->nb_camera_);
+    for (int cam_idx = 0; cam_idx < Calib->nb_camera_; cam_idx++) {
+      if (frame_idx >= fn[cam_idx].size())
+        continue;
+      images[cam_idx] = cv::imread(fn[cam_idx][frame_idx]);
+      frame_paths[cam_idx] = fn[cam_idx][frame_idx];
+    }
+    CalibrationSession::FrameReport report =
+        session.pushFrameSet(images, frame_paths);
+    BOOST_REQUIRE_EQUAL(report.frame_idx, static_cast<int>(frame_idx));
+  }
+  BOOST_REQUIRE(session.getNbKeyframes() > 0);
+  BOOST_REQUIRE(session.finish());
+
+  // Only the keyframes are added, the solution must still be the one of the
+  // batch calibration
+  checkSameCalibration(*batch, *Calib, 1e-2);
+  boost::filesystem::remove_all(root_dir);
+}
+
 // BOOST_AUTO_TEST_CASE(CheckCalibrationSyntheticScenario3) {
 //   std::string config_path = "../configs/calib_param_synth_Scenario3.yml";
 //   std::string gt_path =
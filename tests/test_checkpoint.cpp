@@ -0,0 +1,108 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include <../src/Checkpoint.hpp>
+
+BOOST_AUTO_TEST_SUITE(CheckCheckpoint)
+
+BOOST_AUTO_TEST_CASE(CheckCheckpointRoundTrip) {
+  const std::string file_path = "test_checkpoint.bin";
+  double block[6] = {0.1, -0.2, 0.3, 10.0, -20.0, 30.5};
+  std::vector<int> ids = {4, 8, 15, 16, 23, 42};
+  {
+    CheckpointWriter writer(file_path, "camera_group_calibration");
+    BOOST_REQUIRE(writer.isOpen());
+    writer.write<int>(3);
+    writer.write<double>(2.5);
+    writer.writeBlock(block, 6);
+    writer.writeString("camera_001/image_0001.png");
+    writer.writeVector(ids);
+    writer.writeVector(std::vector<double>());
+    BOOST_REQUIRE(writer.close());
+  }
+
+  CheckpointReader reader(file_path);
+  BOOST_REQUIRE(reader.isValid());
+  BOOST_REQUIRE_EQUAL(reader.getStage(), "camera_group_calibration");
+  BOOST_REQUIRE_EQUAL(reader.read<int>(), 3);
+  BOOST_REQUIRE_EQUAL(reader.read<double>(), 2.5);
+  double read_block[6];
+  reader.readBlock(read_block, 6);
+  for (int i = 0; i < 6; i++)
+    BOOST_REQUIRE_EQUAL(read_block[i], block[i]);
+  BOOST_REQUIRE_EQUAL(reader.readString(), "camera_001/image_0001.png");
+  std::vector<int> read_ids = reader.readVector<int>();
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(read_ids.begin(), read_ids.end(),
+                                  ids.begin(), ids.end());
+  BOOST_REQUIRE(reader.readVector<double>().empty());
+  BOOST_REQUIRE(reader.isValid());
+
+  // nothing left to read
+  reader.read<int>();
+  BOOST_REQUIRE(!reader.isValid());
+  std::remove(file_path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(CheckCheckpointTruncated) {
+  const std::string file_path = "test_checkpoint_truncated.bin";
+  {
+    CheckpointWriter writer(file_path, "final_refinement");
+    writer.writeVector(std::vector<double>(100, 1.0));
+    BOOST_REQUIRE(writer.close());
+  }
+  // cut the file in the middle of the vector
+  std::string content;
+  {
+    std::ifstream file(file_path, std::ifstream::binary);
+    content.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream file(file_path, std::ofstream::binary);
+    file.write(content.data(), content.size() / 2);
+  }
+
+  CheckpointReader reader(file_path);
+  BOOST_REQUIRE(reader.isValid());
+  BOOST_REQUIRE(reader.readVector<double>().empty());
+  BOOST_REQUIRE(!reader.isValid());
+  std::remove(file_path.c_str());
+
+  // not a checkpoint
+  {
+    std::ofstream file(file_path, std::ofstream::binary);
+    file << "camera_matrix: [1, 0, 0]";
+  }
+  CheckpointReader wrong_reader(file_path);
+  BOOST_REQUIRE(!wrong_reader.isValid());
+  std::remove(file_path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(CheckCheckpointInterruptedWrite) {
+  const std::string file_path = "test_checkpoint_interrupted.bin";
+  {
+    CheckpointWriter writer(file_path, "3d_object_calibration");
+    writer.write<int>(7);
+    BOOST_REQUIRE(writer.close());
+  }
+  // a writer destroyed before being closed (e.g. failing stage) does not
+  // replace the previous checkpoint
+  {
+    CheckpointWriter writer(file_path, "camera_group_calibration");
+    writer.write<int>(8);
+    CheckpointReader reader(file_path);
+    BOOST_REQUIRE(reader.isValid());
+    BOOST_REQUIRE_EQUAL(reader.getStage(), "3d_object_calibration");
+  }
+  CheckpointReader reader(file_path);
+  BOOST_REQUIRE_EQUAL(reader.getStage(), "3d_object_calibration");
+  BOOST_REQUIRE_EQUAL(reader.read<int>(), 7);
+  BOOST_REQUIRE(reader.isValid());
+  BOOST_REQUIRE(!std::ifstream(file_path + ".tmp").is_open());
+  std::remove(file_path.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
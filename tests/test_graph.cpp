@@ -9,8 +9,8 @@ BOOST_AUTO_TEST_CASE(CheckSingleVertexAdding) {
 
   test_graph.addVertex(1);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 1);
   BOOST_REQUIRE_EQUAL(num_edges, 0);
@@ -22,8 +22,8 @@ BOOST_AUTO_TEST_CASE(CheckTwoVertexAdding) {
   test_graph.addVertex(1);
   test_graph.addVertex(20000);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 2);
   BOOST_REQUIRE_EQUAL(num_edges, 0);
@@ -35,8 +35,8 @@ BOOST_AUTO_TEST_CASE(CheckDuplicateVertexAdding) {
   test_graph.addVertex(1);
   test_graph.addVertex(1);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 1);
   BOOST_REQUIRE_EQUAL(num_edges, 0);
@@ -47,8 +47,8 @@ BOOST_AUTO_TEST_CASE(CheckSingleEdgeAdding) {
 
   test_graph.addEdge(1, 2, 10);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 2);
   BOOST_REQUIRE_EQUAL(num_edges, 1);
@@ -61,8 +61,8 @@ BOOST_AUTO_TEST_CASE(CheckSingleEdgeAddingBetweenVertices) {
   test_graph.addVertex(2);
   test_graph.addEdge(1, 2, 10);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 2);
   BOOST_REQUIRE_EQUAL(num_edges, 1);
@@ -74,8 +74,8 @@ BOOST_AUTO_TEST_CASE(CheckTwoEdgeConnectedAdding) {
   test_graph.addEdge(1, 2, 10);
   test_graph.addEdge(2, 3, 1);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 3);
   BOOST_REQUIRE_EQUAL(num_edges, 2);
@@ -87,8 +87,8 @@ BOOST_AUTO_TEST_CASE(CheckTwoEdgeDisconnectedAdding) {
   test_graph.addEdge(1, 2, 10);
   test_graph.addEdge(3, 4, 1);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 4);
   BOOST_REQUIRE_EQUAL(num_edges, 2);
@@ -101,8 +101,8 @@ BOOST_AUTO_TEST_CASE(CheckThreeEdgeConnectedAdding) {
   test_graph.addEdge(2, 3, 1);
   test_graph.addEdge(3, 1, 3);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 3);
   BOOST_REQUIRE_EQUAL(num_edges, 3);
@@ -115,8 +115,8 @@ BOOST_AUTO_TEST_CASE(CheckThreeEdgeDisconnectedAdding) {
   test_graph.addEdge(3, 4, 1);
   test_graph.addEdge(5, 6, 2);
 
-  int num_vertices = boost::num_vertices(test_graph.getGraph());
-  int num_edges = boost::num_edges(test_graph.getGraph());
+  int num_vertices = test_graph.numVertices();
+  int num_edges = test_graph.numEdges();
 
   BOOST_REQUIRE_EQUAL(num_vertices, 6);
   BOOST_REQUIRE_EQUAL(num_edges, 3);
@@ -325,4 +325,52 @@ BOOST_AUTO_TEST_CASE(CheckShortestPathSingleCC) {
                                   answer.end());
 }
 
+BOOST_AUTO_TEST_CASE(CheckShortestPathTree) {
+  Graph test_graph;
+
+  test_graph.addEdge(0, 1, 4);
+  test_graph.addEdge(0, 7, 8);
+  test_graph.addEdge(1, 2, 8);
+  test_graph.addEdge(2, 3, 7);
+  test_graph.addEdge(3, 4, 9);
+  test_graph.addEdge(4, 5, 10);
+  test_graph.addEdge(5, 6, 2);
+  test_graph.addEdge(6, 7, 1);
+  test_graph.addEdge(7, 8, 7);
+  test_graph.addEdge(6, 8, 6);
+  test_graph.addEdge(8, 2, 2);
+  test_graph.addEdge(20, 21, 1);
+
+  ShortestPathTree tree = test_graph.shortestPathTree(0);
+
+  // only the component of the source is reached, closest vertices first
+  std::vector<int> answer = {0, 1, 7, 6, 5, 2, 8, 3, 4};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(tree.vertices_.begin(), tree.vertices_.end(),
+                                  answer.begin(), answer.end());
+
+  // every path of the tree is the shortest path between its ends
+  for (const int &vertex : tree.vertices_) {
+    std::vector<int> path = tree.pathTo(vertex);
+    std::vector<int> path_between = test_graph.shortestPathBetween(0, vertex);
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(path.begin(), path.end(),
+                                    path_between.begin(), path_between.end());
+  }
+  BOOST_REQUIRE(tree.pathTo(20).empty());
+}
+
+BOOST_AUTO_TEST_CASE(CheckShortestPathFractionalWeights) {
+  Graph test_graph;
+
+  // covisibility weights (1 / nb_poses) below 1 must not be truncated
+  test_graph.addEdge(0, 1, 1.0 / 10);
+  test_graph.addEdge(1, 2, 1.0 / 10);
+  test_graph.addEdge(0, 2, 1.0 / 2);
+
+  std::vector<int> answer = {0, 1, 2};
+  std::vector<int> path = test_graph.shortestPathBetween(0, 2);
+
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(path.begin(), path.end(), answer.begin(),
+                                  answer.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include <boost/test/unit_test.hpp>
+
+#include <../src/ParameterArena.hpp>
+
+BOOST_AUTO_TEST_SUITE(CheckParameterArena)
+
+BOOST_AUTO_TEST_CASE(CheckBlocksContiguous) {
+  ParameterArena arena;
+  double *first = arena.allocate(ParameterArena::BoardPose, 6);
+  double *second = arena.allocate(ParameterArena::BoardPose, 6);
+  double *intrinsics = arena.allocate(ParameterArena::CameraIntrinsics, 9);
+
+  BOOST_REQUIRE_EQUAL(second - first, 6);
+  BOOST_REQUIRE_EQUAL(arena.getNbBlocks(ParameterArena::BoardPose), 2);
+  BOOST_REQUIRE_EQUAL(arena.getNbBlocks(ParameterArena::CameraIntrinsics), 1);
+  BOOST_REQUIRE_EQUAL(arena.getUsedBytes(ParameterArena::BoardPose),
+                      12 * sizeof(double));
+  for (int i = 0; i < 9; i++)
+    BOOST_REQUIRE_EQUAL(intrinsics[i], 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(CheckBlocksStable) {
+  ParameterArena arena(16);
+  std::vector<double *> blocks;
+  for (int i = 0; i < 100; i++) {
+    double *block = arena.allocate(ParameterArena::RelativeBoardPose, 6);
+    for (int j = 0; j < 6; j++)
+      block[j] = i;
+    blocks.push_back(block);
+  }
+
+  // the blocks must not move or overlap when new chunks are allocated
+  for (int i = 0; i < 100; i++)
+    for (int j = 0; j < 6; j++)
+      BOOST_REQUIRE_EQUAL(blocks[i][j], i);
+  BOOST_REQUIRE_EQUAL(arena.getNbBlocks(ParameterArena::RelativeBoardPose),
+                      100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include <../src/PerfCounters.hpp>
+#include <../src/Pipeline.hpp>
+#include <../src/StageProfiler.hpp>
+
+BOOST_AUTO_TEST_SUITE(CheckPipeline)
+
+BOOST_AUTO_TEST_CASE(CheckPipelineSerialOrder) {
+  std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(4);
+  Pipeline pipeline(pool);
+
+  std::vector<int> order;
+  int a = pipeline.addStage("a", [&] { order.push_back(0); });
+  int b = pipeline.addStage("b", [&] { order.push_back(1); });
+  int c = pipeline.addStage("c", [&] { order.push_back(2); }, {a, b});
+  pipeline.addStage("d", [&] { order.push_back(3); }, {c});
+  BOOST_REQUIRE_EQUAL(pipeline.addStage("e", [] {}, {10}), -1);
+  pipeline.run(true);
+
+  std::vector<int> answer = {0, 1, 2, 3};
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(order.begin(), order.end(), answer.begin(),
+                                  answer.end());
+}
+
+BOOST_AUTO_TEST_CASE(CheckPipelineConcurrentDependencies) {
+  for (int nb_threads : {1, 2, 4}) {
+    std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(nb_threads);
+    Pipeline pipeline(pool);
+
+    // per-camera chains (extraction -> intrinsics) joined by a final stage
+    const int nb_cameras = 8;
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<int> join_dependencies;
+    for (int cam = 0; cam < nb_cameras; cam++) {
+      int extraction = pipeline.addStage("extraction", [&, cam] {
+        std::unique_lock<std::mutex> lock(mutex);
+        order.push_back(2 * cam);
+      });
+      join_dependencies.push_back(pipeline.addStage(
+          "intrinsics",
+          [&, cam] {
+            std::unique_lock<std::mutex> lock(mutex);
+            order.push_back(2 * cam + 1);
+          },
+          {extraction}));
+    }
+    std::atomic<int> nb_joins(0);
+    pipeline.addStage(
+        "join",
+        [&] {
+          std::unique_lock<std::mutex> lock(mutex);
+          BOOST_REQUIRE_EQUAL(order.size(), 2 * nb_cameras);
+          nb_joins++;
+        },
+        join_dependencies);
+    pipeline.run(false);
+
+    BOOST_REQUIRE_EQUAL(nb_joins, 1);
+    BOOST_REQUIRE_EQUAL(order.size(), 2 * nb_cameras);
+    for (int cam = 0; cam < nb_cameras; cam++) {
+      std::vector<int>::iterator extraction =
+          std::find(order.begin(), order.end(), 2 * cam);
+      std::vector<int>::iterator intrinsics =
+          std::find(order.begin(), order.end(), 2 * cam + 1);
+      BOOST_REQUIRE(extraction < intrinsics);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CheckPipelineCountsAtSerialPoints) {
+  for (bool serial : {true, false}) {
+    std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(4);
+    Pipeline pipeline(pool);
+    std::atomic<int> nb_counts(0);
+    pipeline.setStageCounts([&] {
+      nb_counts++;
+      return std::map<std::string, long>();
+    });
+
+    // a -> (b, c) -> d: only a and d cannot overlap another stage
+    int a = pipeline.addStage("a", [] {});
+    int b = pipeline.addStage("b", [] {}, {a});
+    int c = pipeline.addStage("c", [] {}, {a});
+    pipeline.addStage("d", [] {}, {b, c});
+    pipeline.run(serial);
+
+    BOOST_REQUIRE_EQUAL(nb_counts, serial ? 4 : 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CheckPipelineThreadBudget) {
+  for (bool serial : {true, false}) {
+    std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(4);
+    Pipeline pipeline(pool);
+    std::vector<int> budgets(4, 0);
+    int job_budget = 0;
+    std::mutex mutex;
+    std::vector<int> set_threads;
+    pipeline.setStageThreads([&](int nb_threads) {
+      std::unique_lock<std::mutex> lock(mutex);
+      set_threads.push_back(nb_threads);
+    });
+
+    // a -> (b, c) -> d: b and c share the pool
+    int a = pipeline.addStage(
+        "a", [&] { budgets[0] = ThreadPool::getThreadBudget(); });
+    int b = pipeline.addStage(
+        "b", [&] { budgets[1] = ThreadPool::getThreadBudget(); }, {a});
+    int c = pipeline.addStage(
+        "c", [&] { budgets[2] = ThreadPool::getThreadBudget(); }, {a});
+    pipeline.addStage(
+        "d",
+        [&] {
+          budgets[3] = ThreadPool::getThreadBudget();
+          pool->parallelFor(2, [&](int i) {
+            if (i == 0)
+              job_budget = ThreadPool::getThreadBudget();
+          });
+        },
+        {b, c});
+    pipeline.run(serial);
+
+    std::vector<int> answer = {4, serial ? 4 : 2, serial ? 4 : 2, 4};
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(budgets.begin(), budgets.end(),
+                                    answer.begin(), answer.end());
+    BOOST_REQUIRE_EQUAL(job_budget, 1);
+    std::sort(set_threads.begin(), set_threads.end());
+    std::sort(answer.begin(), answer.end());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(set_threads.begin(), set_threads.end(),
+                                    answer.begin(), answer.end());
+    BOOST_REQUIRE_EQUAL(ThreadPool::getThreadBudget(), 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CheckPipelineReportOverlaps) {
+  std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>(4);
+  Pipeline pipeline(pool);
+  StageReport::get().clear();
+
+  // b and c wait for each other, so they overlap
+  std::atomic<int> nb_started(0);
+  auto wait_other = [&] {
+    nb_started++;
+    while (nb_started < 2)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  };
+  int a = pipeline.addStage("a", [] { PerfScope perf("test_kernel"); });
+  int b = pipeline.addStage("b", wait_other, {a});
+  int c = pipeline.addStage("c", wait_other, {a});
+  pipeline.addStage("d", [] {}, {b, c});
+  pipeline.run(false);
+
+  const std::string file_path = "test_stage_report.json";
+  StageReport::get().write(file_path);
+  StageReport::get().clear();
+  std::ifstream file(file_path);
+  std::string report((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+  file.close();
+  std::remove(file_path.c_str());
+
+  int nb_overlapped = 0;
+  for (size_t pos = report.find("\"overlapped\": true");
+       pos != std::string::npos;
+       pos = report.find("\"overlapped\": true", pos + 1))
+    nb_overlapped++;
+  BOOST_REQUIRE_EQUAL(nb_overlapped, 2);
+  BOOST_REQUIRE(report.find("\"total_wall_time\"") != std::string::npos);
+
+  // the kernels are timed even without the hardware counters
+  BOOST_REQUIRE(report.find("\"test_kernel\": {\"calls\": 1, \"wall_time\"") !=
+                std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,32 @@
+#include <boost/test/unit_test.hpp>
+
+#include <../src/Pose.hpp>
+
+BOOST_AUTO_TEST_SUITE(CheckPose)
+
+BOOST_AUTO_TEST_CASE(CheckBlockRoundTrip) {
+  double block[6] = {0.3, -1.2, 2.0, 1.0, 2.0, 3.0};
+  double block_out[6];
+  Pose::fromBlock(block).toBlock(block_out);
+  for (int i = 0; i < 6; i++)
+    BOOST_REQUIRE_SMALL(block_out[i] - block[i], 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(CheckComposeMatchesMat) {
+  double block_1[6] = {0.1, 0.2, -0.3, 0.5, -1.0, 2.0};
+  double block_2[6] = {-0.7, 0.4, 0.9, -3.0, 0.2, 1.5};
+  Pose pose_1 = Pose::fromBlock(block_1);
+  Pose pose_2 = Pose::fromBlock(block_2);
+
+  // same convention as the 4x4 pose matrices
+  cv::Mat expected = pose_2.toMat().inv() * pose_1.toMat();
+  cv::Mat composed = (pose_2.inverse() * pose_1).toMat();
+  BOOST_REQUIRE_SMALL(cv::norm(expected - composed), 1e-9);
+
+  Pose identity = pose_1 * pose_1.inverse();
+  BOOST_REQUIRE_SMALL((identity.rotation_ - Eigen::Matrix3d::Identity()).norm(),
+                      1e-9);
+  BOOST_REQUIRE_SMALL(identity.translation_.norm(), 1e-9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
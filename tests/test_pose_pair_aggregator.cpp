@@ -0,0 +1,62 @@
+#include <boost/test/unit_test.hpp>
+
+#include <../src/PosePairAggregator.hpp>
+
+BOOST_AUTO_TEST_SUITE(CheckPosePairAggregator)
+
+BOOST_AUTO_TEST_CASE(CheckAverageWithOutliers) {
+  Eigen::Matrix3d rotation =
+      Eigen::AngleAxisd(0.8, Eigen::Vector3d(1, 2, 3).normalized())
+          .toRotationMatrix();
+  Eigen::Matrix3d outlier_rotation =
+      Eigen::AngleAxisd(2.5, Eigen::Vector3d::UnitY()).toRotationMatrix();
+  Eigen::Vector3d translation(1.0, -2.0, 3.0);
+
+  // small perturbations around the pose and 20% of outliers
+  PosePairAggregator aggregator(64);
+  for (int i = 0; i < 1000; i++) {
+    double noise = 0.01 * ((i % 7) - 3) / 3.0;
+    Eigen::Matrix3d noisy_rotation =
+        rotation * Eigen::AngleAxisd(noise, Eigen::Vector3d::UnitX())
+                       .toRotationMatrix();
+    if (i % 5 == 0)
+      aggregator.addPose(Pose(outlier_rotation, -translation));
+    else
+      aggregator.addPose(
+          Pose(noisy_rotation, translation + Eigen::Vector3d::Constant(noise)));
+  }
+
+  BOOST_REQUIRE_EQUAL(aggregator.getNbPoses(), 1000);
+  Pose average = aggregator.getAveragePose();
+  Eigen::AngleAxisd error(rotation.transpose() * average.rotation_);
+  BOOST_REQUIRE_SMALL(error.angle(), 0.01);
+  BOOST_REQUIRE_SMALL((average.translation_ - translation).norm(), 0.03);
+}
+
+BOOST_AUTO_TEST_CASE(CheckMergeChunks) {
+  Eigen::Vector3d translation(0.5, 0.0, -1.0);
+  Pose pose(Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitZ()).toRotationMatrix(),
+            translation);
+
+  // the same stream split in chunks of various sizes
+  std::vector<std::map<std::pair<int, int>, PosePairAggregator>> chunks(3);
+  for (int i = 0; i < 500; i++)
+    chunks[i % 3][std::make_pair(0, 1)].addPose(pose);
+  chunks[1][std::make_pair(1, 2)].addPose(pose);
+
+  std::map<std::pair<int, int>, PosePairAggregator> merged, merged_again;
+  mergePosePairs(chunks, merged);
+  mergePosePairs(chunks, merged_again);
+
+  BOOST_REQUIRE_EQUAL(merged.size(), 2);
+  BOOST_REQUIRE_EQUAL(merged[std::make_pair(0, 1)].getNbPoses(), 500);
+  BOOST_REQUIRE_EQUAL(merged[std::make_pair(1, 2)].getNbPoses(), 1);
+  Pose average = merged[std::make_pair(0, 1)].getAveragePose();
+  Pose average_again = merged_again[std::make_pair(0, 1)].getAveragePose();
+  BOOST_REQUIRE_SMALL((average.rotation_ - pose.rotation_).norm(), 1e-9);
+  BOOST_REQUIRE_SMALL((average.translation_ - translation).norm(), 1e-9);
+  BOOST_REQUIRE_SMALL((average.rotation_ - average_again.rotation_).norm(),
+                      1e-12);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
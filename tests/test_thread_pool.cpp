@@ -0,0 +1,103 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+
+#include <../src/ThreadPool.hpp>
+
+BOOST_AUTO_TEST_SUITE(CheckThreadPool)
+
+BOOST_AUTO_TEST_CASE(CheckParallelForAllJobs) {
+  for (int nb_threads : {1, 2, 4}) {
+    ThreadPool pool(nb_threads);
+
+    std::vector<int> result(100, -1);
+    pool.parallelFor(result.size(), [&](int i) { result[i] = i; });
+
+    std::vector<int> answer(100);
+    std::iota(answer.begin(), answer.end(), 0);
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(result.begin(), result.end(),
+                                    answer.begin(), answer.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CheckParallelForNoJob) {
+  ThreadPool pool(4);
+
+  int nb_calls = 0;
+  pool.parallelFor(0, [&](int i) { nb_calls++; });
+
+  BOOST_REQUIRE_EQUAL(nb_calls, 0);
+}
+
+BOOST_AUTO_TEST_CASE(CheckParallelForException) {
+  for (int nb_threads : {2, 4}) {
+    ThreadPool pool(nb_threads);
+
+    // the other jobs are run and the caller gets the exception
+    std::vector<int> result(100, -1);
+    BOOST_CHECK_THROW(pool.parallelFor(result.size(),
+                                       [&](int i) {
+                                         if (i % 10 == 3)
+                                           throw std::runtime_error("job");
+                                         result[i] = i;
+                                       }),
+                      std::runtime_error);
+    for (int i = 0; i < result.size(); i++)
+      BOOST_REQUIRE_EQUAL(result[i], i % 10 == 3 ? -1 : i);
+
+    // the pool can still be used
+    std::atomic<int> nb_calls(0);
+    pool.parallelFor(10, [&](int i) { nb_calls++; });
+    BOOST_REQUIRE_EQUAL(nb_calls, 10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CheckParallelForNested) {
+  ThreadPool pool(2);
+
+  std::vector<int> result(16, 0);
+  pool.parallelFor(4, [&](int i) {
+    pool.parallelFor(4, [&](int j) { result[4 * i + j] += 1; });
+  });
+
+  std::vector<int> answer(16, 1);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(result.begin(), result.end(),
+                                  answer.begin(), answer.end());
+}
+
+BOOST_AUTO_TEST_CASE(CheckParallelForNestedStats) {
+  ThreadPool pool(4);
+
+  // nested jobs submitted by the workers can be stolen by the idle ones
+  std::vector<int> result(64, 0);
+  pool.parallelFor(8, [&](int i) {
+    pool.parallelFor(8, [&](int j) { result[8 * i + j] += 1; });
+  });
+
+  std::vector<int> answer(64, 1);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(result.begin(), result.end(),
+                                  answer.begin(), answer.end());
+  ThreadPool::Stats stats = pool.getStats();
+  BOOST_REQUIRE_EQUAL(stats.nb_jobs, 8 + 64);
+  BOOST_REQUIRE(stats.busy_time > 0.0);
+  BOOST_REQUIRE(!ThreadPool::isInParallelJob());
+}
+
+BOOST_AUTO_TEST_CASE(CheckTaskTagInherited) {
+  ThreadPool pool(4);
+
+  // the jobs run with the tag of the thread submitting them
+  ThreadPool::setTaskTag(7);
+  std::vector<int> tags(32, 0);
+  pool.parallelFor(32, [&](int i) { tags[i] = ThreadPool::getTaskTag(); });
+  ThreadPool::setTaskTag(0);
+
+  std::vector<int> answer(32, 7);
+  BOOST_REQUIRE_EQUAL_COLLECTIONS(tags.begin(), tags.end(), answer.begin(),
+                                  answer.end());
+  BOOST_REQUIRE_EQUAL(ThreadPool::getTaskTag(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()